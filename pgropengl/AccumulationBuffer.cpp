@@ -0,0 +1,94 @@
+#include "AccumulationBuffer.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+
+//radical inverse of index in given base, low discrepancy sequence covering pixel evenly
+static float halton(int index, int base) {
+	float result = 0.f;
+	float fraction = 1.f / base;
+	while (index > 0) {
+		result += (index % base) * fraction;
+		index /= base;
+		fraction /= base;
+	}
+	return result;
+}
+
+	AccumulationBuffer::AccumulationBuffer() : accumulatePass("shaders/accumulateFS.glsl") {
+	}
+
+	void AccumulationBuffer::resize(int width, int height) {
+		if (width == this->width && height == this->height && sampleFramebuffer != 0) {
+			return;
+		}
+		releaseTargets();
+		//refinement is turned off when its shader cannot be used
+		if (accumulatePass.getProgram() == 0 && !accumulatePass.compile()) {
+			enabled = false;
+			return;
+		}
+		this->width = width;
+		this->height = height;
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &sampleTexture);
+		glTextureStorage2D(sampleTexture, 1, GL_RGBA8, width, height);
+		glCreateRenderbuffers(1, &depthRenderbuffer);
+		glNamedRenderbufferStorage(depthRenderbuffer, GL_DEPTH_COMPONENT24, width, height);
+		glCreateFramebuffers(1, &sampleFramebuffer);
+		glNamedFramebufferTexture(sampleFramebuffer, GL_COLOR_ATTACHMENT0, sampleTexture, 0);
+		glNamedFramebufferRenderbuffer(sampleFramebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &accumulationTexture);
+		glTextureStorage2D(accumulationTexture, 1, GL_RGBA32F, width, height);
+		glCreateFramebuffers(1, &accumulationFramebuffer);
+		glNamedFramebufferTexture(accumulationFramebuffer, GL_COLOR_ATTACHMENT0, accumulationTexture, 0);
+
+		if (glCheckNamedFramebufferStatus(sampleFramebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE
+			|| glCheckNamedFramebufferStatus(accumulationFramebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Accumulation framebuffer is not complete" << std::endl;
+		}
+		reset();
+	}
+
+	glm::mat4 AccumulationBuffer::jitterProjection(const glm::mat4& projectionMatrix) const {
+		if (sampleCount == 0) {
+			return projectionMatrix;
+		}
+		//offset within pixel in -0.5..0.5, moved in clip space after projection so it works for both projection modes
+		glm::vec2 offset(halton(sampleCount, 2) - 0.5f, halton(sampleCount, 3) - 0.5f);
+		glm::vec3 clipOffset(offset.x * 2.f / width, offset.y * 2.f / height, 0.f);
+		return glm::translate(glm::mat4(1.f), clipOffset) * projectionMatrix;
+	}
+
+	void AccumulationBuffer::accumulate(GLStateCache& state) {
+		glBindFramebuffer(GL_FRAMEBUFFER, accumulationFramebuffer);
+		glViewport(0, 0, width, height);
+		state.setEnabled(GL_DEPTH_TEST, false);
+		state.setEnabled(GL_BLEND, true);
+		//new = sample * weight + average * (1 - weight), first sample overwrites whatever was there
+		state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		state.bindTexture(0, sampleTexture);
+		glProgramUniform1f(accumulatePass.getProgram(), 0, 1.f / (sampleCount + 1));
+		accumulatePass.draw(state);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		sampleCount++;
+	}
+
+	void AccumulationBuffer::present(GLuint framebuffer) {
+		glBlitNamedFramebuffer(accumulationFramebuffer, framebuffer, 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+
+	void AccumulationBuffer::release() {
+		accumulatePass.release();
+		releaseTargets();
+	}
+
+	void AccumulationBuffer::releaseTargets() {
+		glDeleteFramebuffers(1, &sampleFramebuffer);
+		glDeleteFramebuffers(1, &accumulationFramebuffer);
+		glDeleteTextures(1, &sampleTexture);
+		glDeleteTextures(1, &accumulationTexture);
+		glDeleteRenderbuffers(1, &depthRenderbuffer);
+		sampleFramebuffer = accumulationFramebuffer = sampleTexture = accumulationTexture = depthRenderbuffer = 0;
+		width = height = 0;
+	}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "GLStateCache.h"
+#include "FullscreenPass.h"
+
+//progressive anti-aliasing of still image
+//every frame scene is rendered with projection jittered by sub-pixel offset from Halton sequence
+//and averaged into float buffer, any change of view has to reset it
+class AccumulationBuffer {
+public:
+    bool enabled = true;
+    //average stops improving visibly after this many samples, rendering then stops too
+    int maxSamples = 64;
+
+    AccumulationBuffer();
+
+    //creates targets of given size, does nothing when size did not change
+    void resize(int width, int height);
+    void reset() { sampleCount = 0; }
+    bool isConverged() const { return sampleCount >= maxSamples; }
+    int getSampleCount() const { return sampleCount; }
+
+    //projection shifted by sub-pixel offset of next sample, first sample is not shifted
+    glm::mat4 jitterProjection(const glm::mat4& projectionMatrix) const;
+    //framebuffer next sample is rendered into
+    GLuint getSampleFramebuffer() const { return sampleFramebuffer; }
+    //adds rendered sample into average
+    void accumulate(GLStateCache& state);
+    //copies average into framebuffer
+    void present(GLuint framebuffer = 0);
+    void release();
+
+private:
+    void releaseTargets();
+
+    FullscreenPass accumulatePass;
+    int width = 0;
+    int height = 0;
+    int sampleCount = 0;
+
+    GLuint sampleFramebuffer = 0;
+    GLuint sampleTexture = 0;
+    GLuint depthRenderbuffer = 0;
+    GLuint accumulationFramebuffer = 0;
+    //RGBA32F, 8 bit target would lose small contributions of late samples
+    GLuint accumulationTexture = 0;
+};
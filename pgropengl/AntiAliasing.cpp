@@ -0,0 +1,162 @@
+#include "AntiAliasing.h"
+#include <iostream>
+
+//frames rendered in every mode by benchmark, results are told apart by timer tag
+static const int benchmarkFramesPerMode = 60;
+//weight of new measurement in smoothed times
+static const double smoothing = 0.1;
+
+	AntiAliasing::AntiAliasing() : fxaaPass("shaders/fxaaFS.glsl") {
+	}
+
+	void AntiAliasing::resize(int width, int height) {
+		if (width == this->width && height == this->height && framebuffer != 0) {
+			return;
+		}
+		releaseTargets();
+		if (fxaaPass.getProgram() == 0) {
+			fxaaAvailable = fxaaPass.compile();
+			glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+		}
+		this->width = width;
+		this->height = height;
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &colorTexture);
+		glTextureStorage2D(colorTexture, 1, GL_RGBA8, width, height);
+		glTextureParameteri(colorTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(colorTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(colorTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(colorTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glCreateRenderbuffers(1, &depthRenderbuffer);
+		glNamedRenderbufferStorage(depthRenderbuffer, GL_DEPTH_COMPONENT24, width, height);
+		glCreateFramebuffers(1, &framebuffer);
+		glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, colorTexture, 0);
+		glNamedFramebufferRenderbuffer(framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+		if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "FXAA framebuffer is not complete" << std::endl;
+		}
+	}
+
+	void AntiAliasing::beginScene(GLuint destination, int renderWidth, int renderHeight) {
+		this->destination = destination;
+		this->renderWidth = renderWidth;
+		this->renderHeight = renderHeight;
+		activeMode = mode;
+		if (benchmarkFrame >= 0) {
+			//supported modes one after another, then back to selected one
+			int modeIndex = benchmarkFrame / benchmarkFramesPerMode;
+			while (modeIndex < ModeCount && !isSupported((Mode)modeIndex)) {
+				modeIndex++;
+				benchmarkFrame = modeIndex * benchmarkFramesPerMode;
+			}
+			if (modeIndex < ModeCount) {
+				activeMode = (Mode)modeIndex;
+				benchmarkFrame++;
+			}
+			else {
+				benchmarkFrame = -1;
+			}
+		}
+		if (!isSupported(activeMode)) {
+			activeMode = None;
+		}
+
+		if (timer.poll()) {
+			double& smoothed = gpuMs[timer.getTag()];
+			smoothed = smoothed < 0.0 ? timer.getMilliseconds() : smoothed * (1.0 - smoothing) + timer.getMilliseconds() * smoothing;
+		}
+		timer.begin(activeMode);
+
+		if (activeMode == Fxaa) {
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		}
+		else if (activeMode == Msaa2x || activeMode == Msaa4x) {
+			int index = activeMode == Msaa2x ? 0 : 1;
+			if (multisampleFramebuffers[index] == 0) {
+				createMultisampleTarget(index, activeMode == Msaa2x ? 2 : 4);
+			}
+			glBindFramebuffer(GL_FRAMEBUFFER, multisampleFramebuffers[index]);
+		}
+		else {
+			glBindFramebuffer(GL_FRAMEBUFFER, destination);
+		}
+	}
+
+	void AntiAliasing::endScene(GLStateCache& state) {
+		if (activeMode == Fxaa) {
+			glBindFramebuffer(GL_FRAMEBUFFER, destination);
+			glViewport(0, 0, renderWidth, renderHeight);
+			state.setEnabled(GL_DEPTH_TEST, false);
+			state.setEnabled(GL_BLEND, false);
+			state.bindTexture(0, colorTexture);
+			GLuint program = fxaaPass.getProgram();
+			//rendered part of target in texture coordinates and size of one texel
+			glProgramUniform2f(program, 0, (float)renderWidth / width, (float)renderHeight / height);
+			glProgramUniform2f(program, 1, 1.f / width, 1.f / height);
+			fxaaPass.draw(state);
+		}
+		else if (activeMode == Msaa2x || activeMode == Msaa4x) {
+			GLuint source = multisampleFramebuffers[activeMode == Msaa2x ? 0 : 1];
+			glBlitNamedFramebuffer(source, destination, 0, 0, renderWidth, renderHeight, 0, 0, renderWidth, renderHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+			glBindFramebuffer(GL_FRAMEBUFFER, destination);
+		}
+		timer.end();
+	}
+
+	void AntiAliasing::release() {
+		fxaaPass.release();
+		timer.release();
+		releaseTargets();
+	}
+
+	void AntiAliasing::startBenchmark() {
+		for (double& time : gpuMs) {
+			time = -1.0;
+		}
+		benchmarkFrame = 0;
+	}
+
+	bool AntiAliasing::isSupported(Mode mode) const {
+		if (mode == Msaa2x) {
+			return maxSamples >= 2;
+		}
+		if (mode == Msaa4x) {
+			return maxSamples >= 4;
+		}
+		if (mode == Fxaa) {
+			return fxaaAvailable;
+		}
+		return true;
+	}
+
+	const char* AntiAliasing::getName(Mode mode) {
+		const char* names[] = { "Off", "FXAA", "MSAA 2x", "MSAA 4x" };
+		return names[mode];
+	}
+
+	void AntiAliasing::createMultisampleTarget(int index, int samples) {
+		glCreateRenderbuffers(1, &multisampleColor[index]);
+		glNamedRenderbufferStorageMultisample(multisampleColor[index], samples, GL_RGBA8, width, height);
+		glCreateRenderbuffers(1, &multisampleDepth[index]);
+		glNamedRenderbufferStorageMultisample(multisampleDepth[index], samples, GL_DEPTH_COMPONENT24, width, height);
+		glCreateFramebuffers(1, &multisampleFramebuffers[index]);
+		glNamedFramebufferRenderbuffer(multisampleFramebuffers[index], GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, multisampleColor[index]);
+		glNamedFramebufferRenderbuffer(multisampleFramebuffers[index], GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, multisampleDepth[index]);
+		if (glCheckNamedFramebufferStatus(multisampleFramebuffers[index], GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Multisample framebuffer is not complete" << std::endl;
+		}
+	}
+
+	void AntiAliasing::releaseTargets() {
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteTextures(1, &colorTexture);
+		glDeleteRenderbuffers(1, &depthRenderbuffer);
+		glDeleteFramebuffers(2, multisampleFramebuffers);
+		glDeleteRenderbuffers(2, multisampleColor);
+		glDeleteRenderbuffers(2, multisampleDepth);
+		framebuffer = colorTexture = depthRenderbuffer = 0;
+		for (int i = 0; i < 2; i++) {
+			multisampleFramebuffers[i] = multisampleColor[i] = multisampleDepth[i] = 0;
+		}
+		width = height = 0;
+	}
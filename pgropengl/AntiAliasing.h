@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "GLStateCache.h"
+#include "FullscreenPass.h"
+#include "GpuTimer.h"
+
+//anti-aliasing of main view, scene is rendered into offscreen target of selected mode and resolved into destination
+//FXAA filters edges in one full screen pass, MSAA renders into multisampled target and resolves it by blit
+//GPU time of scene is measured for every mode, so their costs can be compared
+class AntiAliasing {
+public:
+    enum Mode { None, Fxaa, Msaa2x, Msaa4x, ModeCount };
+    Mode mode = Fxaa;
+
+    AntiAliasing();
+
+    //targets are of native size, scene may use only part of them, does nothing when size did not change
+    void resize(int width, int height);
+    //binds target of current mode, scene of given size is then rendered into its bottom left corner
+    void beginScene(GLuint destination, int renderWidth, int renderHeight);
+    //resolves scene into destination and ends timing
+    void endScene(GLStateCache& state);
+    void release();
+
+    //renders few frames in every supported mode to measure them all
+    void startBenchmark();
+    bool isBenchmarking() const { return benchmarkFrame >= 0; }
+    bool isSupported(Mode mode) const;
+    //smoothed GPU time of scene in given mode, negative until measured
+    double getGpuMs(Mode mode) const { return gpuMs[mode]; }
+    static const char* getName(Mode mode);
+
+private:
+    void releaseTargets();
+    void createMultisampleTarget(int index, int samples);
+
+    FullscreenPass fxaaPass;
+    GpuTimer timer;
+    double gpuMs[ModeCount] = { -1.0, -1.0, -1.0, -1.0 };
+    int maxSamples = 0;
+    bool fxaaAvailable = false;
+    int benchmarkFrame = -1;
+
+    int width = 0;
+    int height = 0;
+    Mode activeMode = None;
+    GLuint destination = 0;
+    int renderWidth = 0;
+    int renderHeight = 0;
+
+    //FXAA input
+    GLuint framebuffer = 0;
+    GLuint colorTexture = 0;
+    GLuint depthRenderbuffer = 0;
+    //2x and 4x targets, created on first use
+    GLuint multisampleFramebuffers[2] = {};
+    GLuint multisampleColor[2] = {};
+    GLuint multisampleDepth[2] = {};
+};
@@ -0,0 +1,39 @@
+#include "DepthPrepass.h"
+
+//auto mode spends probeFrames on the other option every probeInterval frames, camera or model may have changed since
+static const unsigned int probeInterval = 240;
+static const unsigned int probeFrames = 12;
+//weight of new measurement in smoothed times
+static const double smoothing = 0.1;
+
+	bool DepthPrepass::beginFrame() {
+		frame++;
+		if (mode != Auto) {
+			active = mode == On;
+			return active;
+		}
+		if (getFrameMs(false) < 0.0 || getFrameMs(true) < 0.0) {
+			//measure both options first
+			active = colorMs[0] >= 0.0;
+			return active;
+		}
+		bool preferred = getFrameMs(true) < getFrameMs(false);
+		bool probing = frame % probeInterval < probeFrames;
+		active = probing ? !preferred : preferred;
+		return active;
+	}
+
+	void DepthPrepass::endFrame() {
+		if (prepassTimer.poll()) {
+			prepassMs = prepassMs < 0.0 ? prepassTimer.getMilliseconds() : prepassMs * (1.0 - smoothing) + prepassTimer.getMilliseconds() * smoothing;
+		}
+		if (colorTimer.poll()) {
+			double& smoothed = colorMs[colorTimer.getTag()];
+			smoothed = smoothed < 0.0 ? colorTimer.getMilliseconds() : smoothed * (1.0 - smoothing) + colorTimer.getMilliseconds() * smoothing;
+		}
+	}
+
+	void DepthPrepass::release() {
+		prepassTimer.release();
+		colorTimer.release();
+	}
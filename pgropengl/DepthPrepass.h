@@ -0,0 +1,36 @@
+#pragma once
+
+#include "GpuTimer.h"
+
+//decides whether opaque meshes get depth only pre-pass and measures what it costs
+//in auto mode both options are timed now and then and the cheaper one is used
+class DepthPrepass {
+public:
+    enum Mode { Off, On, Auto };
+    Mode mode = Auto;
+
+    //decides for current frame, call before rendering main view
+    bool beginFrame();
+    void beginPrepass() { prepassTimer.begin(); }
+    void endPrepass() { prepassTimer.end(); }
+    void beginColorPass() { colorTimer.begin(active ? 1 : 0); }
+    void endColorPass() { colorTimer.end(); }
+    //collects finished measurements
+    void endFrame();
+    void release();
+
+    bool isActive() const { return active; }
+    //smoothed GPU times, negative until measured
+    double getPrepassMs() const { return prepassMs; }
+    //time of both passes with pre-pass or of color pass alone
+    double getFrameMs(bool withPrepass) const { return withPrepass ? (colorMs[1] < 0.0 || prepassMs < 0.0 ? -1.0 : colorMs[1] + prepassMs) : colorMs[0]; }
+
+private:
+    GpuTimer prepassTimer;
+    GpuTimer colorTimer;
+    bool active = false;
+    unsigned int frame = 0;
+    double prepassMs = -1.0;
+    //indexed by pre-pass on/off
+    double colorMs[2] = { -1.0, -1.0 };
+};
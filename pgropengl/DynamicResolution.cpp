@@ -0,0 +1,102 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//timings are stored with scale they were measured at, in thousandths
+static const float tagScale = 1000.f;
+//weight of new measurement in smoothed time
+static const double smoothing = 0.2;
+//only part of correction is applied per result, results arrive few frames late
+static const float correctionGain = 0.5f;
+//scale changes smaller than this are ignored, so scale does not flicker around target
+static const float deadBand = 0.02f;
+
+	DynamicResolution::DynamicResolution() : upscalePass("shaders/upscaleFS.glsl") {
+	}
+
+	void DynamicResolution::resize(int width, int height) {
+		if (width == this->width && height == this->height && framebuffer != 0) {
+			return;
+		}
+		releaseTarget();
+		//scaling is turned off when its shader cannot be used
+		if (upscalePass.getProgram() == 0 && !upscalePass.compile()) {
+			enabled = false;
+			return;
+		}
+		this->width = width;
+		this->height = height;
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &colorTexture);
+		glTextureStorage2D(colorTexture, 1, GL_RGBA8, width, height);
+		glTextureParameteri(colorTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(colorTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(colorTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(colorTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glCreateRenderbuffers(1, &depthRenderbuffer);
+		glNamedRenderbufferStorage(depthRenderbuffer, GL_DEPTH_COMPONENT24, width, height);
+		glCreateFramebuffers(1, &framebuffer);
+		glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, colorTexture, 0);
+		glNamedFramebufferRenderbuffer(framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+		if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Dynamic resolution framebuffer is not complete" << std::endl;
+		}
+	}
+
+	void DynamicResolution::beginScene() {
+		updateScale();
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		timer.begin((int)std::lround(scale * tagScale));
+	}
+
+	void DynamicResolution::endScene(GLStateCache& state, GLuint framebuffer) {
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glViewport(0, 0, width, height);
+		state.setEnabled(GL_DEPTH_TEST, false);
+		state.setEnabled(GL_BLEND, false);
+		state.bindTexture(0, colorTexture);
+		GLuint program = upscalePass.getProgram();
+		//rendered part of target in texture coordinates and size of one source texel
+		glProgramUniform2f(program, 0, (float)getRenderWidth() / width, (float)getRenderHeight() / height);
+		glProgramUniform2f(program, 1, 1.f / width, 1.f / height);
+		glProgramUniform1f(program, 2, scale < 1.f ? sharpness : 0.f);
+		upscalePass.draw(state);
+		timer.end();
+	}
+
+	void DynamicResolution::release() {
+		upscalePass.release();
+		timer.release();
+		releaseTarget();
+	}
+
+	int DynamicResolution::getRenderWidth() const {
+		return std::max(1, (int)std::lround(width * scale));
+	}
+
+	int DynamicResolution::getRenderHeight() const {
+		return std::max(1, (int)std::lround(height * scale));
+	}
+
+	void DynamicResolution::updateScale() {
+		if (!timer.poll()) {
+			return;
+		}
+		gpuMs = gpuMs < 0.0 ? timer.getMilliseconds() : gpuMs * (1.0 - smoothing) + timer.getMilliseconds() * smoothing;
+		//GPU time grows with pixel count, which is square of scale
+		float measuredScale = timer.getTag() / tagScale;
+		float desired = measuredScale * std::sqrt(targetFrameMs / (float)std::max(gpuMs, 0.01));
+		desired = std::min(std::max(desired, minScale), 1.f);
+		if (std::abs(desired - scale) > deadBand) {
+			scale = std::min(std::max(scale + (desired - scale) * correctionGain, minScale), 1.f);
+		}
+	}
+
+	void DynamicResolution::releaseTarget() {
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteTextures(1, &colorTexture);
+		glDeleteRenderbuffers(1, &depthRenderbuffer);
+		framebuffer = colorTexture = depthRenderbuffer = 0;
+		width = height = 0;
+	}
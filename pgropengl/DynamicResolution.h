@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "GLStateCache.h"
+#include "FullscreenPass.h"
+#include "GpuTimer.h"
+
+//renders scene into part of offscreen target and scales that part so GPU time of frame meets target
+//scaled image is upscaled to native resolution with sharpening, gui is drawn afterwards at native resolution
+class DynamicResolution {
+public:
+    bool enabled = false;
+    float targetFrameMs = 16.6f;
+    //lowest scale of each axis
+    float minScale = 0.5f;
+    //strength of sharpening applied while upscaling
+    float sharpness = 0.4f;
+
+    DynamicResolution();
+
+    //creates target of native size, does nothing when size did not change
+    void resize(int width, int height);
+    //picks scale from finished GPU timings, binds target and starts timing
+    void beginScene();
+    //upscales scene into framebuffer of native size and ends timing
+    void endScene(GLStateCache& state, GLuint framebuffer);
+    void release();
+
+    //scaled scene is rendered into bottom left corner of it
+    GLuint getFramebuffer() const { return framebuffer; }
+    int getRenderWidth() const;
+    int getRenderHeight() const;
+    float getScale() const { return scale; }
+    //smoothed GPU time of scaled frames, negative until measured
+    double getGpuMs() const { return gpuMs; }
+
+private:
+    void updateScale();
+    void releaseTarget();
+
+    FullscreenPass upscalePass;
+    GpuTimer timer;
+    int width = 0;
+    int height = 0;
+    float scale = 1.f;
+    double gpuMs = -1.0;
+
+    GLuint framebuffer = 0;
+    GLuint colorTexture = 0;
+    GLuint depthRenderbuffer = 0;
+};
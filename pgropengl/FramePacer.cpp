@@ -0,0 +1,94 @@
+#include "FramePacer.h"
+#include <algorithm>
+
+//wait used while background work is pending, short enough to keep loading smooth
+static const int backgroundTimeoutMs = 16;
+
+	void FramePacer::setVSync(VSync vsync) {
+		this->vsync = vsync;
+		if (vsync == VSyncAdaptive) {
+			//late frames are swapped right away instead of waiting for next refresh
+			if (SDL_GL_SetSwapInterval(-1) == 0) {
+				return;
+			}
+			adaptiveSupported = false;
+			this->vsync = VSyncOn;
+		}
+		SDL_GL_SetSwapInterval(this->vsync == VSyncOff ? 0 : 1);
+	}
+
+	void FramePacer::waitForWork(bool backgroundWork) {
+		if (!idleMode || redrawFrames > 0) {
+			return;
+		}
+		Uint64 start = SDL_GetPerformanceCounter();
+		//null event only peeks, so input handling still gets the event
+		if (SDL_WaitEventTimeout(nullptr, backgroundWork ? std::min(idleTimeoutMs, backgroundTimeoutMs) : idleTimeoutMs)) {
+			requestRedraw();
+		}
+		waitTicks += SDL_GetPerformanceCounter() - start;
+	}
+
+	void FramePacer::requestRedraw(int frames) {
+		redrawFrames = std::max(redrawFrames, frames);
+	}
+
+	bool FramePacer::watch(const void* data, size_t size) {
+		//FNV-1a of watched state
+		uint64_t hash = 14695981039346656037ull;
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		if (hash != watchedHash) {
+			watchedHash = hash;
+			requestRedraw();
+			return true;
+		}
+		return false;
+	}
+
+	bool FramePacer::beginFrame() {
+		Uint64 now = SDL_GetPerformanceCounter();
+		Uint64 frequency = SDL_GetPerformanceFrequency();
+		if (secondStart == 0 || now - secondStart >= frequency) {
+			renderedPerSecond = rendered;
+			skippedPerSecond = skipped;
+			rendered = skipped = 0;
+			secondStart = now;
+		}
+
+		if (idleMode && redrawFrames == 0) {
+			skipped++;
+			return false;
+		}
+		if (redrawFrames > 0) {
+			redrawFrames--;
+		}
+		//last requested frame, loop sleeps after it unless something changes
+		idle = idleMode && redrawFrames == 0;
+
+		if (lastFrameStart != 0) {
+			frameTimeMs = (now - lastFrameStart - std::min(waitTicks, now - lastFrameStart)) * 1000.f / frequency;
+		}
+		lastFrameStart = frameStart = now;
+		waitTicks = 0;
+		rendered++;
+		return true;
+	}
+
+	void FramePacer::endFrame() {
+		if (frameCap <= 0) {
+			return;
+		}
+		Uint64 frequency = SDL_GetPerformanceFrequency();
+		Uint64 frameEnd = frameStart + frequency / frameCap;
+		//SDL_Delay is coarse, last millisecond is waited out by polling counter
+		for (Uint64 now = SDL_GetPerformanceCounter(); now < frameEnd; now = SDL_GetPerformanceCounter()) {
+			Uint64 remainingMs = (frameEnd - now) * 1000 / frequency;
+			if (remainingMs > 1) {
+				SDL_Delay((Uint32)(remainingMs - 1));
+			}
+		}
+	}
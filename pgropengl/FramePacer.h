@@ -0,0 +1,61 @@
+#pragma once
+
+#include <SDL.h>
+#include <cstddef>
+#include <cstdint>
+
+//decides when main loop renders and how fast
+//in idle mode the loop sleeps in SDL_WaitEventTimeout and redraws only after input or when watched state changes,
+//rendered frames are limited by frame cap, swap interval may be adaptive vsync
+class FramePacer {
+public:
+    enum VSync { VSyncOff, VSyncOn, VSyncAdaptive };
+
+    bool idleMode = true;
+    //frames per second, 0 = unlimited
+    int frameCap = 60;
+    //longest sleep without event, loop then still polls background work
+    int idleTimeoutMs = 250;
+
+    //sets swap interval, adaptive vsync falls back to regular one when driver does not support it
+    void setVSync(VSync vsync);
+    VSync getVSync() const { return vsync; }
+    bool isAdaptiveVSyncSupported() const { return adaptiveSupported; }
+
+    //blocks until event arrives or timeout passes when nothing has to be drawn, events stay queued for input handling
+    //background work shortens the wait so its results are picked up soon
+    void waitForWork(bool backgroundWork);
+    //draws next frames, frames are counted because gui reacts to input one frame later
+    void requestRedraw(int frames = 2);
+    //requests redraw when watched bytes differ from previous call, returns true then
+    bool watch(const void* data, size_t size);
+    //true when frame has to be rendered, otherwise loop skips drawing
+    bool beginFrame();
+    //sleeps rest of frame cap after swap
+    void endFrame();
+
+    bool isIdle() const { return idle; }
+    //time between rendered frames without time spent waiting for events
+    float getFrameTimeMs() const { return frameTimeMs; }
+    //frames rendered and loop iterations skipped in last second
+    unsigned int getRenderedPerSecond() const { return renderedPerSecond; }
+    unsigned int getSkippedPerSecond() const { return skippedPerSecond; }
+
+private:
+    VSync vsync = VSyncOn;
+    bool adaptiveSupported = true;
+    int redrawFrames = 2;
+    uint64_t watchedHash = 0;
+    bool idle = false;
+
+    Uint64 frameStart = 0;
+    Uint64 lastFrameStart = 0;
+    Uint64 waitTicks = 0;
+    float frameTimeMs = 0.f;
+
+    Uint64 secondStart = 0;
+    unsigned int rendered = 0;
+    unsigned int skipped = 0;
+    unsigned int renderedPerSecond = 0;
+    unsigned int skippedPerSecond = 0;
+};
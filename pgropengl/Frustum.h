@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+//planes of view volume of projection matrix, in space the matrix transforms from
+struct Frustum {
+    //normalized, so plane equation gives distance
+    glm::vec4 planes[6];
+
+    Frustum(const glm::mat4& matrix)
+    {
+        //planes are sums and differences of last row with others (Gribb, Hartmann)
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++) {
+            rows[i] = glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]);
+        }
+        for (int i = 0; i < 3; i++) {
+            glm::vec4 positive = rows[3] + rows[i];
+            glm::vec4 negative = rows[3] - rows[i];
+            planes[i * 2] = positive / glm::length(glm::vec3(positive));
+            planes[i * 2 + 1] = negative / glm::length(glm::vec3(negative));
+        }
+    }
+
+    bool intersectsSphere(const glm::vec3& center, float radius) const
+    {
+        for (const auto& plane : planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
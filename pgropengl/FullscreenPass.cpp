@@ -0,0 +1,55 @@
+#include "FullscreenPass.h"
+#include <iostream>
+
+static const char* fullscreenVertexPath = "shaders/fullscreenVS.glsl";
+
+	FullscreenPass::FullscreenPass(const std::string& fragmentPath) : fragmentPath(fragmentPath) {
+	}
+
+	bool FullscreenPass::compile() {
+		std::string vertexSource;
+		std::string fragmentSource;
+		if (!LoadShaderFile(fullscreenVertexPath, vertexSource) || !LoadShaderFile(fragmentPath, fragmentSource)) {
+			return false;
+		}
+		GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, vertexSource);
+		GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+		program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		glLinkProgram(program);
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (!linked) {
+			PrintShaderLog(vertexShader);
+			PrintShaderLog(fragmentShader);
+			std::cout << "Program linking failed: " << fragmentPath << std::endl;
+		}
+		glDetachShader(program, vertexShader);
+		glDetachShader(program, fragmentShader);
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		if (!linked) {
+			glDeleteProgram(program);
+			program = 0;
+			return false;
+		}
+		//core profile needs some vertex array bound even without attributes
+		glCreateVertexArrays(1, &vertexArray);
+		return true;
+	}
+
+	void FullscreenPass::draw(GLStateCache& state) {
+		if (program == 0) {
+			return;
+		}
+		state.useProgram(program);
+		state.bindVertexArray(vertexArray);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+
+	void FullscreenPass::release() {
+		glDeleteProgram(program);
+		glDeleteVertexArrays(1, &vertexArray);
+		program = vertexArray = 0;
+	}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include "GLStateCache.h"
+#include "ShaderPermutations.h"
+
+//draws one triangle covering whole viewport with given fragment shader, used for image processing passes
+//vertex shader is shared by all passes and needs no vertex data
+class FullscreenPass {
+public:
+    FullscreenPass(const std::string& fragmentPath);
+
+    //compiles and links program, false when shader is missing or broken, program stays 0 then
+    bool compile();
+    //draws with depth test and blending as they are set, inputs have to be bound already
+    //does nothing until program is compiled
+    void draw(GLStateCache& state);
+    void release();
+
+    GLuint getProgram() const { return program; }
+
+private:
+    std::string fragmentPath;
+    GLuint program = 0;
+    GLuint vertexArray = 0;
+};
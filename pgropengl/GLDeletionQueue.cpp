@@ -0,0 +1,39 @@
+#include "GLDeletionQueue.h"
+
+	void GLDeletionQueue::enqueue(GLObjectList objects) {
+		PendingDeletion deletion;
+		deletion.objects = std::move(objects);
+		deletion.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		pending.push_back(std::move(deletion));
+	}
+
+	bool GLDeletionQueue::collect() {
+		bool deleted = false;
+		//fences are signaled in order, stop at first one still pending
+		while (!pending.empty()) {
+			GLenum status = glClientWaitSync(pending.front().fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+				break;
+			}
+			deleteObjects(pending.front());
+			pending.pop_front();
+			deleted = true;
+		}
+		return deleted;
+	}
+
+	void GLDeletionQueue::flush() {
+		while (!pending.empty()) {
+			glClientWaitSync(pending.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			deleteObjects(pending.front());
+			pending.pop_front();
+		}
+	}
+
+	void GLDeletionQueue::deleteObjects(PendingDeletion& deletion) {
+		glDeleteSync(deletion.fence);
+		GLObjectList& objects = deletion.objects;
+		glDeleteVertexArrays((GLsizei)objects.vertexArrays.size(), objects.vertexArrays.data());
+		glDeleteBuffers((GLsizei)objects.buffers.size(), objects.buffers.data());
+		glDeleteTextures((GLsizei)objects.textures.size(), objects.textures.data());
+	}
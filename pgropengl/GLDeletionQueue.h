@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <deque>
+#include "mesh.h"
+
+//deletes GL objects only after GPU finished all commands issued before they were queued
+class GLDeletionQueue {
+public:
+    //GL context has to be still current when queue is destroyed
+    ~GLDeletionQueue() { flush(); }
+
+    //inserts fence behind all commands issued so far, objects are deleted once it signals
+    void enqueue(GLObjectList objects);
+    //deletes objects whose fence already signaled, never waits, call once per frame
+    //returns true when something was deleted, names of deleted objects may be reused by new ones
+    bool collect();
+    //waits for all pending fences and deletes everything, used before context is destroyed
+    void flush();
+
+    size_t getPendingCount() const { return pending.size(); }
+
+private:
+    struct PendingDeletion {
+        GLsync fence;
+        GLObjectList objects;
+    };
+
+    static void deleteObjects(PendingDeletion& deletion);
+
+    std::deque<PendingDeletion> pending;
+};
@@ -0,0 +1,152 @@
+#include "GLStateCache.h"
+#include <cstring>
+
+	void GLStateCache::useProgram(GLuint program) {
+		if (changed(this->program != program)) {
+			glUseProgram(program);
+			this->program = program;
+		}
+	}
+
+	void GLStateCache::bindVertexArray(GLuint vertexArray) {
+		if (changed(this->vertexArray != vertexArray)) {
+			glBindVertexArray(vertexArray);
+			this->vertexArray = vertexArray;
+		}
+	}
+
+	void GLStateCache::bindTexture(GLuint unit, GLuint texture) {
+		if (unit >= textures.size()) {
+			textures.resize(unit + 1, unknown);
+		}
+		if (changed(textures[unit] != texture)) {
+			glBindTextureUnit(unit, texture);
+			textures[unit] = texture;
+		}
+	}
+
+	void GLStateCache::setEnabled(GLenum capability, bool enabled) {
+		auto found = capabilities.find(capability);
+		if (changed(found == capabilities.end() || found->second != enabled)) {
+			if (enabled) {
+				glEnable(capability);
+			}
+			else {
+				glDisable(capability);
+			}
+			capabilities[capability] = enabled;
+		}
+	}
+
+	void GLStateCache::blendFunc(GLenum sourceFactor, GLenum destinationFactor) {
+		if (changed(blendSource != sourceFactor || blendDestination != destinationFactor)) {
+			glBlendFunc(sourceFactor, destinationFactor);
+			blendSource = sourceFactor;
+			blendDestination = destinationFactor;
+		}
+	}
+
+	void GLStateCache::depthFunc(GLenum function) {
+		if (changed(depthFunction != function)) {
+			glDepthFunc(function);
+			depthFunction = function;
+		}
+	}
+
+	void GLStateCache::depthMask(bool write) {
+		if (changed(depthWrite != (int)write)) {
+			glDepthMask(write ? GL_TRUE : GL_FALSE);
+			depthWrite = write;
+		}
+	}
+
+	void GLStateCache::colorMask(bool write) {
+		if (changed(colorWrite != (int)write)) {
+			GLboolean mask = write ? GL_TRUE : GL_FALSE;
+			glColorMask(mask, mask, mask, mask);
+			colorWrite = write;
+		}
+	}
+
+	void GLStateCache::vertexAttrib3f(GLuint index, const glm::vec3& value) {
+		auto found = vertexAttribs.find(index);
+		if (changed(found == vertexAttribs.end() || found->second != glm::vec4(value, 1.f))) {
+			glVertexAttrib3fv(index, &value[0]);
+			vertexAttribs[index] = glm::vec4(value, 1.f);
+		}
+	}
+
+	void GLStateCache::vertexAttrib4f(GLuint index, const glm::vec4& value) {
+		auto found = vertexAttribs.find(index);
+		if (changed(found == vertexAttribs.end() || found->second != value)) {
+			glVertexAttrib4fv(index, &value[0]);
+			vertexAttribs[index] = value;
+		}
+	}
+
+	void GLStateCache::forgetVertexAttrib(GLuint index) {
+		vertexAttribs.erase(index);
+	}
+
+	void GLStateCache::forgetVertexAttribs() {
+		vertexAttribs.clear();
+	}
+
+	void GLStateCache::bindUniformBuffer(GLuint index, GLuint buffer) {
+		auto found = uniformBuffers.find(index);
+		if (changed(found == uniformBuffers.end() || found->second != buffer)) {
+			glBindBufferBase(GL_UNIFORM_BUFFER, index, buffer);
+			uniformBuffers[index] = buffer;
+		}
+	}
+
+	void GLStateCache::bindStorageBuffer(GLuint index, GLuint buffer) {
+		auto found = storageBuffers.find(index);
+		if (changed(found == storageBuffers.end() || found->second != buffer)) {
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, buffer);
+			storageBuffers[index] = buffer;
+		}
+	}
+
+	void GLStateCache::bufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) {
+		std::vector<unsigned char>& contents = bufferContents[buffer];
+		bool same = contents.size() >= (size_t)(offset + size) && std::memcmp(contents.data() + offset, data, size) == 0;
+		if (changed(!same)) {
+			glNamedBufferSubData(buffer, offset, size, data);
+			if (contents.size() < (size_t)(offset + size)) {
+				contents.resize(offset + size);
+			}
+			std::memcpy(contents.data() + offset, data, size);
+		}
+	}
+
+	void GLStateCache::invalidate() {
+		program = unknown;
+		vertexArray = unknown;
+		textures.clear();
+		capabilities.clear();
+		blendSource = blendDestination = unknown;
+		depthFunction = unknown;
+		depthWrite = -1;
+		colorWrite = -1;
+		vertexAttribs.clear();
+		uniformBuffers.clear();
+		storageBuffers.clear();
+		bufferContents.clear();
+	}
+
+	void GLStateCache::endFrame() {
+		lastIssued = issued;
+		lastSkipped = skipped;
+		issued = skipped = 0;
+	}
+
+	bool GLStateCache::changed(bool isChanged) {
+		if (isChanged) {
+			issued++;
+		}
+		else {
+			skipped++;
+		}
+		return isChanged;
+	}
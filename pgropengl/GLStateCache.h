@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+//remembers GL state set through it and skips calls which would not change anything
+//state changed directly by other code has to be forgotten by invalidate()
+//imgui backend restores state it changes, so it does not need invalidation
+class GLStateCache {
+public:
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+    void bindTexture(GLuint unit, GLuint texture);
+    void setEnabled(GLenum capability, bool enabled);
+    void blendFunc(GLenum sourceFactor, GLenum destinationFactor);
+    void depthFunc(GLenum function);
+    void depthMask(bool write);
+    void colorMask(bool write);
+    //current value of attribute not sourced from buffer
+    void vertexAttrib3f(GLuint index, const glm::vec3& value);
+    void vertexAttrib4f(GLuint index, const glm::vec4& value);
+    //forgets current value of attribute, next call for it is issued
+    //value is undefined after draw reading attribute from enabled array and can be changed by code not using cache
+    void forgetVertexAttrib(GLuint index);
+    void forgetVertexAttribs();
+    void bindUniformBuffer(GLuint index, GLuint buffer);
+    void bindStorageBuffer(GLuint index, GLuint buffer);
+    //updates buffer only when data differ from last update through cache, meant for small uniform buffers
+    void bufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data);
+
+    //forgets all state, next call of every kind is issued
+    void invalidate();
+    //keeps counters of finished frame for display and starts counting again
+    void endFrame();
+
+    unsigned int getIssuedCount() const { return lastIssued; }
+    unsigned int getSkippedCount() const { return lastSkipped; }
+
+private:
+    //counts call and tells whether it has to be issued
+    bool changed(bool isChanged);
+
+    static const GLuint unknown = 0xFFFFFFFF;
+    GLuint program = unknown;
+    GLuint vertexArray = unknown;
+    std::vector<GLuint> textures;
+    std::unordered_map<GLenum, bool> capabilities;
+    GLenum blendSource = unknown;
+    GLenum blendDestination = unknown;
+    GLenum depthFunction = unknown;
+    int depthWrite = -1;
+    int colorWrite = -1;
+    //3 component values are stored with w = 1 as GL does
+    std::unordered_map<GLuint, glm::vec4> vertexAttribs;
+    std::unordered_map<GLuint, GLuint> uniformBuffers;
+    std::unordered_map<GLuint, GLuint> storageBuffers;
+    std::unordered_map<GLuint, std::vector<unsigned char>> bufferContents;
+
+    unsigned int issued = 0;
+    unsigned int skipped = 0;
+    unsigned int lastIssued = 0;
+    unsigned int lastSkipped = 0;
+};
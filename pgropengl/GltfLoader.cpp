@@ -0,0 +1,694 @@
+#include "GltfLoader.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+
+//parsed json document, objects keep member order of file
+struct JsonValue {
+	enum Type { Null, Bool, Number, String, Array, Object };
+	Type type = Null;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> items;
+	std::vector<std::pair<std::string, JsonValue>> members;
+
+	//missing members and items are null
+	const JsonValue& operator[](const char* key) const {
+		static const JsonValue null;
+		for (const auto& member : members) {
+			if (member.first == key) {
+				return member.second;
+			}
+		}
+		return null;
+	}
+
+	const JsonValue& operator[](size_t index) const {
+		static const JsonValue null;
+		return index < items.size() ? items[index] : null;
+	}
+
+	//indices from index() are -1 when missing, literal indices would be ambiguous between key and index otherwise
+	const JsonValue& operator[](int index) const {
+		static const JsonValue null;
+		return index >= 0 ? (*this)[(size_t)index] : null;
+	}
+
+	bool isNull() const { return type == Null; }
+	size_t size() const { return type == Array ? items.size() : members.size(); }
+	double numberOr(double fallback) const { return type == Number ? number : fallback; }
+	//index into other top level array, -1 when missing
+	int index() const { return type == Number ? (int)number : -1; }
+};
+
+//recursive descent over text of json chunk, no copy of document is made before values are built
+class JsonParser {
+public:
+	JsonParser(const char* begin, const char* end) : p(begin), end(end) {}
+
+	bool parse(JsonValue& value) {
+		return parseValue(value, 0) && (skipBlanks(), p == end);
+	}
+
+private:
+	//glTF documents are shallow, deeper nesting means broken file
+	static const int maxDepth = 64;
+	const char* p;
+	const char* end;
+
+	void skipBlanks() {
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+			p++;
+		}
+	}
+
+	bool literal(const char* text) {
+		size_t length = std::strlen(text);
+		if ((size_t)(end - p) < length || std::memcmp(p, text, length) != 0) {
+			return false;
+		}
+		p += length;
+		return true;
+	}
+
+	bool parseValue(JsonValue& value, int depth) {
+		skipBlanks();
+		if (p >= end || depth > maxDepth) {
+			return false;
+		}
+		switch (*p) {
+		case '{': return parseObject(value, depth);
+		case '[': return parseArray(value, depth);
+		case '"': value.type = JsonValue::String; return parseString(value.string);
+		case 't': value.type = JsonValue::Bool; value.boolean = true; return literal("true");
+		case 'f': value.type = JsonValue::Bool; value.boolean = false; return literal("false");
+		case 'n': value.type = JsonValue::Null; return literal("null");
+		default: {
+			value.type = JsonValue::Number;
+			std::from_chars_result result = std::from_chars(p, end, value.number);
+			if (result.ec != std::errc()) {
+				return false;
+			}
+			p = result.ptr;
+			return true;
+		}
+		}
+	}
+
+	bool parseObject(JsonValue& value, int depth) {
+		value.type = JsonValue::Object;
+		p++;
+		skipBlanks();
+		if (p < end && *p == '}') {
+			p++;
+			return true;
+		}
+		while (true) {
+			skipBlanks();
+			std::pair<std::string, JsonValue> member;
+			if (p >= end || *p != '"' || !parseString(member.first)) {
+				return false;
+			}
+			skipBlanks();
+			if (p >= end || *p++ != ':' || !parseValue(member.second, depth + 1)) {
+				return false;
+			}
+			value.members.push_back(std::move(member));
+			skipBlanks();
+			if (p < end && *p == ',') {
+				p++;
+				continue;
+			}
+			return p < end && *p++ == '}';
+		}
+	}
+
+	bool parseArray(JsonValue& value, int depth) {
+		value.type = JsonValue::Array;
+		p++;
+		skipBlanks();
+		if (p < end && *p == ']') {
+			p++;
+			return true;
+		}
+		while (true) {
+			value.items.emplace_back();
+			if (!parseValue(value.items.back(), depth + 1)) {
+				return false;
+			}
+			skipBlanks();
+			if (p < end && *p == ',') {
+				p++;
+				continue;
+			}
+			return p < end && *p++ == ']';
+		}
+	}
+
+	static void appendUtf8(std::string& text, uint32_t code) {
+		if (code < 0x80) {
+			text += (char)code;
+		}
+		else if (code < 0x800) {
+			text += (char)(0xC0 | (code >> 6));
+			text += (char)(0x80 | (code & 0x3F));
+		}
+		else if (code < 0x10000) {
+			text += (char)(0xE0 | (code >> 12));
+			text += (char)(0x80 | ((code >> 6) & 0x3F));
+			text += (char)(0x80 | (code & 0x3F));
+		}
+		else {
+			text += (char)(0xF0 | (code >> 18));
+			text += (char)(0x80 | ((code >> 12) & 0x3F));
+			text += (char)(0x80 | ((code >> 6) & 0x3F));
+			text += (char)(0x80 | (code & 0x3F));
+		}
+	}
+
+	bool parseHex(uint32_t& code) {
+		if (end - p < 4) {
+			return false;
+		}
+		std::from_chars_result result = std::from_chars(p, p + 4, code, 16);
+		if (result.ptr != p + 4) {
+			return false;
+		}
+		p += 4;
+		return true;
+	}
+
+	bool parseString(std::string& text) {
+		p++;
+		while (p < end && *p != '"') {
+			if (*p != '\\') {
+				text += *p++;
+				continue;
+			}
+			if (++p >= end) {
+				return false;
+			}
+			char escaped = *p++;
+			switch (escaped) {
+			case 'b': text += '\b'; break;
+			case 'f': text += '\f'; break;
+			case 'n': text += '\n'; break;
+			case 'r': text += '\r'; break;
+			case 't': text += '\t'; break;
+			case 'u': {
+				uint32_t code;
+				if (!parseHex(code)) {
+					return false;
+				}
+				//surrogate pair
+				if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+					p += 2;
+					uint32_t low;
+					if (!parseHex(low)) {
+						return false;
+					}
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				}
+				appendUtf8(text, code);
+				break;
+			}
+			default: text += escaped; break;
+			}
+		}
+		if (p >= end) {
+			return false;
+		}
+		p++;
+		return true;
+	}
+};
+
+//glb container, json chunk and optional binary chunk used by buffer without uri
+static const uint32_t glbMagic = 0x46546C67;
+static const uint32_t glbJsonChunk = 0x4E4F534A;
+static const uint32_t glbBinaryChunk = 0x004E4942;
+
+static uint32_t readUint32(const unsigned char* data) {
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool hasExtension(const std::string& path, const char* extension) {
+	size_t length = std::strlen(extension);
+	if (path.size() < length) {
+		return false;
+	}
+	for (size_t i = 0; i < length; i++) {
+		if (std::tolower((unsigned char)path[path.size() - length + i]) != extension[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//uris are relative references with percent encoded characters
+static std::string decodeUri(const std::string& uri) {
+	std::string decoded;
+	for (size_t i = 0; i < uri.size(); i++) {
+		unsigned int code;
+		if (uri[i] == '%' && i + 2 < uri.size() && std::from_chars(uri.data() + i + 1, uri.data() + i + 3, code, 16).ptr == uri.data() + i + 3) {
+			decoded += (char)code;
+			i += 2;
+		}
+		else {
+			decoded += uri[i];
+		}
+	}
+	return decoded;
+}
+
+static GLint componentCount(const std::string& type) {
+	static const struct {
+		const char* name;
+		GLint count;
+	} types[] = { { "SCALAR", 1 }, { "VEC2", 2 }, { "VEC3", 3 }, { "VEC4", 4 } };
+	for (const auto& entry : types) {
+		if (type == entry.name) {
+			return entry.count;
+		}
+	}
+	return 0;
+}
+
+//gltf component types are GL enums
+static size_t componentBytes(GLenum type) {
+	switch (type) {
+	case GL_BYTE:
+	case GL_UNSIGNED_BYTE:
+		return 1;
+	case GL_SHORT:
+	case GL_UNSIGNED_SHORT:
+		return 2;
+	case GL_UNSIGNED_INT:
+	case GL_FLOAT:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+static glm::mat4 nodeTransform(const JsonValue& node) {
+	const JsonValue& matrix = node["matrix"];
+	if (matrix.size() == 16) {
+		float values[16];
+		for (size_t i = 0; i < 16; i++) {
+			values[i] = (float)matrix[i].numberOr(0.0);
+		}
+		//column major like glm
+		return glm::make_mat4(values);
+	}
+	glm::mat4 transform(1.f);
+	const JsonValue& translation = node["translation"];
+	if (translation.size() == 3) {
+		transform = glm::translate(transform, glm::vec3((float)translation[0].numberOr(0.0), (float)translation[1].numberOr(0.0), (float)translation[2].numberOr(0.0)));
+	}
+	const JsonValue& rotation = node["rotation"];
+	if (rotation.size() == 4) {
+		//stored as x, y, z, w
+		glm::quat quaternion((float)rotation[3].numberOr(1.0), (float)rotation[0].numberOr(0.0), (float)rotation[1].numberOr(0.0), (float)rotation[2].numberOr(0.0));
+		transform *= glm::mat4_cast(quaternion);
+	}
+	const JsonValue& scale = node["scale"];
+	if (scale.size() == 3) {
+		transform = glm::scale(transform, glm::vec3((float)scale[0].numberOr(1.0), (float)scale[1].numberOr(1.0), (float)scale[2].numberOr(1.0)));
+	}
+	return transform;
+}
+
+//gltf document with its buffers mapped, resolves accessors to byte ranges
+class GltfDocument {
+public:
+	JsonValue root;
+	std::string unsupported;
+
+	bool mapBuffers(const std::string& directory, std::shared_ptr<MappedFile> glb, const unsigned char* glbBinary, size_t glbBinarySize, MappedFileCache* cache) {
+		const JsonValue& bufferList = root["buffers"];
+		for (size_t i = 0; i < bufferList.size(); i++) {
+			const JsonValue& buffer = bufferList[i];
+			Buffer mapped;
+			if (buffer["uri"].isNull()) {
+				if (!glbBinary) {
+					unsupported = "buffer without data";
+					return false;
+				}
+				mapped.file = glb;
+				mapped.data = glbBinary;
+				mapped.size = glbBinarySize;
+			}
+			else {
+				const std::string& uri = buffer["uri"].string;
+				if (uri.compare(0, 5, "data:") == 0) {
+					unsupported = "data uri buffer";
+					return false;
+				}
+				mapped.file = MapFile(directory + decodeUri(uri), cache);
+				if (!mapped.file) {
+					unsupported = "missing buffer " + uri;
+					return false;
+				}
+				mapped.data = mapped.file->data();
+				mapped.size = mapped.file->size();
+			}
+			if (mapped.size < (size_t)buffer["byteLength"].numberOr(0.0)) {
+				unsupported = "truncated buffer";
+				return false;
+			}
+			buffers.push_back(mapped);
+		}
+		return true;
+	}
+
+	//byte position of accessor in its buffer, buffer index and layout, false when accessor cannot be read as it is
+	bool resolveAccessor(int accessorIndex, int& buffer, size_t& offset, MeshSourceAttribute& layout, size_t& count) {
+		const JsonValue& accessor = root["accessors"][accessorIndex];
+		if (accessorIndex < 0 || accessor.isNull()) {
+			unsupported = "missing accessor";
+			return false;
+		}
+		if (!accessor["sparse"].isNull() || accessor["bufferView"].index() < 0) {
+			unsupported = "sparse accessor";
+			return false;
+		}
+		const JsonValue& view = root["bufferViews"][accessor["bufferView"].index()];
+		buffer = view["buffer"].index();
+		layout.type = (GLenum)accessor["componentType"].numberOr(0.0);
+		layout.size = componentCount(accessor["type"].string);
+		layout.normalized = accessor["normalized"].boolean ? GL_TRUE : GL_FALSE;
+		size_t elementBytes = componentBytes(layout.type) * layout.size;
+		layout.stride = (GLsizei)view["byteStride"].numberOr((double)elementBytes);
+		count = (size_t)accessor["count"].numberOr(0.0);
+		offset = (size_t)view["byteOffset"].numberOr(0.0) + (size_t)accessor["byteOffset"].numberOr(0.0);
+		size_t viewEnd = (size_t)view["byteOffset"].numberOr(0.0) + (size_t)view["byteLength"].numberOr(0.0);
+		if (buffer < 0 || (size_t)buffer >= buffers.size() || elementBytes == 0 || count == 0 ||
+			offset + (count - 1) * layout.stride + elementBytes > std::min(viewEnd, buffers[buffer].size)) {
+			unsupported = "invalid accessor";
+			return false;
+		}
+		return true;
+	}
+
+	//accessors of primitive have to be in one buffer, close ones share range, like interleaved or consecutive attributes
+	std::shared_ptr<MeshSource> primitiveSource(const JsonValue& primitive, int texCoordSet) {
+		const JsonValue& attributes = primitive["attributes"];
+		if (primitive["mode"].numberOr(4.0) != 4.0) {
+			unsupported = "non-triangle primitive";
+			return nullptr;
+		}
+		if (attributes["POSITION"].isNull() || attributes["NORMAL"].isNull() || primitive["indices"].isNull()) {
+			unsupported = "primitive without positions, normals or indices";
+			return nullptr;
+		}
+		auto source = std::make_shared<MeshSource>();
+		struct Use {
+			size_t offset;
+			size_t end;
+			MeshSourceAttribute* attribute;
+		};
+		std::vector<Use> uses;
+		int primitiveBuffer = -1;
+		const std::string texCoordName = "TEXCOORD_" + std::to_string(texCoordSet);
+		const std::pair<const char*, MeshSourceAttribute*> vertexAttributes[] = {
+			{ "POSITION", &source->position }, { "NORMAL", &source->normal }, { texCoordName.c_str(), &source->texCoords } };
+		for (const auto& entry : vertexAttributes) {
+			if (attributes[entry.first].isNull()) {
+				continue;
+			}
+			int buffer;
+			size_t offset, count;
+			if (!resolveAccessor(attributes[entry.first].index(), buffer, offset, *entry.second, count)) {
+				return nullptr;
+			}
+			if (primitiveBuffer >= 0 && buffer != primitiveBuffer) {
+				unsupported = "primitive spanning more buffers";
+				return nullptr;
+			}
+			primitiveBuffer = buffer;
+			source->vertexCount = source->vertexCount == 0 ? count : std::min(source->vertexCount, count);
+			uses.push_back({ offset, offset + (count - 1) * entry.second->stride + componentBytes(entry.second->type) * entry.second->size, entry.second });
+		}
+		if (source->position.type != GL_FLOAT || source->position.size != 3 || source->normal.type != GL_FLOAT || source->normal.size != 3) {
+			unsupported = "quantized positions or normals";
+			return nullptr;
+		}
+		std::sort(uses.begin(), uses.end(), [](const Use& a, const Use& b) { return a.offset < b.offset; });
+		for (const auto& use : uses) {
+			if (source->ranges.empty() || use.offset > source->ranges.back().offset + source->ranges.back().size) {
+				source->ranges.push_back({ use.offset, 0 });
+			}
+			MeshSourceRange& range = source->ranges.back();
+			range.size = std::max(range.size, use.end - range.offset);
+			use.attribute->range = (int)source->ranges.size() - 1;
+			use.attribute->offset = use.offset - range.offset;
+		}
+
+		int buffer;
+		size_t offset, count;
+		MeshSourceAttribute indexLayout;
+		if (!resolveAccessor(primitive["indices"].index(), buffer, offset, indexLayout, count)) {
+			return nullptr;
+		}
+		if (buffer != primitiveBuffer) {
+			unsupported = "primitive spanning more buffers";
+			return nullptr;
+		}
+		if (indexLayout.size != 1 || (indexLayout.type != GL_UNSIGNED_BYTE && indexLayout.type != GL_UNSIGNED_SHORT && indexLayout.type != GL_UNSIGNED_INT)) {
+			unsupported = "invalid index accessor";
+			return nullptr;
+		}
+		//indices are only read, GPU must not fetch vertices past end of buffers
+		const unsigned char* indexData = buffers[buffer].data + offset;
+		for (size_t i = 0; i < count; i++) {
+			uint32_t index = indexLayout.type == GL_UNSIGNED_BYTE ? indexData[i] :
+				indexLayout.type == GL_UNSIGNED_SHORT ? ((const uint16_t*)indexData)[i] : ((const uint32_t*)indexData)[i];
+			if (index >= source->vertexCount) {
+				unsupported = "index out of range";
+				return nullptr;
+			}
+		}
+		source->indexType = indexLayout.type;
+		source->indexCount = count;
+		source->indexRange = (int)source->ranges.size();
+		source->ranges.push_back({ offset, count * componentBytes(indexLayout.type) });
+		source->data = buffers[buffer].data;
+		source->owner = buffers[buffer].file;
+
+		const JsonValue& accessor = root["accessors"][attributes["POSITION"].index()];
+		const JsonValue& boundsMin = accessor["min"];
+		const JsonValue& boundsMax = accessor["max"];
+		if (boundsMin.size() != 3 || boundsMax.size() != 3) {
+			unsupported = "position accessor without bounds";
+			return nullptr;
+		}
+		for (int i = 0; i < 3; i++) {
+			source->boundsMin[i] = (float)boundsMin[i].numberOr(0.0);
+			source->boundsMax[i] = (float)boundsMax[i].numberOr(0.0);
+		}
+		return source;
+	}
+
+private:
+	struct Buffer {
+		std::shared_ptr<MappedFile> file;
+		const unsigned char* data = nullptr;
+		size_t size = 0;
+	};
+	std::vector<Buffer> buffers;
+};
+
+bool IsGltfPath(const std::string& path) {
+	return hasExtension(path, ".gltf") || hasExtension(path, ".glb");
+}
+
+bool LoadGltf(const std::string& path, GltfScene& scene, std::string& unsupported, GltfLoadStats* stats, MappedFileCache* cache) {
+	auto start = std::chrono::steady_clock::now();
+	std::shared_ptr<MappedFile> file = MapFile(path, cache);
+	if (!file) {
+		unsupported = "cannot open file";
+		return false;
+	}
+	const char* json = (const char*)file->data();
+	size_t jsonSize = file->size();
+	const unsigned char* glbBinary = nullptr;
+	size_t glbBinarySize = 0;
+	if (file->size() >= 20 && readUint32(file->data()) == glbMagic) {
+		//header is magic, version and length, chunks follow with length and type each
+		size_t length = std::min<size_t>(readUint32(file->data() + 8), file->size());
+		size_t position = 12;
+		json = nullptr;
+		while (position + 8 <= length) {
+			uint32_t chunkLength = readUint32(file->data() + position);
+			uint32_t chunkType = readUint32(file->data() + position + 4);
+			if (position + 8 + chunkLength > length) {
+				break;
+			}
+			if (chunkType == glbJsonChunk && !json) {
+				json = (const char*)file->data() + position + 8;
+				jsonSize = chunkLength;
+			}
+			else if (chunkType == glbBinaryChunk && !glbBinary) {
+				glbBinary = file->data() + position + 8;
+				glbBinarySize = chunkLength;
+			}
+			position += 8 + ((chunkLength + 3) & ~3u);
+		}
+		if (!json) {
+			unsupported = "glb without json chunk";
+			return false;
+		}
+	}
+
+	GltfDocument document;
+	if (!JsonParser(json, json + jsonSize).parse(document.root)) {
+		unsupported = "invalid json";
+		return false;
+	}
+	double parseMs = millisecondsSince(start);
+	const JsonValue& root = document.root;
+	if (root["asset"]["version"].string.compare(0, 1, "2") != 0) {
+		unsupported = "not gltf 2.0";
+		return false;
+	}
+	const JsonValue& required = root["extensionsRequired"];
+	if (required.size() > 0) {
+		unsupported = "required extension " + required[0].string;
+		return false;
+	}
+	std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+	if (!document.mapBuffers(directory, file, glbBinary, glbBinarySize, cache)) {
+		unsupported = document.unsupported;
+		return false;
+	}
+
+	//material lookups of assimp conversion, baseColorFactor gives diffuse color and opacity
+	struct Material {
+		glm::vec4 color = glm::vec4(1.f);
+		std::string texture;
+		int texCoordSet = 0;
+	};
+	std::vector<Material> materials(root["materials"].size());
+	for (size_t i = 0; i < materials.size(); i++) {
+		const JsonValue& pbr = root["materials"][i]["pbrMetallicRoughness"];
+		const JsonValue& factor = pbr["baseColorFactor"];
+		if (factor.size() == 4) {
+			materials[i].color = glm::vec4((float)factor[0].numberOr(1.0), (float)factor[1].numberOr(1.0), (float)factor[2].numberOr(1.0), (float)factor[3].numberOr(1.0));
+		}
+		const JsonValue& baseColorTexture = pbr["baseColorTexture"];
+		if (!baseColorTexture.isNull()) {
+			const JsonValue& texture = root["textures"][baseColorTexture["index"].index()];
+			const JsonValue& image = root["images"][texture["source"].index()];
+			const std::string& uri = image["uri"].string;
+			if (image["uri"].isNull() || uri.compare(0, 5, "data:") == 0) {
+				unsupported = "embedded image";
+				return false;
+			}
+			materials[i].texture = decodeUri(uri);
+			materials[i].texCoordSet = baseColorTexture["texCoord"].index() > 0 ? baseColorTexture["texCoord"].index() : 0;
+		}
+	}
+
+	scene.meshes.clear();
+	scene.nodes.clear();
+	scene.instances.clear();
+	//meshes of every gltf mesh are made once and instanced by all nodes referring to it
+	const JsonValue& meshes = root["meshes"];
+	std::vector<std::vector<uint32_t>> meshPrimitives(meshes.size());
+	const Material defaultMaterial;
+	for (size_t i = 0; i < meshes.size(); i++) {
+		const JsonValue& primitives = meshes[i]["primitives"];
+		for (size_t j = 0; j < primitives.size(); j++) {
+			int materialIndex = primitives[j]["material"].index();
+			const Material& material = materialIndex >= 0 && (size_t)materialIndex < materials.size() ? materials[materialIndex] : defaultMaterial;
+			std::shared_ptr<MeshSource> source = document.primitiveSource(primitives[j], material.texCoordSet);
+			if (!source) {
+				unsupported = document.unsupported;
+				return false;
+			}
+			source->color = material.color;
+			Texture texture;
+			texture.path = material.texture;
+			meshPrimitives[i].push_back((uint32_t)scene.meshes.size());
+			scene.meshes.push_back(Mesh(source, texture, !material.texture.empty(), material.color.a < 1.f));
+		}
+	}
+
+	//nodes of default scene depth first under identity root, so parents come before children like SceneGraph needs
+	const JsonValue& nodes = root["nodes"];
+	std::vector<bool> visited(nodes.size(), false);
+	std::vector<std::pair<int, int>> stack;
+	int rootNode = scene.nodes.addNode(-1, glm::mat4(1.f));
+	const JsonValue& scenes = root["scenes"];
+	if (scenes.size() > 0) {
+		//first scene is shown when file does not choose one
+		const JsonValue& roots = scenes[std::max(0, root["scene"].index())]["nodes"];
+		if (roots.size() == 0) {
+			unsupported = "scene without nodes";
+			return false;
+		}
+		for (size_t i = roots.size(); i-- > 0;) {
+			stack.push_back({ roots[i].index(), rootNode });
+		}
+	}
+	else {
+		//without scenes, nodes which are nobody's child are roots
+		std::vector<bool> isChild(nodes.size(), false);
+		for (size_t i = 0; i < nodes.size(); i++) {
+			for (const auto& child : nodes[i]["children"].items) {
+				if (child.index() >= 0 && (size_t)child.index() < nodes.size()) {
+					isChild[child.index()] = true;
+				}
+			}
+		}
+		for (size_t i = nodes.size(); i-- > 0;) {
+			if (!isChild[i]) {
+				stack.push_back({ (int)i, rootNode });
+			}
+		}
+	}
+	while (!stack.empty()) {
+		auto [nodeIndex, parent] = stack.back();
+		stack.pop_back();
+		if (nodeIndex < 0 || (size_t)nodeIndex >= nodes.size() || visited[nodeIndex]) {
+			continue;
+		}
+		visited[nodeIndex] = true;
+		const JsonValue& node = nodes[(size_t)nodeIndex];
+		int index = scene.nodes.addNode(parent, nodeTransform(node));
+		int mesh = node["mesh"].index();
+		if (mesh >= 0 && (size_t)mesh < meshPrimitives.size()) {
+			for (uint32_t primitive : meshPrimitives[mesh]) {
+				scene.instances.push_back({ (uint32_t)index, primitive });
+			}
+		}
+		const JsonValue& children = node["children"];
+		for (size_t i = children.size(); i-- > 0;) {
+			stack.push_back({ children[i].index(), index });
+		}
+	}
+	scene.nodes.update();
+
+	if (stats) {
+		stats->jsonBytes = jsonSize;
+		stats->mappedBytes = 0;
+		for (const auto& mesh : scene.meshes) {
+			stats->mappedBytes += mesh.dataBytes();
+		}
+		stats->primitives = scene.meshes.size();
+		stats->parseMs = parseMs;
+		stats->totalMs = millisecondsSince(start);
+	}
+	return true;
+}
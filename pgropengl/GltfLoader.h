@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mesh.h"
+#include "SceneGraph.h"
+#include "MappedFileCache.h"
+
+//mesh drawn at node of gltf scene
+struct GltfMeshInstance {
+    uint32_t node;
+    uint32_t mesh;
+};
+
+//every gltf primitive becomes one mesh drawn from mapped buffer data, node transforms stay in hierarchy since vertices are never touched
+struct GltfScene {
+    std::vector<Mesh> meshes;
+    SceneGraph nodes;
+    std::vector<GltfMeshInstance> instances;
+};
+
+struct GltfLoadStats {
+    size_t jsonBytes = 0;
+    //bytes of buffer data meshes upload as they are
+    size_t mappedBytes = 0;
+    size_t primitives = 0;
+    double parseMs = 0.0;
+    double totalMs = 0.0;
+};
+
+//true for .gltf and .glb extensions in any case
+bool IsGltfPath(const std::string& path);
+
+//loads gltf 2.0 (.gltf with external buffers or .glb) without assimp: json is parsed once, buffers are mapped through cache when given
+//and every primitive refers to byte ranges of its accessors, which upload copies into GL buffers as they are with formats of accessors
+//color and opacity come from baseColorFactor and diffuse texture from baseColorTexture, like assimp material conversion
+//returns false and reason when file needs what meshes in mapped data cannot do (required extensions, sparse accessors,
+//embedded or data uri images and buffers, missing normals or indices, other than triangle primitives), caller falls back to assimp
+bool LoadGltf(const std::string& path, GltfScene& scene, std::string& unsupported, GltfLoadStats* stats = nullptr, MappedFileCache* cache = nullptr);
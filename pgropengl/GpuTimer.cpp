@@ -0,0 +1,65 @@
+#include "GpuTimer.h"
+
+	GpuTimer::GpuTimer(int latency) : queries(latency) {
+	}
+
+	void GpuTimer::begin(int tag) {
+		Query& query = queries[next];
+		//all queries in flight, this measurement is skipped rather than waiting
+		if (query.pending) {
+			active = -1;
+			return;
+		}
+		if (query.start == 0) {
+			glCreateQueries(GL_TIMESTAMP, 1, &query.start);
+			glCreateQueries(GL_TIMESTAMP, 1, &query.end);
+		}
+		query.tag = tag;
+		glQueryCounter(query.start, GL_TIMESTAMP);
+		active = (int)next;
+		next = (next + 1) % queries.size();
+	}
+
+	void GpuTimer::end() {
+		if (active < 0) {
+			return;
+		}
+		glQueryCounter(queries[active].end, GL_TIMESTAMP);
+		queries[active].pending = true;
+		active = -1;
+	}
+
+	bool GpuTimer::poll() {
+		bool updated = false;
+		//oldest query first, so latest result wins
+		for (size_t i = 0; i < queries.size(); i++) {
+			Query& query = queries[(next + i) % queries.size()];
+			if (!query.pending) {
+				continue;
+			}
+			GLint available = GL_FALSE;
+			//end timestamp is written last, start is available by then
+			glGetQueryObjectiv(query.end, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				continue;
+			}
+			GLuint64 startNanoseconds = 0, endNanoseconds = 0;
+			glGetQueryObjectui64v(query.start, GL_QUERY_RESULT, &startNanoseconds);
+			glGetQueryObjectui64v(query.end, GL_QUERY_RESULT, &endNanoseconds);
+			milliseconds = (endNanoseconds - startNanoseconds) / 1000000.0;
+			tag = query.tag;
+			query.pending = false;
+			updated = true;
+		}
+		return updated;
+	}
+
+	void GpuTimer::release() {
+		for (auto& query : queries) {
+			if (query.start != 0) {
+				glDeleteQueries(1, &query.start);
+				glDeleteQueries(1, &query.end);
+			}
+			query = Query();
+		}
+	}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+//measures GPU time of commands between begin and end with timestamp queries, so measured ranges may nest
+//results are read a few frames later, so measuring never stalls the pipeline
+class GpuTimer {
+public:
+    GpuTimer(int latency = 4);
+
+    //tag is returned with result, it tells which configuration was measured
+    void begin(int tag = 0);
+    void end();
+    //reads finished queries, returns true when new result arrived
+    bool poll();
+    //call before GL context is destroyed
+    void release();
+
+    //latest finished measurement
+    double getMilliseconds() const { return milliseconds; }
+    int getTag() const { return tag; }
+
+private:
+    struct Query {
+        GLuint start = 0;
+        GLuint end = 0;
+        int tag = 0;
+        bool pending = false;
+    };
+
+    std::vector<Query> queries;
+    size_t next = 0;
+    //query of current begin/end pair, -1 when all queries were still pending
+    int active = -1;
+    double milliseconds = 0.0;
+    int tag = 0;
+};
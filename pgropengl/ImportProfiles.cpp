@@ -0,0 +1,258 @@
+#include "ImportProfiles.h"
+#include <assimp/config.h>
+#include <assimp/postprocess.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+//names in profile file are aiProcess_ and aiComponent_ names without prefix
+static const struct {
+	const char* name;
+	unsigned int flag;
+} processNames[] = {
+	{ "CalcTangentSpace", aiProcess_CalcTangentSpace },
+	{ "JoinIdenticalVertices", aiProcess_JoinIdenticalVertices },
+	{ "MakeLeftHanded", aiProcess_MakeLeftHanded },
+	{ "Triangulate", aiProcess_Triangulate },
+	{ "GenNormals", aiProcess_GenNormals },
+	{ "GenSmoothNormals", aiProcess_GenSmoothNormals },
+	{ "SplitLargeMeshes", aiProcess_SplitLargeMeshes },
+	{ "PreTransformVertices", aiProcess_PreTransformVertices },
+	{ "LimitBoneWeights", aiProcess_LimitBoneWeights },
+	{ "ValidateDataStructure", aiProcess_ValidateDataStructure },
+	{ "ImproveCacheLocality", aiProcess_ImproveCacheLocality },
+	{ "RemoveRedundantMaterials", aiProcess_RemoveRedundantMaterials },
+	{ "FixInfacingNormals", aiProcess_FixInfacingNormals },
+	{ "SortByPType", aiProcess_SortByPType },
+	{ "FindDegenerates", aiProcess_FindDegenerates },
+	{ "FindInvalidData", aiProcess_FindInvalidData },
+	{ "GenUVCoords", aiProcess_GenUVCoords },
+	{ "FindInstances", aiProcess_FindInstances },
+	{ "OptimizeMeshes", aiProcess_OptimizeMeshes },
+	{ "OptimizeGraph", aiProcess_OptimizeGraph },
+	{ "FlipUVs", aiProcess_FlipUVs },
+	{ "FlipWindingOrder", aiProcess_FlipWindingOrder },
+	{ "DropNormals", aiProcess_DropNormals },
+	{ "GenBoundingBoxes", aiProcess_GenBoundingBoxes },
+};
+
+static const struct {
+	const char* name;
+	unsigned int component;
+} componentNames[] = {
+	{ "Normals", aiComponent_NORMALS },
+	{ "TangentsAndBitangents", aiComponent_TANGENTS_AND_BITANGENTS },
+	{ "Colors", aiComponent_COLORS },
+	{ "TexCoords", aiComponent_TEXCOORDS },
+	{ "BoneWeights", aiComponent_BONEWEIGHTS },
+	{ "Animations", aiComponent_ANIMATIONS },
+	{ "Textures", aiComponent_TEXTURES },
+	{ "Lights", aiComponent_LIGHTS },
+	{ "Cameras", aiComponent_CAMERAS },
+	{ "Meshes", aiComponent_MESHES },
+	{ "Materials", aiComponent_MATERIALS },
+};
+
+//only first texture coordinate set is converted to Vertex, other sets and vertex colors are never read
+static const unsigned int unusedComponents = aiComponent_TANGENTS_AND_BITANGENTS | aiComponent_COLORS | aiComponent_BONEWEIGHTS |
+	aiComponent_ANIMATIONS | aiComponent_LIGHTS | aiComponent_CAMERAS |
+	aiComponent_TEXCOORDSn(1) | aiComponent_TEXCOORDSn(2) | aiComponent_TEXCOORDSn(3);
+
+static std::string trim(const std::string& text) {
+	size_t first = text.find_first_not_of(" \t\r");
+	size_t last = text.find_last_not_of(" \t\r");
+	return first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+}
+
+static std::string extensionOf(const std::string& path) {
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos || path.find_first_of("/\\", dot) != std::string::npos) {
+		return std::string();
+	}
+	std::string extension = path.substr(dot);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	return extension;
+}
+
+//ColorsN and TexCoordsN select single set N, other names come from table
+static bool parseComponent(const std::string& name, unsigned int& component) {
+	for (const auto& entry : componentNames) {
+		if (name == entry.name) {
+			component = entry.component;
+			return true;
+		}
+	}
+	for (const char* prefix : { "Colors", "TexCoords" }) {
+		std::string prefixText = prefix;
+		if (name.size() == prefixText.size() + 1 && name.compare(0, prefixText.size(), prefixText) == 0 && name.back() >= '0' && name.back() <= '7') {
+			unsigned int set = name.back() - '0';
+			component = prefixText == "Colors" ? aiComponent_COLORSn(set) : aiComponent_TEXCOORDSn(set);
+			return true;
+		}
+	}
+	return false;
+}
+
+	ImportProfiles::ImportProfiles() {
+		unsigned int common = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs;
+		profiles.push_back({ "default", {}, common, unusedComponents });
+		//obj has none of unused components, removal step would only walk the scene
+		profiles.push_back({ "obj", { ".obj" }, common, 0 });
+		profiles.push_back({ "gltf", { ".gltf", ".glb" }, common, unusedComponents });
+		profiles.push_back({ "fbx", { ".fbx" }, common, unusedComponents });
+	}
+
+	ImportProfiles::~ImportProfiles() {
+		if (comparisonThread.joinable()) {
+			comparisonThread.join();
+		}
+	}
+
+	bool ImportProfiles::load(const std::string& path) {
+		std::ifstream file(path);
+		if (!file.is_open()) {
+			return false;
+		}
+		std::vector<ImportProfile> loaded;
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(file, line)) {
+			lineNumber++;
+			line = trim(line);
+			if (line.empty() || line[0] == '#' || line[0] == ';') {
+				continue;
+			}
+			if (line.front() == '[' && line.back() == ']') {
+				ImportProfile profile;
+				profile.name = trim(line.substr(1, line.size() - 2));
+				loaded.push_back(profile);
+				continue;
+			}
+			size_t equals = line.find('=');
+			if (loaded.empty() || equals == std::string::npos) {
+				std::cout << "Import profiles " << path << ":" << lineNumber << ": expected [profile] or key = value" << std::endl;
+				continue;
+			}
+			ImportProfile& profile = loaded.back();
+			std::string key = trim(line.substr(0, equals));
+			std::istringstream values(line.substr(equals + 1));
+			std::string value;
+			while (values >> value) {
+				bool known = true;
+				if (key == "extensions") {
+					profile.extensions.push_back(extensionOf(value[0] == '.' ? value : "." + value));
+				}
+				else if (key == "process") {
+					auto found = std::find_if(std::begin(processNames), std::end(processNames), [&value](const auto& entry) { return value == entry.name; });
+					known = found != std::end(processNames);
+					if (known) {
+						profile.processFlags |= found->flag;
+					}
+				}
+				else if (key == "remove") {
+					unsigned int component = 0;
+					known = parseComponent(value, component);
+					profile.removeComponents |= component;
+				}
+				else {
+					known = false;
+				}
+				if (!known) {
+					std::cout << "Import profiles " << path << ":" << lineNumber << ": unknown " << key << " " << value << std::endl;
+				}
+			}
+		}
+		if (loaded.empty()) {
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		profiles = std::move(loaded);
+		return true;
+	}
+
+	ImportProfile ImportProfiles::select(const std::string& path) const {
+		std::string extension = extensionOf(path);
+		std::lock_guard<std::mutex> lock(mutex);
+		const ImportProfile* fallback = nullptr;
+		for (const auto& profile : profiles) {
+			if (std::find(profile.extensions.begin(), profile.extensions.end(), extension) != profile.extensions.end()) {
+				return profile;
+			}
+			if (profile.name == "default") {
+				fallback = &profile;
+			}
+		}
+		if (fallback) {
+			return *fallback;
+		}
+		//flags used before profiles existed
+		return { "default", {}, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs, 0 };
+	}
+
+	const aiScene* ImportProfiles::read(Assimp::Importer& importer, const std::string& path, unsigned int addFlags, unsigned int clearFlags) {
+		return readWithProfile(importer, path, select(path), addFlags, clearFlags);
+	}
+
+	void ImportProfiles::startComparison(const std::string& path, unsigned int addFlags, unsigned int clearFlags) {
+		if (comparing) {
+			return;
+		}
+		if (comparisonThread.joinable()) {
+			comparisonThread.join();
+		}
+		comparing = true;
+		comparisonThread = std::thread([this, path, addFlags, clearFlags]() {
+			for (const auto& profile : getProfiles()) {
+				//new importer every time, so no profile profits from data cached by previous one
+				Assimp::Importer importer;
+				readWithProfile(importer, path, profile, addFlags, clearFlags);
+			}
+			comparing = false;
+		});
+	}
+
+	std::vector<ImportProfileStats> ImportProfiles::getStats() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return stats;
+	}
+
+	std::vector<ImportProfile> ImportProfiles::getProfiles() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return profiles;
+	}
+
+	const aiScene* ImportProfiles::readWithProfile(Assimp::Importer& importer, const std::string& path, const ImportProfile& profile, unsigned int addFlags, unsigned int clearFlags) {
+		unsigned int flags = (profile.processFlags | addFlags) & ~clearFlags;
+		if (profile.removeComponents != 0) {
+			importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, (int)profile.removeComponents);
+			flags |= aiProcess_RemoveComponent;
+		}
+		auto start = std::chrono::steady_clock::now();
+		const aiScene* scene = importer.ReadFile(path, flags);
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (scene) {
+			aiMemoryInfo memory;
+			importer.GetMemoryRequirements(memory);
+			record(profile.name, milliseconds, memory.total);
+			std::cout << "Imported " << path << " with profile " << profile.name << " in " << milliseconds << " ms, scene " << memory.total / 1024 << " KB" << std::endl;
+		}
+		return scene;
+	}
+
+	void ImportProfiles::record(const std::string& name, double milliseconds, size_t bytes) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto found = std::find_if(stats.begin(), stats.end(), [&name](const ImportProfileStats& entry) { return entry.name == name; });
+		if (found == stats.end()) {
+			stats.push_back(ImportProfileStats());
+			found = stats.end() - 1;
+			found->name = name;
+		}
+		found->imports++;
+		found->totalMs += milliseconds;
+		found->lastMs = milliseconds;
+		found->totalBytes += bytes;
+		found->lastBytes = bytes;
+	}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//assimp post-processing of a group of file formats
+struct ImportProfile {
+    std::string name;
+    //lower case with dot, profile without extensions is used only by its name
+    std::vector<std::string> extensions;
+    unsigned int processFlags = 0;
+    //aiComponent bits dropped by aiProcess_RemoveComponent before other steps run
+    unsigned int removeComponents = 0;
+};
+
+//import time and size of imported scene (aiMemoryInfo::total) of one profile
+struct ImportProfileStats {
+    std::string name;
+    unsigned int imports = 0;
+    double totalMs = 0.0;
+    double lastMs = 0.0;
+    size_t totalBytes = 0;
+    size_t lastBytes = 0;
+};
+
+//named sets of aiProcess flags and removed components picked by file extension, configurable in text file
+//every import through profiles is timed and its scene size measured, so profiles can be compared
+//shared by loader threads, all members are thread safe
+class ImportProfiles {
+public:
+    //built-in profiles, used until file is loaded
+    ImportProfiles();
+    ~ImportProfiles();
+
+    //replaces profiles by those in file, keeps current ones when file is missing or defines none
+    bool load(const std::string& path);
+    //first profile listing extension of path, profile named default otherwise
+    ImportProfile select(const std::string& path) const;
+    //imports file with profile of its extension, flags are adjusted by caller (e.g. pretransform depends on import mode)
+    const aiScene* read(Assimp::Importer& importer, const std::string& path, unsigned int addFlags = 0, unsigned int clearFlags = 0);
+
+    //imports file once with every profile on background thread, results are added to stats of profiles
+    void startComparison(const std::string& path, unsigned int addFlags = 0, unsigned int clearFlags = 0);
+    bool isComparing() const { return comparing; }
+    std::vector<ImportProfileStats> getStats() const;
+    std::vector<ImportProfile> getProfiles() const;
+
+private:
+    const aiScene* readWithProfile(Assimp::Importer& importer, const std::string& path, const ImportProfile& profile, unsigned int addFlags, unsigned int clearFlags);
+    void record(const std::string& name, double milliseconds, size_t bytes);
+
+    mutable std::mutex mutex;
+    std::vector<ImportProfile> profiles;
+    std::vector<ImportProfileStats> stats;
+    std::thread comparisonThread;
+    std::atomic<bool> comparing{ false };
+};
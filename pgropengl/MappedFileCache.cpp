@@ -0,0 +1,327 @@
+#include "MappedFileCache.h"
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <cstring>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+//size and modification time of file on disk, false when it does not exist
+static bool fileStatus(const std::string& path, size_t& size, int64_t& modified, uint64_t& syscalls) {
+	struct stat status;
+	syscalls++;
+	if (stat(path.c_str(), &status) != 0 || (status.st_mode & S_IFMT) != S_IFREG) {
+		return false;
+	}
+	size = (size_t)status.st_size;
+	modified = (int64_t)status.st_mtime;
+	return true;
+}
+
+//reads from mapped file, keeps it mapped while open even when cache drops it
+class MappedIOStream : public Assimp::IOStream {
+public:
+	MappedIOStream(std::shared_ptr<MappedFile> file, FileIOStats& stats) : file(std::move(file)), stats(stats) {}
+
+	size_t Read(void* pvBuffer, size_t pSize, size_t pCount) override {
+		if (pSize == 0 || pCount == 0) {
+			return 0;
+		}
+		//whole elements only, like fread
+		size_t count = std::min(pCount, (file->size() - position) / pSize);
+		size_t bytes = count * pSize;
+		if (bytes > 0) {
+			std::memcpy(pvBuffer, file->data() + position, bytes);
+		}
+		position += bytes;
+		stats.bytesRead += bytes;
+		return count;
+	}
+
+	size_t Write(const void*, size_t, size_t) override {
+		return 0;
+	}
+
+	aiReturn Seek(size_t pOffset, aiOrigin pOrigin) override {
+		size_t target;
+		switch (pOrigin) {
+		case aiOrigin_SET:
+			target = pOffset;
+			break;
+		case aiOrigin_CUR:
+			target = position + pOffset;
+			break;
+		case aiOrigin_END:
+			//offset is unsigned, importers pass negative values wrapped around
+			target = file->size() + pOffset;
+			break;
+		default:
+			return aiReturn_FAILURE;
+		}
+		if (target > file->size()) {
+			return aiReturn_FAILURE;
+		}
+		position = target;
+		return aiReturn_SUCCESS;
+	}
+
+	size_t Tell() const override {
+		return position;
+	}
+
+	size_t FileSize() const override {
+		return file->size();
+	}
+
+	void Flush() override {
+	}
+
+private:
+	std::shared_ptr<MappedFile> file;
+	FileIOStats& stats;
+	size_t position = 0;
+};
+
+	MappedFile::~MappedFile() {
+#ifdef _WIN32
+		if (bytes) {
+			UnmapViewOfFile(bytes);
+		}
+		if (mapping) {
+			CloseHandle((HANDLE)mapping);
+		}
+#else
+		if (bytes) {
+			munmap((void*)bytes, byteSize);
+		}
+#endif
+	}
+
+	std::shared_ptr<MappedFile> MappedFile::open(const std::string& path, uint64_t& syscalls) {
+		std::shared_ptr<MappedFile> file(new MappedFile());
+#ifdef _WIN32
+		syscalls++;
+		HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (handle == INVALID_HANDLE_VALUE) {
+			return nullptr;
+		}
+		LARGE_INTEGER size;
+		syscalls++;
+		bool valid = GetFileSizeEx(handle, &size) != 0;
+		file->byteSize = valid ? (size_t)size.QuadPart : 0;
+		//empty file cannot be mapped, it is served as zero bytes
+		if (valid && file->byteSize > 0) {
+			syscalls += 2;
+			file->mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			file->bytes = file->mapping ? (const unsigned char*)MapViewOfFile((HANDLE)file->mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+			valid = file->bytes != nullptr;
+		}
+		//view keeps file open, handle is not needed anymore
+		syscalls++;
+		CloseHandle(handle);
+#else
+		syscalls++;
+		int descriptor = ::open(path.c_str(), O_RDONLY);
+		if (descriptor < 0) {
+			return nullptr;
+		}
+		struct stat status;
+		syscalls++;
+		bool valid = fstat(descriptor, &status) == 0;
+		file->byteSize = valid ? (size_t)status.st_size : 0;
+		if (valid && file->byteSize > 0) {
+			syscalls++;
+			void* bytes = mmap(nullptr, file->byteSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+			valid = bytes != MAP_FAILED;
+			if (valid) {
+				file->bytes = (const unsigned char*)bytes;
+				//importers read files front to back
+				syscalls++;
+				madvise(bytes, file->byteSize, MADV_SEQUENTIAL);
+			}
+		}
+		syscalls++;
+		::close(descriptor);
+#endif
+		if (!valid) {
+			file->byteSize = 0;
+			return nullptr;
+		}
+		return file;
+	}
+
+	void MappedFile::release(size_t offset, size_t size) const {
+		if (!bytes || offset >= byteSize) {
+			return;
+		}
+		size = std::min(size, byteSize - offset);
+#ifdef _WIN32
+		//unlocking pages which are not locked removes them from working set
+		VirtualUnlock((void*)(bytes + offset), size);
+#else
+		size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+		uintptr_t begin = ((uintptr_t)(bytes + offset) + pageSize - 1) / pageSize * pageSize;
+		uintptr_t end = (uintptr_t)(bytes + offset + size) / pageSize * pageSize;
+		if (begin < end) {
+			madvise((void*)begin, end - begin, MADV_DONTNEED);
+		}
+#endif
+	}
+
+	FileIOStats& FileIOStats::operator+=(const FileIOStats& other) {
+		opens += other.opens;
+		hits += other.hits;
+		misses += other.misses;
+		bytesRead += other.bytesRead;
+		bytesMapped += other.bytesMapped;
+		syscalls += other.syscalls;
+		return *this;
+	}
+
+	MappedFileCache::MappedFileCache(size_t maxBytes) : maxBytes(maxBytes) {
+	}
+
+	std::shared_ptr<MappedFile> MappedFileCache::open(const std::string& path, FileIOStats& stats) {
+		stats.opens++;
+		size_t size = 0;
+		int64_t modified = 0;
+		if (!fileStatus(path, size, modified, stats.syscalls)) {
+			return nullptr;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto found = entries.find(path);
+			if (found != entries.end()) {
+				Entry& entry = found->second;
+				if (entry.file->size() == size && entry.modified == modified) {
+					recent.splice(recent.begin(), recent, entry.recent);
+					stats.hits++;
+					return entry.file;
+				}
+				//file changed since it was mapped
+				cachedBytes -= entry.file->size();
+				recent.erase(entry.recent);
+				entries.erase(found);
+			}
+		}
+
+		//mapped without lock, so slow disk does not block other loaders, two loaders may map same file at once
+		std::shared_ptr<MappedFile> file = MappedFile::open(path, stats.syscalls);
+		if (!file) {
+			return nullptr;
+		}
+		stats.misses++;
+		stats.bytesMapped += file->size();
+		if (file->size() > maxBytes) {
+			return file;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		auto found = entries.find(path);
+		if (found != entries.end()) {
+			cachedBytes -= found->second.file->size();
+			recent.erase(found->second.recent);
+			entries.erase(found);
+		}
+		recent.push_front(path);
+		entries[path] = { file, modified, recent.begin() };
+		cachedBytes += file->size();
+		evict();
+		return file;
+	}
+
+	bool MappedFileCache::exists(const std::string& path, FileIOStats& stats) const {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (entries.count(path)) {
+				return true;
+			}
+		}
+		size_t size;
+		int64_t modified;
+		return fileStatus(path, size, modified, stats.syscalls);
+	}
+
+	void MappedFileCache::clear() {
+		std::lock_guard<std::mutex> lock(mutex);
+		entries.clear();
+		recent.clear();
+		cachedBytes = 0;
+	}
+
+	void MappedFileCache::evict() {
+		//streams still reading evicted file keep their mapping until closed
+		while (cachedBytes > maxBytes && !recent.empty()) {
+			auto found = entries.find(recent.back());
+			cachedBytes -= found->second.file->size();
+			entries.erase(found);
+			recent.pop_back();
+		}
+	}
+
+	void MappedFileCache::record(const FileIOStats& stats) {
+		std::lock_guard<std::mutex> lock(mutex);
+		totals += stats;
+		lastImport = stats;
+	}
+
+	FileIOStats MappedFileCache::getTotals() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return totals;
+	}
+
+	FileIOStats MappedFileCache::getLastImport() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return lastImport;
+	}
+
+	size_t MappedFileCache::getCachedFiles() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return entries.size();
+	}
+
+	size_t MappedFileCache::getCachedBytes() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return cachedBytes;
+	}
+
+std::shared_ptr<MappedFile> MapFile(const std::string& path, MappedFileCache* cache) {
+	if (cache) {
+		FileIOStats stats;
+		std::shared_ptr<MappedFile> file = cache->open(path, stats);
+		cache->record(stats);
+		return file;
+	}
+	uint64_t syscalls = 0;
+	return MappedFile::open(path, syscalls);
+}
+
+	bool CachedIOSystem::Exists(const char* pFile) const {
+		return cache.exists(pFile, stats);
+	}
+
+	char CachedIOSystem::getOsSeparator() const {
+#ifdef _WIN32
+		return '\\';
+#else
+		return '/';
+#endif
+	}
+
+	Assimp::IOStream* CachedIOSystem::Open(const char* pFile, const char* pMode) {
+		if (std::strchr(pMode, 'w') || std::strchr(pMode, 'a') || std::strchr(pMode, '+')) {
+			return nullptr;
+		}
+		std::shared_ptr<MappedFile> file = cache.open(pFile, stats);
+		return file ? new MappedIOStream(file, stats) : nullptr;
+	}
+
+	void CachedIOSystem::Close(Assimp::IOStream* pFile) {
+		delete pFile;
+	}
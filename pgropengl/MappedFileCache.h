@@ -0,0 +1,108 @@
+#pragma once
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+//file mapped read only into memory, unmapped when last stream using it is closed and cache dropped it
+class MappedFile {
+public:
+    ~MappedFile();
+    //returns nullptr when file cannot be opened or mapped, syscalls made are added to counter
+    static std::shared_ptr<MappedFile> open(const std::string& path, uint64_t& syscalls);
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return byteSize; }
+    //drops pages fully inside range from memory, mapping stays valid and they are read from file again when touched
+    void release(size_t offset, size_t size) const;
+
+private:
+    MappedFile() = default;
+
+    const unsigned char* bytes = nullptr;
+    size_t byteSize = 0;
+#ifdef _WIN32
+    void* mapping = nullptr;
+#endif
+};
+
+//file operations of one import, syscalls counts calls to operating system made by cache (open, stat, map, close), not page faults
+struct FileIOStats {
+    uint64_t opens = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    //bytes copied out to importer
+    uint64_t bytesRead = 0;
+    //bytes of files mapped on misses
+    uint64_t bytesMapped = 0;
+    uint64_t syscalls = 0;
+
+    FileIOStats& operator+=(const FileIOStats& other);
+};
+
+//recently opened files kept mapped, least recently used ones are dropped once their total size exceeds limit
+//repeated imports and lookups of .mtl, .bin and other side files are served from memory
+//entry is checked against file size and modification time on every open, so edited files are mapped again
+//shared by loader threads, all members are thread safe
+class MappedFileCache {
+public:
+    explicit MappedFileCache(size_t maxBytes = 256 * 1024 * 1024);
+
+    std::shared_ptr<MappedFile> open(const std::string& path, FileIOStats& stats);
+    //true when file is cached or exists on disk
+    bool exists(const std::string& path, FileIOStats& stats) const;
+    void clear();
+
+    //adds stats of finished import to totals
+    void record(const FileIOStats& stats);
+    FileIOStats getTotals() const;
+    FileIOStats getLastImport() const;
+    size_t getCachedFiles() const;
+    size_t getCachedBytes() const;
+    size_t getMaxBytes() const { return maxBytes; }
+
+private:
+    struct Entry {
+        std::shared_ptr<MappedFile> file;
+        int64_t modified = 0;
+        std::list<std::string>::iterator recent;
+    };
+
+    void evict();
+
+    mutable std::mutex mutex;
+    size_t maxBytes;
+    size_t cachedBytes = 0;
+    std::unordered_map<std::string, Entry> entries;
+    //most recently used first
+    std::list<std::string> recent;
+    FileIOStats totals;
+    FileIOStats lastImport;
+};
+
+//maps file through cache when given, its stats are recorded as one import, maps file on its own otherwise
+std::shared_ptr<MappedFile> MapFile(const std::string& path, MappedFileCache* cache);
+
+//assimp io handler reading through cache, importer takes ownership, so one is created per import
+class CachedIOSystem : public Assimp::IOSystem {
+public:
+    explicit CachedIOSystem(MappedFileCache& cache) : cache(cache) {}
+
+    bool Exists(const char* pFile) const override;
+    char getOsSeparator() const override;
+    //only read modes are supported, importers never write
+    Assimp::IOStream* Open(const char* pFile, const char* pMode = "rb") override;
+    void Close(Assimp::IOStream* pFile) override;
+
+    const FileIOStats& getStats() const { return stats; }
+
+private:
+    MappedFileCache& cache;
+    mutable FileIOStats stats;
+};
@@ -0,0 +1,206 @@
+#include "MaterialAtlas.h"
+#include <algorithm>
+#include <cstring>
+#include "imstb_rectpack.h"
+
+//texture coordinates slightly outside [0,1] from exporters rounding are still treated as clamped
+static const float uvTolerance = 0.001f;
+
+static int roundUp(int value, int alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+static bool usesClampedCoordinates(const std::vector<Mesh>& meshes, const std::string& path) {
+	for (const auto& mesh : meshes) {
+		if (!mesh.hasTexture || mesh.texture.path != path) {
+			continue;
+		}
+		for (const auto& vertex : mesh.vertices) {
+			if (vertex.TexCoords.x < -uvTolerance || vertex.TexCoords.x > 1.f + uvTolerance ||
+				vertex.TexCoords.y < -uvTolerance || vertex.TexCoords.y > 1.f + uvTolerance) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//copies image into RGBA page and extends its edge pixels into gutter
+static void copyWithGutter(const TextureImage& image, unsigned char* page, int pageWidth, int x, int y, int gutter) {
+	for (int py = -gutter; py < image.height + gutter; py++) {
+		int sy = std::min(std::max(py, 0), image.height - 1);
+		unsigned char* row = page + ((size_t)(y + gutter + py) * pageWidth + x + gutter) * 4;
+		for (int px = -gutter; px < image.width + gutter; px++) {
+			int sx = std::min(std::max(px, 0), image.width - 1);
+			const unsigned char* source = image.data.get() + ((size_t)sy * image.width + sx) * image.channels;
+			unsigned char* target = row + px * 4;
+			target[0] = source[0];
+			target[1] = source[1];
+			target[2] = source[2];
+			target[3] = image.channels == 4 ? source[3] : 255;
+		}
+	}
+}
+
+void PackMaterialTextures(std::vector<Mesh>& opaqueMeshes, std::vector<Mesh>& transparentMeshes, std::map<std::string, TextureImage>& textures,
+	int maxTextureSize, int pageSize, int gutter) {
+	std::vector<std::string> candidates;
+	for (const auto& texture : textures) {
+		const TextureImage& image = texture.second;
+		//one and two channel textures are sampled as red or red-green by the shader, RGBA page would change their look
+		if (!image.data || (image.channels != 3 && image.channels != 4) || image.width > maxTextureSize || image.height > maxTextureSize) {
+			continue;
+		}
+		if (usesClampedCoordinates(opaqueMeshes, texture.first) && usesClampedCoordinates(transparentMeshes, texture.first)) {
+			candidates.push_back(texture.first);
+		}
+	}
+	if (candidates.size() < 2 || maxTextureSize + 2 * gutter > pageSize) {
+		return;
+	}
+
+	//sizes rounded to gutter keep every packed position aligned, so texture blocks do not share texels on small mip levels
+	std::vector<stbrp_rect> rects(candidates.size());
+	for (size_t i = 0; i < candidates.size(); i++) {
+		const TextureImage& image = textures[candidates[i]];
+		rects[i].id = (int)i;
+		rects[i].w = roundUp(image.width + 2 * gutter, gutter);
+		rects[i].h = roundUp(image.height + 2 * gutter, gutter);
+		rects[i].was_packed = 0;
+	}
+
+	struct Placement {
+		int page;
+		int x;
+		int y;
+	};
+	std::vector<Placement> placements(candidates.size(), Placement{ -1, 0, 0 });
+	std::vector<int> pageHeights;
+	std::vector<stbrp_node> nodes(pageSize);
+	std::vector<stbrp_rect> remaining = rects;
+	while (!remaining.empty()) {
+		stbrp_context context;
+		stbrp_init_target(&context, pageSize, pageSize, nodes.data(), (int)nodes.size());
+		stbrp_pack_rects(&context, remaining.data(), (int)remaining.size());
+
+		int page = (int)pageHeights.size();
+		int pageHeight = 0;
+		std::vector<stbrp_rect> notPacked;
+		for (const auto& rect : remaining) {
+			if (rect.was_packed) {
+				placements[rect.id] = { page, rect.x, rect.y };
+				pageHeight = std::max(pageHeight, rect.y + rect.h);
+			}
+			else {
+				notPacked.push_back(rect);
+			}
+		}
+		if (notPacked.size() == remaining.size()) {
+			break;
+		}
+		pageHeights.push_back(pageHeight);
+		remaining = notPacked;
+	}
+
+	//pages are cut to used height, power of two keeps mip levels aligned with gutters
+	std::vector<TextureImage> pages(pageHeights.size());
+	int mipLevels = 1;
+	while ((1 << mipLevels) <= gutter) {
+		mipLevels++;
+	}
+	for (size_t i = 0; i < pages.size(); i++) {
+		int height = 1;
+		while (height < pageHeights[i]) {
+			height *= 2;
+		}
+		pages[i].width = pageSize;
+		pages[i].height = height;
+		pages[i].channels = 4;
+		pages[i].mipLevels = mipLevels;
+		size_t bytes = (size_t)pageSize * height * 4;
+		pages[i].data = std::shared_ptr<unsigned char>(new unsigned char[bytes], std::default_delete<unsigned char[]>());
+		std::memset(pages[i].data.get(), 0, bytes);
+	}
+
+	std::map<std::string, size_t> packedIndices;
+	for (size_t i = 0; i < candidates.size(); i++) {
+		const Placement& placement = placements[i];
+		if (placement.page < 0) {
+			continue;
+		}
+		copyWithGutter(textures[candidates[i]], pages[placement.page].data.get(), pageSize, placement.x, placement.y, gutter);
+		packedIndices.emplace(candidates[i], i);
+	}
+
+	//texture coordinates are mapped into texture rectangle inside its page, meshes point to page instead of original texture
+	for (auto* meshes : { &opaqueMeshes, &transparentMeshes }) {
+		for (auto& mesh : *meshes) {
+			if (!mesh.hasTexture) {
+				continue;
+			}
+			auto packed = packedIndices.find(mesh.texture.path);
+			if (packed == packedIndices.end()) {
+				continue;
+			}
+			const TextureImage& image = textures[packed->first];
+			const Placement& placement = placements[packed->second];
+			const TextureImage& page = pages[placement.page];
+			glm::vec2 offset((float)(placement.x + gutter) / page.width, (float)(placement.y + gutter) / page.height);
+			glm::vec2 scale((float)image.width / page.width, (float)image.height / page.height);
+			for (auto& vertex : mesh.vertices) {
+				vertex.TexCoords = offset + glm::clamp(vertex.TexCoords, 0.f, 1.f) * scale;
+			}
+			mesh.texture.path = "#atlas" + std::to_string(placement.page);
+		}
+	}
+
+	for (const auto& packed : packedIndices) {
+		textures.erase(packed.first);
+	}
+	for (size_t i = 0; i < pages.size(); i++) {
+		textures["#atlas" + std::to_string(i)] = pages[i];
+	}
+}
+
+void MergeMeshesByTexture(std::vector<Mesh>& meshes) {
+	//groups keep order of their first mesh, so draw order of transparent meshes stays close to original
+	std::vector<std::vector<size_t>> groups;
+	std::map<std::string, size_t> groupByTexture;
+	for (size_t i = 0; i < meshes.size(); i++) {
+		//empty key for untextured meshes, texture paths are never empty
+		std::string key = meshes[i].hasTexture ? meshes[i].texture.path : std::string();
+		auto group = groupByTexture.find(key);
+		if (group == groupByTexture.end()) {
+			groupByTexture.emplace(key, groups.size());
+			groups.push_back({ i });
+		}
+		else {
+			groups[group->second].push_back(i);
+		}
+	}
+	if (groups.size() == meshes.size()) {
+		return;
+	}
+
+	std::vector<Mesh> merged;
+	merged.reserve(groups.size());
+	for (const auto& group : groups) {
+		const Mesh& first = meshes[group[0]];
+		if (group.size() == 1) {
+			merged.push_back(first);
+			continue;
+		}
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		for (size_t index : group) {
+			const Mesh& mesh = meshes[index];
+			unsigned int base = (unsigned int)vertices.size();
+			vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+			for (unsigned int vertexIndex : mesh.indices) {
+				indices.push_back(base + vertexIndex);
+			}
+		}
+		merged.push_back(Mesh(vertices, indices, first.texture, first.hasTexture, first.isTransparent));
+	}
+	meshes = std::move(merged);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include "mesh.h"
+
+//packs decoded textures up to maxTextureSize into shared RGBA atlas pages and rewrites texture coordinates of meshes using them
+//only textures sampled inside [0,1] are packed, repeating textures would bleed into their neighbours
+//every texture is surrounded by gutter of its clamped edge pixels and aligned to gutter, so first log2(gutter) mip levels stay clean
+void PackMaterialTextures(std::vector<Mesh>& opaqueMeshes, std::vector<Mesh>& transparentMeshes, std::map<std::string, TextureImage>& textures,
+    int maxTextureSize, int pageSize = 2048, int gutter = 8);
+
+//merges meshes using the same texture (or no texture) into one, so they are drawn by single draw call
+//has to run before meshes are uploaded, only for opaque meshes, merged transparent ones could not be sorted back to front
+void MergeMeshesByTexture(std::vector<Mesh>& meshes);
@@ -0,0 +1,163 @@
+#include "MeshDeduplication.h"
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+//invariant values are rounded to this fraction of mesh spread before hashing
+static const float hashQuantization = 1.f / 1024.f;
+//smaller meshes are not worth separate node and draw
+static const size_t minVertexCount = 12;
+//texture coordinates and colors of duplicate have to match reference this closely
+static const float attributeTolerance = 0.00001f;
+
+//translation and scale of canonical form, centroid of vertices and their root mean square distance from it
+struct MeshFrame {
+	glm::vec3 centroid = glm::vec3(0.f);
+	float spread = 0.f;
+};
+
+static MeshFrame meshFrame(const Mesh& mesh) {
+	MeshFrame frame;
+	for (const auto& vertex : mesh.vertices) {
+		frame.centroid += vertex.Position;
+	}
+	frame.centroid /= (float)mesh.vertices.size();
+	double sum = 0.0;
+	for (const auto& vertex : mesh.vertices) {
+		glm::vec3 offset = vertex.Position - frame.centroid;
+		sum += glm::dot(offset, offset);
+	}
+	frame.spread = (float)std::sqrt(sum / mesh.vertices.size());
+	return frame;
+}
+
+static void hashBytes(uint64_t& hash, const void* data, size_t size) {
+	//FNV-1a
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+}
+
+static int32_t quantize(float value) {
+	return (int32_t)std::lround(value / hashQuantization);
+}
+
+//rotation has no canonical form which survives symmetric parts like wheels, so only values which do not change under it are hashed
+static uint64_t invariantHash(const Mesh& mesh, const MeshFrame& frame) {
+	uint64_t hash = 14695981039346656037ull;
+	uint64_t vertexCount = mesh.vertices.size();
+	uint8_t flags = (mesh.hasTexture ? 1 : 0) | (mesh.isTransparent ? 2 : 0);
+	hashBytes(hash, &vertexCount, sizeof(vertexCount));
+	hashBytes(hash, &flags, sizeof(flags));
+	hashBytes(hash, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+	if (mesh.hasTexture) {
+		hashBytes(hash, mesh.texture.path.data(), mesh.texture.path.size());
+	}
+	for (const auto& vertex : mesh.vertices) {
+		glm::vec3 offset = (vertex.Position - frame.centroid) / frame.spread;
+		int32_t values[] = {
+			quantize(glm::length(offset)),
+			quantize(glm::dot(vertex.Normal, offset)),
+			quantize(vertex.TexCoords.x),
+			quantize(vertex.TexCoords.y),
+			quantize(vertex.Color.r),
+			quantize(vertex.Color.g),
+			quantize(vertex.Color.b),
+			quantize(vertex.Color.a),
+		};
+		hashBytes(hash, values, sizeof(values));
+	}
+	return hash;
+}
+
+static bool sameAttributes(const Mesh& reference, const Mesh& mesh) {
+	if (reference.indices != mesh.indices || reference.hasTexture != mesh.hasTexture || reference.isTransparent != mesh.isTransparent ||
+		(mesh.hasTexture && reference.texture.path != mesh.texture.path)) {
+		return false;
+	}
+	for (size_t i = 0; i < mesh.vertices.size(); i++) {
+		const Vertex& a = reference.vertices[i];
+		const Vertex& b = mesh.vertices[i];
+		if (glm::any(glm::greaterThan(glm::abs(a.TexCoords - b.TexCoords), glm::vec2(attributeTolerance))) ||
+			glm::any(glm::greaterThan(glm::abs(a.Color - b.Color), glm::vec4(attributeTolerance)))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//least squares linear part maps centered reference vertices onto centered mesh vertices, translation follows from centroids
+static bool solveTransform(const Mesh& reference, const MeshFrame& referenceFrame, const Mesh& mesh, const MeshFrame& frame, float tolerance, glm::mat4& transform) {
+	glm::dmat3 cross(0.0);
+	glm::dmat3 covariance(0.0);
+	auto accumulate = [&](const glm::dvec3& from, const glm::dvec3& to) {
+		cross += glm::outerProduct(to, from);
+		covariance += glm::outerProduct(from, from);
+	};
+	for (size_t i = 0; i < mesh.vertices.size(); i++) {
+		glm::dvec3 from = glm::dvec3(reference.vertices[i].Position - referenceFrame.centroid);
+		glm::dvec3 to = glm::dvec3(mesh.vertices[i].Position - frame.centroid);
+		accumulate(from, to);
+		//points along normals give direction out of plane of flat meshes, which positions alone leave undetermined
+		accumulate(from + glm::dvec3(reference.vertices[i].Normal) * (double)referenceFrame.spread, to + glm::dvec3(mesh.vertices[i].Normal) * (double)frame.spread);
+	}
+	double scale = (double)referenceFrame.spread * referenceFrame.spread * mesh.vertices.size();
+	if (std::abs(glm::determinant(covariance)) < 1e-9 * scale * scale * scale) {
+		return false;
+	}
+	glm::dmat3 linear = cross * glm::inverse(covariance);
+	glm::dmat3 normalMatrix = glm::transpose(glm::inverse(linear));
+
+	//fit is accepted only when every vertex matches, least squares alone would also accept merely similar shapes
+	double maxError = (double)tolerance * frame.spread;
+	for (size_t i = 0; i < mesh.vertices.size(); i++) {
+		glm::dvec3 from = glm::dvec3(reference.vertices[i].Position - referenceFrame.centroid);
+		glm::dvec3 to = glm::dvec3(mesh.vertices[i].Position - frame.centroid);
+		if (glm::length(linear * from - to) > maxError) {
+			return false;
+		}
+		glm::dvec3 normal = normalMatrix * glm::dvec3(reference.vertices[i].Normal);
+		glm::dvec3 expected = glm::dvec3(mesh.vertices[i].Normal);
+		if (glm::length(normal) > 0.0 && glm::length(expected) > 0.0 && glm::dot(glm::normalize(normal), glm::normalize(expected)) < 0.999) {
+			return false;
+		}
+	}
+
+	glm::dvec3 translation = glm::dvec3(frame.centroid) - linear * glm::dvec3(referenceFrame.centroid);
+	transform = glm::mat4(glm::mat3(linear));
+	transform[3] = glm::vec4(glm::vec3(translation), 1.f);
+	return true;
+}
+
+std::vector<MeshDuplicate> FindDuplicateMeshes(const std::vector<Mesh>& meshes, float tolerance) {
+	std::vector<MeshDuplicate> duplicates;
+	std::vector<MeshFrame> frames(meshes.size());
+	//first mesh of every shape under its hash, hashes of different shapes may collide
+	std::unordered_map<uint64_t, std::vector<size_t>> references;
+	for (size_t i = 0; i < meshes.size(); i++) {
+		const Mesh& mesh = meshes[i];
+		if (mesh.vertices.size() < minVertexCount || mesh.indices.empty()) {
+			continue;
+		}
+		frames[i] = meshFrame(mesh);
+		if (!(frames[i].spread > 0.f)) {
+			continue;
+		}
+		std::vector<size_t>& candidates = references[invariantHash(mesh, frames[i])];
+		bool found = false;
+		for (size_t reference : candidates) {
+			glm::mat4 transform;
+			if (sameAttributes(meshes[reference], mesh) && solveTransform(meshes[reference], frames[reference], mesh, frames[i], tolerance, transform)) {
+				duplicates.push_back({ i, reference, transform });
+				found = true;
+				break;
+			}
+		}
+		if (!found) {
+			candidates.push_back(i);
+		}
+	}
+	return duplicates;
+}
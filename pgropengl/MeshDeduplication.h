@@ -0,0 +1,19 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+#include "mesh.h"
+
+//mesh repeating earlier mesh of the same list, transform maps reference vertices onto it
+struct MeshDuplicate {
+    size_t mesh;
+    size_t reference;
+    glm::mat4 transform;
+};
+
+//finds meshes which are copies of earlier mesh moved, rotated, scaled or mirrored, like wheels or bolts exported as separate objects
+//meshes are hashed by data invariant to those transforms (vertex distances from centroid relative to their spread, indices, material),
+//transform of every candidate with equal hash is solved by least squares and accepted only when all vertices land within tolerance
+//tolerance is relative to size of mesh, vertices have to be in the same order in both meshes
+std::vector<MeshDuplicate> FindDuplicateMeshes(const std::vector<Mesh>& meshes, float tolerance = 0.0005f);
@@ -0,0 +1,92 @@
+#include "ModelBrowser.h"
+#include <algorithm>
+
+//size of thumbnail in list row in pixels
+static const float thumbnailRowSize = 48.f;
+
+	bool ModelBrowser::draw(const ModelCatalog& catalog, ThumbnailAtlas* thumbnails, std::string& selectedPath) {
+		if (filter.Draw("Filter")) {
+			filterDirty = true;
+		}
+		if (filterDirty) {
+			rebuildFilter(catalog);
+		}
+
+		const auto& entries = catalog.getEntries();
+		if (catalog.isScanning()) {
+			ImGui::Text("Scanning models %zu/%zu", catalog.getScanDone(), catalog.getScanTotal());
+		}
+		else {
+			ImGui::Text("%zu of %zu models", filteredEntries.size(), entries.size());
+		}
+
+		bool changed = false;
+		missingThumbnails.clear();
+		ImGui::BeginChild("ModelList", ImVec2(0, thumbnails ? 220.f : 150.f), true);
+		ImGuiListClipper clipper;
+		clipper.Begin((int)filteredEntries.size());
+		while (clipper.Step()) {
+			for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+				const CatalogEntry& entry = entries[filteredEntries[row]];
+				ImGui::PushID(filteredEntries[row]);
+				ImVec2 rowSize(0, 0);
+				if (thumbnails) {
+					//all rows have same height so clipper can skip invisible ones
+					ThumbnailAtlas::Thumbnail thumbnail;
+					if (thumbnails->find(ThumbnailAtlas::hashEntry(entry), thumbnail)) {
+						ImGui::Image((ImTextureID)(intptr_t)thumbnail.texture, ImVec2(thumbnailRowSize, thumbnailRowSize),
+							ImVec2(thumbnail.uv0.x, thumbnail.uv0.y), ImVec2(thumbnail.uv1.x, thumbnail.uv1.y));
+					}
+					else {
+						ImGui::Dummy(ImVec2(thumbnailRowSize, thumbnailRowSize));
+						missingThumbnails.push_back(filteredEntries[row]);
+					}
+					ImGui::SameLine();
+					rowSize.y = thumbnailRowSize;
+				}
+				if (ImGui::Selectable(entry.path.c_str(), entry.path == selectedPath, 0, rowSize) && entry.path != selectedPath) {
+					selectedPath = entry.path;
+					changed = true;
+				}
+				if (ImGui::IsItemHovered()) {
+					glm::vec3 size = entry.boundsMax - entry.boundsMin;
+					ImGui::SetTooltip("Triangles: %u\nTextures: %.1f MB\nFile: %.1f MB\nSize: %.2f x %.2f x %.2f",
+						entry.triangleCount, entry.textureBytes / (1024.f * 1024.f), entry.fileSize / (1024.f * 1024.f), size.x, size.y, size.z);
+				}
+				ImGui::PopID();
+			}
+		}
+		ImGui::EndChild();
+		return changed;
+	}
+
+	void ModelBrowser::rebuildFilter(const ModelCatalog& catalog) {
+		const auto& entries = catalog.getEntries();
+		filteredEntries.clear();
+		filteredEntries.reserve(entries.size());
+		for (int i = 0; i < (int)entries.size(); i++) {
+			if (filter.PassFilter(entries[i].path.c_str())) {
+				filteredEntries.push_back(i);
+			}
+		}
+		filterDirty = false;
+	}
+
+	std::vector<std::string> ModelBrowser::getNeighbours(const ModelCatalog& catalog, const std::string& path, int radius) const {
+		std::vector<std::string> neighbours;
+		int entry = catalog.find(path);
+		auto row = std::find(filteredEntries.begin(), filteredEntries.end(), entry);
+		if (entry < 0 || row == filteredEntries.end()) {
+			return neighbours;
+		}
+		int selectedRow = (int)(row - filteredEntries.begin());
+		for (int distance = 1; distance <= radius; distance++) {
+			//next row first, stepping down the list is more common than up
+			for (int candidate : { selectedRow + distance, selectedRow - distance }) {
+				if (candidate >= 0 && candidate < (int)filteredEntries.size()) {
+					neighbours.push_back(catalog.getEntries()[filteredEntries[candidate]].path);
+				}
+			}
+		}
+		return neighbours;
+	}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "imgui.h"
+#include "ModelCatalog.h"
+#include "ThumbnailAtlas.h"
+
+//filterable list of catalog models, only visible rows are submitted to imgui so it stays fast with large catalogs
+class ModelBrowser {
+public:
+    //draws list into current imgui window, returns true when user selected different model
+    //rows show thumbnails from atlas when given, visible rows without thumbnail are collected as missing
+    bool draw(const ModelCatalog& catalog, ThumbnailAtlas* thumbnails, std::string& selectedPath);
+    //paths of entries up to radius rows around given path in filtered list, nearest first
+    std::vector<std::string> getNeighbours(const ModelCatalog& catalog, const std::string& path, int radius) const;
+    //catalog entries visible in last drawn frame which have no thumbnail yet
+    const std::vector<int>& getMissingThumbnails() const { return missingThumbnails; }
+    //filtered rows have to be rebuilt after catalog entries changed
+    void invalidate() { filterDirty = true; }
+
+private:
+    void rebuildFilter(const ModelCatalog& catalog);
+
+    ImGuiTextFilter filter;
+    //indices of catalog entries passing filter
+    std::vector<int> filteredEntries;
+    bool filterDirty = true;
+    std::vector<int> missingThumbnails;
+};
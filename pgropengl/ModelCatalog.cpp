@@ -0,0 +1,264 @@
+#include "ModelCatalog.h"
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <iostream>
+#include <set>
+#include <unordered_map>
+#include "stb_image.h"
+
+namespace fs = std::filesystem;
+
+//index file layout: magic, version, entry count and entries with length prefixed path
+static const uint32_t catalogIndexMagic = 0x5441434d; //"MCAT"
+static const uint32_t catalogIndexVersion = 2;
+
+	ModelCatalog::ModelCatalog(const std::string& rootDirectory, const std::string& indexPath)
+		: rootDirectory(rootDirectory), indexPath(indexPath) {
+	}
+
+	ModelCatalog::~ModelCatalog() {
+		if (scanThread.joinable()) {
+			scanThread.join();
+		}
+	}
+
+	void ModelCatalog::startScan() {
+		if (scanning) {
+			return;
+		}
+		if (scanThread.joinable()) {
+			scanThread.join();
+		}
+		//entries from previous run are usable right away, scan only refreshes them
+		if (entries.empty()) {
+			loadIndex(entries);
+		}
+		scanning = true;
+		scanThread = std::thread(&ModelCatalog::scan, this);
+	}
+
+	bool ModelCatalog::pollScanResults() {
+		std::lock_guard<std::mutex> lock(resultMutex);
+		if (!scanResultReady) {
+			return false;
+		}
+		scanResultReady = false;
+		entries = std::move(scanResult);
+		scanResult.clear();
+		reusedCount = scanReusedCount;
+		importedCount = scanImportedCount;
+		scanSeconds = scanResultSeconds;
+		return true;
+	}
+
+	int ModelCatalog::find(const std::string& path) const {
+		//entries are sorted by path
+		auto found = std::lower_bound(entries.begin(), entries.end(), path,
+			[](const CatalogEntry& entry, const std::string& value) { return entry.path < value; });
+		if (found == entries.end() || found->path != path) {
+			return -1;
+		}
+		return (int)(found - entries.begin());
+	}
+
+	void ModelCatalog::scan() {
+		auto start = std::chrono::steady_clock::now();
+
+		std::vector<CatalogEntry> previous;
+		loadIndex(previous);
+		std::unordered_map<std::string, const CatalogEntry*> previousByPath;
+		for (const auto& entry : previous) {
+			previousByPath.emplace(entry.path, &entry);
+		}
+
+		//collect candidate files, extension check is cheap so it is done while walking the tree
+		Assimp::Importer extensionCheck;
+		std::vector<CatalogEntry> found;
+		std::error_code error;
+		for (fs::recursive_directory_iterator it(rootDirectory, error), end; it != end; it.increment(error)) {
+			if (error) {
+				break;
+			}
+			if (!it->is_regular_file(error)) {
+				continue;
+			}
+			std::string extension = it->path().extension().string();
+			if (extension.empty() || !extensionCheck.IsExtensionSupported(extension)) {
+				continue;
+			}
+			CatalogEntry entry;
+			entry.path = it->path().generic_string();
+			entry.fileSize = it->file_size(error);
+			entry.modifiedTime = (int64_t)it->last_write_time(error).time_since_epoch().count();
+			found.push_back(entry);
+		}
+		std::sort(found.begin(), found.end(), [](const CatalogEntry& a, const CatalogEntry& b) { return a.path < b.path; });
+
+		//reuse metadata of unchanged files, import the rest
+		std::vector<size_t> toInspect;
+		for (size_t i = 0; i < found.size(); i++) {
+			auto prev = previousByPath.find(found[i].path);
+			if (prev != previousByPath.end() && !prev->second->failed && prev->second->fileSize == found[i].fileSize && prev->second->modifiedTime == found[i].modifiedTime) {
+				found[i] = *prev->second;
+			}
+			else {
+				toInspect.push_back(i);
+			}
+		}
+
+		scanTotal = toInspect.size();
+		scanDone = 0;
+		std::atomic<size_t> next{ 0 };
+		auto worker = [&]() {
+			for (size_t i = next++; i < toInspect.size(); i = next++) {
+				if (!inspectModel(found[toInspect[i]])) {
+					found[toInspect[i]].failed = true;
+					std::cout << "Catalog failed to inspect " << found[toInspect[i]].path << std::endl;
+				}
+				scanDone++;
+			}
+		};
+		unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+		threadCount = (unsigned int)std::min<size_t>(threadCount, toInspect.size());
+		std::vector<std::thread> workers;
+		for (unsigned int i = 0; i < threadCount; i++) {
+			workers.emplace_back(worker);
+		}
+		for (auto& thread : workers) {
+			thread.join();
+		}
+
+		if (!toInspect.empty() || found.size() != previous.size()) {
+			saveIndex(found);
+		}
+
+		std::lock_guard<std::mutex> lock(resultMutex);
+		scanReusedCount = found.size() - toInspect.size();
+		scanImportedCount = toInspect.size();
+		scanResultSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		scanResult = std::move(found);
+		scanResultReady = true;
+		scanning = false;
+	}
+
+	bool ModelCatalog::inspectModel(CatalogEntry& entry) {
+		//every worker has its own importer, importer instances are not shared between threads
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(entry.path, aiProcess_Triangulate | aiProcess_PreTransformVertices);
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+			return false;
+		}
+
+		glm::vec3 boundsMin(std::numeric_limits<float>::max());
+		glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+		uint32_t triangles = 0;
+		for (unsigned int m = 0; m < scene->mNumMeshes; m++) {
+			const aiMesh* mesh = scene->mMeshes[m];
+			triangles += mesh->mNumFaces;
+			for (unsigned int v = 0; v < mesh->mNumVertices; v++) {
+				glm::vec3 position(mesh->mVertices[v].x, mesh->mVertices[v].y, mesh->mVertices[v].z);
+				boundsMin = glm::min(boundsMin, position);
+				boundsMax = glm::max(boundsMax, position);
+			}
+		}
+		if (triangles == 0) {
+			boundsMin = boundsMax = glm::vec3(0.f);
+		}
+
+		//texture sizes are read from image headers only, same as model loading count mipmaps as one third extra
+		std::string directory = entry.path.substr(0, entry.path.find_last_of('/'));
+		std::set<std::string> textures;
+		uint64_t textureBytes = 0;
+		for (unsigned int m = 0; m < scene->mNumMaterials; m++) {
+			aiString texturePath;
+			if (scene->mMaterials[m]->GetTextureCount(aiTextureType_DIFFUSE) > 0 && scene->mMaterials[m]->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == AI_SUCCESS) {
+				std::string filename = directory + '/' + texturePath.C_Str();
+				int width, height, channels;
+				if (textures.insert(filename).second && stbi_info(filename.c_str(), &width, &height, &channels)) {
+					textureBytes += (uint64_t)width * height * channels * 4 / 3;
+				}
+			}
+		}
+
+		entry.triangleCount = triangles;
+		entry.textureBytes = textureBytes;
+		entry.boundsMin = boundsMin;
+		entry.boundsMax = boundsMax;
+		return true;
+	}
+
+	bool ModelCatalog::loadIndex(std::vector<CatalogEntry>& indexEntries) const {
+		std::ifstream file(indexPath, std::ios::binary);
+		if (!file.is_open()) {
+			return false;
+		}
+		uint32_t magic = 0, version = 0, count = 0;
+		file.read((char*)&magic, sizeof(magic));
+		file.read((char*)&version, sizeof(version));
+		file.read((char*)&count, sizeof(count));
+		if (!file || magic != catalogIndexMagic || version != catalogIndexVersion) {
+			return false;
+		}
+		indexEntries.clear();
+		indexEntries.reserve(count);
+		for (uint32_t i = 0; i < count; i++) {
+			CatalogEntry entry;
+			uint16_t pathLength = 0;
+			file.read((char*)&pathLength, sizeof(pathLength));
+			entry.path.resize(pathLength);
+			file.read(&entry.path[0], pathLength);
+			file.read((char*)&entry.fileSize, sizeof(entry.fileSize));
+			file.read((char*)&entry.modifiedTime, sizeof(entry.modifiedTime));
+			file.read((char*)&entry.triangleCount, sizeof(entry.triangleCount));
+			file.read((char*)&entry.textureBytes, sizeof(entry.textureBytes));
+			file.read((char*)&entry.boundsMin[0], sizeof(float) * 3);
+			file.read((char*)&entry.boundsMax[0], sizeof(float) * 3);
+			uint8_t failed = 0;
+			file.read((char*)&failed, sizeof(failed));
+			entry.failed = failed != 0;
+			if (!file) {
+				indexEntries.clear();
+				return false;
+			}
+			indexEntries.push_back(entry);
+		}
+		return true;
+	}
+
+	bool ModelCatalog::saveIndex(const std::vector<CatalogEntry>& indexEntries) const {
+		//write to temporary file first so interrupted write never leaves broken index
+		std::string tmpPath = indexPath + ".tmp";
+		{
+			std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				std::cout << "Failed to write catalog index: " << indexPath << std::endl;
+				return false;
+			}
+			uint32_t count = (uint32_t)indexEntries.size();
+			file.write((const char*)&catalogIndexMagic, sizeof(catalogIndexMagic));
+			file.write((const char*)&catalogIndexVersion, sizeof(catalogIndexVersion));
+			file.write((const char*)&count, sizeof(count));
+			for (const auto& entry : indexEntries) {
+				uint16_t pathLength = (uint16_t)entry.path.size();
+				file.write((const char*)&pathLength, sizeof(pathLength));
+				file.write(entry.path.data(), pathLength);
+				file.write((const char*)&entry.fileSize, sizeof(entry.fileSize));
+				file.write((const char*)&entry.modifiedTime, sizeof(entry.modifiedTime));
+				file.write((const char*)&entry.triangleCount, sizeof(entry.triangleCount));
+				file.write((const char*)&entry.textureBytes, sizeof(entry.textureBytes));
+				file.write((const char*)&entry.boundsMin[0], sizeof(float) * 3);
+				file.write((const char*)&entry.boundsMax[0], sizeof(float) * 3);
+				uint8_t failed = entry.failed ? 1 : 0;
+				file.write((const char*)&failed, sizeof(failed));
+			}
+		}
+		std::error_code error;
+		fs::rename(tmpPath, indexPath, error);
+		return !error;
+	}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//metadata of one model file found in catalog root directory
+struct CatalogEntry {
+    std::string path;
+    uint64_t fileSize = 0;
+    int64_t modifiedTime = 0;
+    uint32_t triangleCount = 0;
+    uint64_t textureBytes = 0;
+    glm::vec3 boundsMin = glm::vec3(0.f);
+    glm::vec3 boundsMax = glm::vec3(0.f);
+    //import failed, metadata is empty and file is inspected again by next scan
+    bool failed = false;
+};
+
+//scans directory tree for files supported by assimp and keeps their metadata in compact binary index
+//files not changed since last scan (same size and modification time) are taken from index without importing,
+//files whose import failed are retried, failure may be transient (e.g. file locked by other program)
+class ModelCatalog {
+public:
+    ModelCatalog(const std::string& rootDirectory, const std::string& indexPath);
+    ~ModelCatalog();
+
+    //loads index from disk and starts scan of root directory in background
+    void startScan();
+    bool isScanning() const { return scanning; }
+    //takes over results of finished scan, returns true when entries changed, call from main thread
+    bool pollScanResults();
+
+    const std::vector<CatalogEntry>& getEntries() const { return entries; }
+    //index of entry with given path or -1
+    int find(const std::string& path) const;
+
+    size_t getScanTotal() const { return scanTotal; }
+    size_t getScanDone() const { return scanDone; }
+    size_t getReusedCount() const { return reusedCount; }
+    size_t getImportedCount() const { return importedCount; }
+    double getScanSeconds() const { return scanSeconds; }
+
+private:
+    void scan();
+    static bool inspectModel(CatalogEntry& entry);
+    bool loadIndex(std::vector<CatalogEntry>& indexEntries) const;
+    bool saveIndex(const std::vector<CatalogEntry>& indexEntries) const;
+
+    std::string rootDirectory;
+    std::string indexPath;
+    std::vector<CatalogEntry> entries;
+
+    std::thread scanThread;
+    std::mutex resultMutex;
+    std::vector<CatalogEntry> scanResult;
+    bool scanResultReady = false;
+    size_t scanReusedCount = 0;
+    size_t scanImportedCount = 0;
+    double scanResultSeconds = 0.0;
+    std::atomic<bool> scanning{ false };
+    std::atomic<size_t> scanTotal{ 0 };
+    std::atomic<size_t> scanDone{ 0 };
+    size_t reusedCount = 0;
+    size_t importedCount = 0;
+    double scanSeconds = 0.0;
+};
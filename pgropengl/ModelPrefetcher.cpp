@@ -0,0 +1,216 @@
+#include "ModelPrefetcher.h"
+#include <algorithm>
+#include <SDL.h>
+
+//how many models predicted from history are queued besides list neighbours
+static const size_t historyPredictions = 2;
+
+	ModelPrefetcher::ModelPrefetcher(GLDeletionQueue& deletionQueue, size_t maxModels, size_t maxBytes)
+		: deletionQueue(deletionQueue), maxModels(maxModels), maxBytes(maxBytes) {
+		worker = std::thread(&ModelPrefetcher::workerLoop, this);
+	}
+
+	ModelPrefetcher::~ModelPrefetcher() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+			requests.clear();
+		}
+		condition.notify_all();
+		worker.join();
+		for (auto& entry : finished) {
+			release(std::move(entry.model));
+		}
+		for (auto& entry : cache) {
+			release(std::move(entry.model));
+		}
+	}
+
+	bool ModelPrefetcher::isCached(const std::string& path) {
+		for (const auto& entry : cache) {
+			if (entry.path == path) {
+				return true;
+			}
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		for (const auto& entry : finished) {
+			if (entry.path == path) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::unique_ptr<Model> ModelPrefetcher::take(const std::string& path) {
+		for (auto it = cache.begin(); it != cache.end(); ++it) {
+			if (it->path == path) {
+				std::unique_ptr<Model> model = std::move(it->model);
+				cache.erase(it);
+				hits++;
+				return model;
+			}
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		requests.erase(std::remove(requests.begin(), requests.end(), path), requests.end());
+		for (auto it = finished.begin(); it != finished.end(); ++it) {
+			if (it->path == path) {
+				std::unique_ptr<Model> model = std::move(it->model);
+				finished.erase(it);
+				hits++;
+				return model;
+			}
+		}
+		//model is being imported right now, selection does not wait for it and streams model behind its proxy,
+		//finished import still lands in cache for the next selection
+		if (loadingPath == path) {
+			lateHits++;
+			return nullptr;
+		}
+		misses++;
+		return nullptr;
+	}
+
+	void ModelPrefetcher::recordSelection(const std::string& path, const std::vector<std::string>& neighbours, const std::function<bool(const std::string&)>& isLoaded) {
+		if (!lastSelection.empty() && lastSelection != path) {
+			transitions[lastSelection][path]++;
+		}
+		lastSelection = path;
+
+		//most frequent followers of selected model go first, then its neighbours in list
+		std::vector<std::string> predictions;
+		auto followers = transitions.find(path);
+		if (followers != transitions.end()) {
+			std::vector<std::pair<unsigned int, std::string>> ranked;
+			for (const auto& follower : followers->second) {
+				ranked.emplace_back(follower.second, follower.first);
+			}
+			std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+			for (size_t i = 0; i < ranked.size() && i < historyPredictions; i++) {
+				predictions.push_back(ranked[i].second);
+			}
+		}
+		for (const auto& neighbour : neighbours) {
+			if (std::find(predictions.begin(), predictions.end(), neighbour) == predictions.end()) {
+				predictions.push_back(neighbour);
+			}
+		}
+
+		std::vector<std::string> toQueue;
+		for (const auto& prediction : predictions) {
+			if (prediction != path && !isLoaded(prediction) && !isCachedOrLoading(prediction)) {
+				toQueue.push_back(prediction);
+			}
+		}
+		{
+			//predictions for previous selection are no longer interesting
+			std::lock_guard<std::mutex> lock(mutex);
+			requests.assign(toQueue.begin(), toQueue.end());
+		}
+		condition.notify_all();
+	}
+
+	void ModelPrefetcher::update(float frameTimeMs) {
+		bool wasPaused = paused;
+		{
+			//worker checks paused under lock, change outside of it could fall between its check and wait
+			std::lock_guard<std::mutex> lock(mutex);
+			paused = !enabled || frameTimeMs > frameTimeThresholdMs;
+		}
+		if (wasPaused && !paused) {
+			condition.notify_all();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (auto& entry : finished) {
+				cache.push_front(std::move(entry));
+			}
+			finished.clear();
+		}
+		enforceBounds();
+
+		if (paused) {
+			return;
+		}
+		//GPU upload has to happen here on main thread, only a slice of one model per frame
+		for (auto& entry : cache) {
+			if (!entry.model->isUploaded()) {
+				entry.model->uploadStep(uploadBytesPerFrame);
+				break;
+			}
+		}
+	}
+
+	void ModelPrefetcher::setEnabled(bool enabled) {
+		this->enabled = enabled;
+		if (!enabled) {
+			std::lock_guard<std::mutex> lock(mutex);
+			requests.clear();
+		}
+	}
+
+	float ModelPrefetcher::getHitRate() const {
+		unsigned int total = hits + lateHits + misses;
+		return total > 0 ? (float)hits / total : 0.f;
+	}
+
+	size_t ModelPrefetcher::getCachedBytes() const {
+		size_t bytes = 0;
+		for (const auto& entry : cache) {
+			bytes += entry.model->cpuBytes() + entry.model->gpuBytes();
+		}
+		return bytes;
+	}
+
+	size_t ModelPrefetcher::getQueuedCount() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return requests.size() + (loadingPath.empty() ? 0 : 1);
+	}
+
+	void ModelPrefetcher::workerLoop() {
+		//prefetching must not compete with main thread for CPU
+		SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			condition.wait(lock, [this]() { return stopping || (!paused && !requests.empty()); });
+			if (stopping) {
+				return;
+			}
+			std::string path = requests.front();
+			requests.pop_front();
+			loadingPath = path;
+			lock.unlock();
+
+			//only CPU side is loaded here, GL objects are created on main thread in update
+			auto model = std::make_unique<Model>(path, false);
+
+			lock.lock();
+			loadingPath.clear();
+			finished.push_back({ path, std::move(model) });
+			condition.notify_all();
+		}
+	}
+
+	void ModelPrefetcher::enforceBounds() {
+		while (!cache.empty() && (cache.size() > maxModels || getCachedBytes() > maxBytes)) {
+			release(std::move(cache.back().model));
+			cache.pop_back();
+		}
+	}
+
+	void ModelPrefetcher::release(std::unique_ptr<Model> model) {
+		GLObjectList objects;
+		model->releaseGLObjects(objects);
+		if (!objects.buffers.empty() || !objects.textures.empty()) {
+			deletionQueue.enqueue(std::move(objects));
+		}
+	}
+
+	bool ModelPrefetcher::isCachedOrLoading(const std::string& path) {
+		if (isCached(path)) {
+			return true;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		return loadingPath == path;
+	}
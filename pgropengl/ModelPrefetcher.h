@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "model.h"
+#include "GLDeletionQueue.h"
+
+//loads models the user is likely to select next while the viewer is idle
+//prediction combines transitions seen in selection history with neighbours of selected model in the list
+class ModelPrefetcher {
+public:
+    ModelPrefetcher(GLDeletionQueue& deletionQueue, size_t maxModels, size_t maxBytes);
+    ~ModelPrefetcher();
+
+    //true when model is loaded in cache and can be taken without waiting
+    bool isCached(const std::string& path);
+    //returns prefetched model for selected path or nullptr when it was not prefetched or is still loading, never waits, counts hit rate
+    std::unique_ptr<Model> take(const std::string& path);
+    //records selection and queues predicted models, isLoaded tells which paths need no prefetching
+    void recordSelection(const std::string& path, const std::vector<std::string>& neighbours, const std::function<bool(const std::string&)>& isLoaded);
+    //collects finished loads and uploads them in small steps, loading pauses while frame time is above threshold
+    void update(float frameTimeMs);
+
+    void setEnabled(bool enabled);
+    bool isPaused() const { return paused; }
+
+    float frameTimeThresholdMs = 20.f;
+    //bytes uploaded to GPU per frame for prefetched models
+    size_t uploadBytesPerFrame = 4 << 20;
+
+    unsigned int getHits() const { return hits; }
+    //selections of model still being imported
+    unsigned int getLateHits() const { return lateHits; }
+    unsigned int getMisses() const { return misses; }
+    float getHitRate() const;
+    size_t getCachedCount() const { return cache.size(); }
+    size_t getCachedBytes() const;
+    size_t getQueuedCount();
+
+private:
+    struct CacheEntry {
+        std::string path;
+        std::unique_ptr<Model> model;
+    };
+
+    void workerLoop();
+    //drops least recently prefetched models until cache fits its bounds
+    void enforceBounds();
+    void release(std::unique_ptr<Model> model);
+    bool isCachedOrLoading(const std::string& path);
+
+    GLDeletionQueue& deletionQueue;
+    size_t maxModels;
+    size_t maxBytes;
+
+    //front is most recently prefetched model, prefetched models are kept in main thread only
+    std::list<CacheEntry> cache;
+    //how many times each model was selected right after another one
+    std::unordered_map<std::string, std::unordered_map<std::string, unsigned int>> transitions;
+    std::string lastSelection;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable condition;
+    //shared with worker, guarded by mutex
+    std::deque<std::string> requests;
+    std::string loadingPath;
+    std::vector<CacheEntry> finished;
+    bool stopping = false;
+    std::atomic<bool> paused{ false };
+    std::atomic<bool> enabled{ true };
+
+    unsigned int hits = 0;
+    unsigned int lateHits = 0;
+    unsigned int misses = 0;
+};
@@ -0,0 +1,373 @@
+#include "ModelProxy.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <unordered_map>
+
+static const uint32_t proxyMagic = 0x59585250; //"PRXY"
+//version 2 - meshes merged by texture on load
+//version 3 - node hierarchy stored after meshes
+//version 4 - import flags of model stored after hierarchy
+//version 5 - vertices without texture flag, shader permutation decides about texturing
+static const uint32_t proxyVersion = 5;
+
+	std::unique_ptr<ModelProxy> ModelProxy::load(const std::string& proxyDirectory, const std::string& modelPath) {
+		uint64_t fileSize;
+		int64_t modifiedTime;
+		if (!fileStamp(modelPath, fileSize, modifiedTime)) {
+			return nullptr;
+		}
+		std::ifstream file(proxyPath(proxyDirectory, modelPath), std::ios::binary | std::ios::ate);
+		if (!file.is_open()) {
+			return nullptr;
+		}
+		//counts read from file are checked against its size before anything is allocated
+		uint64_t proxySize = (uint64_t)file.tellg();
+		file.seekg(0);
+		uint32_t magic = 0, version = 0, meshCount = 0;
+		uint64_t storedSize = 0;
+		int64_t storedTime = 0;
+		file.read((char*)&magic, sizeof(magic));
+		file.read((char*)&version, sizeof(version));
+		file.read((char*)&storedSize, sizeof(storedSize));
+		file.read((char*)&storedTime, sizeof(storedTime));
+		if (!file || magic != proxyMagic || version != proxyVersion || storedSize != fileSize || storedTime != modifiedTime) {
+			return nullptr;
+		}
+
+		auto proxy = std::make_unique<ModelProxy>();
+		file.read((char*)&proxy->boundsMin[0], sizeof(float) * 3);
+		file.read((char*)&proxy->boundsMax[0], sizeof(float) * 3);
+		file.read((char*)&meshCount, sizeof(meshCount));
+		for (uint32_t i = 0; i < meshCount && file; i++) {
+			uint8_t transparent = 0;
+			uint32_t vertexCount = 0, indexCount = 0;
+			file.read((char*)&transparent, sizeof(transparent));
+			file.read((char*)&vertexCount, sizeof(vertexCount));
+			file.read((char*)&indexCount, sizeof(indexCount));
+			uint64_t remaining = file ? proxySize - (uint64_t)file.tellg() : 0;
+			if ((uint64_t)vertexCount * sizeof(Vertex) + (uint64_t)indexCount * sizeof(unsigned int) > remaining) {
+				std::cout << "Corrupted model proxy: " << proxyPath(proxyDirectory, modelPath) << std::endl;
+				return nullptr;
+			}
+			std::vector<Vertex> vertices(vertexCount);
+			std::vector<unsigned int> indices(indexCount);
+			file.read((char*)vertices.data(), vertices.size() * sizeof(Vertex));
+			file.read((char*)indices.data(), indices.size() * sizeof(unsigned int));
+			//index outside of vertices would make GPU read past vertex buffer
+			if (std::any_of(indices.begin(), indices.end(), [vertexCount](unsigned int index) { return index >= vertexCount; })) {
+				std::cout << "Corrupted model proxy: " << proxyPath(proxyDirectory, modelPath) << std::endl;
+				return nullptr;
+			}
+			Mesh mesh(vertices, indices, Texture(), false, transparent != 0);
+			if (mesh.isTransparent) {
+				proxy->model.transparentMeshes.push_back(mesh);
+			}
+			else {
+				proxy->model.opaqueMeshes.push_back(mesh);
+			}
+		}
+		//proxy meshes of model with preserved hierarchy are in node space like full ones
+		uint32_t nodeCount = 0, instanceCount = 0;
+		file.read((char*)&nodeCount, sizeof(nodeCount));
+		for (uint32_t i = 0; i < nodeCount && file; i++) {
+			int32_t parent = -1;
+			glm::mat4 localTransform;
+			file.read((char*)&parent, sizeof(parent));
+			file.read((char*)&localTransform[0][0], sizeof(float) * 16);
+			proxy->model.nodes.addNode(parent < (int32_t)i ? parent : -1, localTransform);
+		}
+		file.read((char*)&instanceCount, sizeof(instanceCount));
+		for (uint32_t i = 0; i < instanceCount && file; i++) {
+			Model::MeshInstance instance;
+			uint8_t transparent = 0;
+			file.read((char*)&instance.node, sizeof(instance.node));
+			file.read((char*)&instance.mesh, sizeof(instance.mesh));
+			file.read((char*)&transparent, sizeof(transparent));
+			instance.transparent = transparent != 0;
+			size_t meshes = instance.transparent ? proxy->model.transparentMeshes.size() : proxy->model.opaqueMeshes.size();
+			if (instance.node < nodeCount && instance.mesh < meshes) {
+				proxy->model.meshInstances.push_back(instance);
+			}
+		}
+		proxy->model.nodes.update();
+		proxy->model.prepareDraws();
+		int32_t importFlags = -1;
+		file.read((char*)&importFlags, sizeof(importFlags));
+		if (!file) {
+			std::cout << "Corrupted model proxy: " << proxyPath(proxyDirectory, modelPath) << std::endl;
+			return nullptr;
+		}
+		//meshes of proxy built with other import settings do not match meshes of full model, it is built again
+		if (importFlags != Model::currentImportFlags()) {
+			return nullptr;
+		}
+		proxy->model.upload();
+		return proxy;
+	}
+
+	bool ModelProxy::build(const std::string& proxyDirectory, const std::string& modelPath, const Model& source, int gridResolution) {
+		//meshes of scan arrive while it streams, proxy would miss them
+		if (source.isStreamingScan()) {
+			return false;
+		}
+		uint64_t fileSize;
+		int64_t modifiedTime;
+		if (!fileStamp(modelPath, fileSize, modifiedTime)) {
+			return false;
+		}
+		glm::vec3 boundsMin, boundsMax;
+		source.getBounds(boundsMin, boundsMax);
+		glm::vec3 extent = boundsMax - boundsMin;
+		float cellSize = std::max(extent.x, std::max(extent.y, extent.z)) / gridResolution;
+		if (cellSize <= 0.f) {
+			cellSize = 1.f;
+		}
+
+		std::error_code error;
+		std::filesystem::create_directories(proxyDirectory, error);
+		std::string path = proxyPath(proxyDirectory, modelPath);
+		std::string temporaryPath = path + ".tmp";
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				std::cout << "Failed to write model proxy: " << path << std::endl;
+				return false;
+			}
+			uint32_t meshCount = (uint32_t)(source.opaqueMeshes.size() + source.transparentMeshes.size());
+			file.write((const char*)&proxyMagic, sizeof(proxyMagic));
+			file.write((const char*)&proxyVersion, sizeof(proxyVersion));
+			file.write((const char*)&fileSize, sizeof(fileSize));
+			file.write((const char*)&modifiedTime, sizeof(modifiedTime));
+			file.write((const char*)&boundsMin[0], sizeof(float) * 3);
+			file.write((const char*)&boundsMax[0], sizeof(float) * 3);
+			file.write((const char*)&meshCount, sizeof(meshCount));
+
+			std::vector<Vertex> vertices;
+			std::vector<unsigned int> indices;
+			std::vector<glm::vec3> meshPositions;
+			std::vector<glm::vec3> meshNormals;
+			std::vector<unsigned int> meshIndices;
+			//meshes of model with preserved hierarchy are in node space, their grid follows scale of first node using them
+			std::vector<float> nodeScales[2];
+			nodeScales[0].assign(source.opaqueMeshes.size(), 1.f);
+			nodeScales[1].assign(source.transparentMeshes.size(), 1.f);
+			for (auto instance = source.meshInstances.rbegin(); instance != source.meshInstances.rend(); ++instance) {
+				float scale = glm::length(glm::vec3(source.nodes.getWorldTransform(instance->node)[0]));
+				nodeScales[instance->transparent ? 1 : 0][instance->mesh] = scale > 0.f ? scale : 1.f;
+			}
+			//same order as full model, opaque meshes first
+			for (const auto* meshes : { &source.opaqueMeshes, &source.transparentMeshes }) {
+				for (size_t meshIndex = 0; meshIndex < meshes->size(); meshIndex++) {
+					const Mesh& mesh = (*meshes)[meshIndex];
+					if (!readGeometry(mesh, meshPositions, meshNormals, meshIndices)) {
+						std::cout << "Cannot build model proxy of " << modelPath << ", mapped mesh data is not readable" << std::endl;
+						file.close();
+						std::filesystem::remove(temporaryPath, error);
+						return false;
+					}
+					glm::vec4 color = mesh.source ? mesh.source->color : mesh.vertices.empty() ? glm::vec4(1.f) : mesh.vertices[0].Color;
+					const TextureImage* image = mesh.hasTexture ? source.findPendingTexture(mesh.texture.path) : nullptr;
+					if (image && image->data) {
+						//textured mesh gets average color of its texture, material alpha is kept
+						color = glm::vec4(glm::vec3(averageColor(*image)), color.a);
+					}
+					if (source.isHierarchical()) {
+						float scale = nodeScales[meshes == &source.opaqueMeshes ? 0 : 1][meshIndex];
+						simplifyMesh(meshPositions, meshNormals, meshIndices, color, mesh.center - glm::vec3(mesh.radius), cellSize / scale, gridResolution, vertices, indices);
+					}
+					else {
+						simplifyMesh(meshPositions, meshNormals, meshIndices, color, boundsMin, cellSize, gridResolution, vertices, indices);
+					}
+
+					uint8_t transparent = mesh.isTransparent ? 1 : 0;
+					uint32_t vertexCount = (uint32_t)vertices.size(), indexCount = (uint32_t)indices.size();
+					file.write((const char*)&transparent, sizeof(transparent));
+					file.write((const char*)&vertexCount, sizeof(vertexCount));
+					file.write((const char*)&indexCount, sizeof(indexCount));
+					file.write((const char*)vertices.data(), vertices.size() * sizeof(Vertex));
+					file.write((const char*)indices.data(), indices.size() * sizeof(unsigned int));
+				}
+			}
+			uint32_t nodeCount = (uint32_t)source.nodes.size(), instanceCount = (uint32_t)source.meshInstances.size();
+			file.write((const char*)&nodeCount, sizeof(nodeCount));
+			for (uint32_t i = 0; i < nodeCount; i++) {
+				int32_t parent = source.nodes.getParent(i);
+				file.write((const char*)&parent, sizeof(parent));
+				file.write((const char*)&source.nodes.getLocalTransform(i)[0][0], sizeof(float) * 16);
+			}
+			file.write((const char*)&instanceCount, sizeof(instanceCount));
+			for (const auto& instance : source.meshInstances) {
+				uint8_t transparent = instance.transparent ? 1 : 0;
+				file.write((const char*)&instance.node, sizeof(instance.node));
+				file.write((const char*)&instance.mesh, sizeof(instance.mesh));
+				file.write((const char*)&transparent, sizeof(transparent));
+			}
+			int32_t importFlags = source.getImportFlags();
+			file.write((const char*)&importFlags, sizeof(importFlags));
+			if (!file) {
+				std::cout << "Failed to write model proxy: " << path << std::endl;
+				return false;
+			}
+		}
+		std::filesystem::rename(temporaryPath, path, error);
+		return !error;
+	}
+
+	void ModelProxy::release(GLDeletionQueue& deletionQueue) {
+		GLObjectList objects;
+		model.releaseGLObjects(objects);
+		deletionQueue.enqueue(std::move(objects));
+	}
+
+	std::string ModelProxy::proxyPath(const std::string& proxyDirectory, const std::string& modelPath) {
+		//FNV-1a of model path, file stamp inside proxy tells whether it is still valid
+		uint64_t hash = 14695981039346656037ull;
+		for (unsigned char c : modelPath) {
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+		std::ostringstream name;
+		name << proxyDirectory << '/' << std::hex << std::setw(16) << std::setfill('0') << hash << ".proxy";
+		return name.str();
+	}
+
+	bool ModelProxy::fileStamp(const std::string& modelPath, uint64_t& fileSize, int64_t& modifiedTime) {
+		std::error_code error;
+		fileSize = std::filesystem::file_size(modelPath, error);
+		if (error) {
+			return false;
+		}
+		modifiedTime = (int64_t)std::filesystem::last_write_time(modelPath, error).time_since_epoch().count();
+		return !error;
+	}
+
+	bool ModelProxy::readGeometry(const Mesh& mesh, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<unsigned int>& indices) {
+		positions.clear();
+		normals.clear();
+		indices.clear();
+		if (!mesh.source) {
+			for (const auto& vertex : mesh.vertices) {
+				positions.push_back(vertex.Position);
+				normals.push_back(vertex.Normal);
+			}
+			indices = mesh.indices;
+			return true;
+		}
+		const MeshSource& source = *mesh.source;
+		if (!source.data || source.indexRange < 0) {
+			return false;
+		}
+		//accessors were checked against their buffers by loader
+		auto readVec3 = [&source](const MeshSourceAttribute& attribute, std::vector<glm::vec3>& values) {
+			if (attribute.range < 0 || attribute.type != GL_FLOAT || attribute.size != 3) {
+				return false;
+			}
+			const unsigned char* data = source.data + source.ranges[attribute.range].offset + attribute.offset;
+			values.resize(source.vertexCount);
+			for (size_t i = 0; i < source.vertexCount; i++) {
+				std::memcpy(&values[i], data + i * attribute.stride, sizeof(glm::vec3));
+			}
+			return true;
+		};
+		if (!readVec3(source.position, positions)) {
+			return false;
+		}
+		//normals are only averaged per cell, missing ones fall back to up vector
+		if (!readVec3(source.normal, normals)) {
+			normals.assign(source.vertexCount, glm::vec3(0.f));
+		}
+		const unsigned char* data = source.data + source.ranges[source.indexRange].offset;
+		indices.resize(source.indexCount);
+		for (size_t i = 0; i < source.indexCount; i++) {
+			if (source.indexType == GL_UNSIGNED_BYTE) {
+				indices[i] = data[i];
+			}
+			else if (source.indexType == GL_UNSIGNED_SHORT) {
+				uint16_t index;
+				std::memcpy(&index, data + i * sizeof(index), sizeof(index));
+				indices[i] = index;
+			}
+			else {
+				std::memcpy(&indices[i], data + i * sizeof(uint32_t), sizeof(uint32_t));
+			}
+			if (indices[i] >= source.vertexCount) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void ModelProxy::simplifyMesh(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<unsigned int>& meshIndices,
+		const glm::vec4& color, const glm::vec3& gridOrigin, float cellSize, int gridResolution, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+		vertices.clear();
+		indices.clear();
+		int cells = gridResolution + 1;
+		std::unordered_map<uint64_t, unsigned int> cellVertices;
+		std::vector<unsigned int> remap(positions.size());
+		std::vector<float> weights;
+
+		//average positions and normals of vertices in each occupied cell
+		for (size_t i = 0; i < positions.size(); i++) {
+			glm::ivec3 cell = glm::clamp(glm::ivec3((positions[i] - gridOrigin) / cellSize), glm::ivec3(0), glm::ivec3(gridResolution));
+			uint64_t key = ((uint64_t)cell.z * cells + cell.y) * cells + cell.x;
+			auto found = cellVertices.find(key);
+			if (found == cellVertices.end()) {
+				Vertex vertex;
+				vertex.Position = glm::vec3(0.f);
+				vertex.Normal = glm::vec3(0.f);
+				vertex.TexCoords = glm::vec2(0.f);
+				vertex.Color = color;
+				found = cellVertices.emplace(key, (unsigned int)vertices.size()).first;
+				vertices.push_back(vertex);
+				weights.push_back(0.f);
+			}
+			Vertex& merged = vertices[found->second];
+			merged.Position += positions[i];
+			merged.Normal += normals[i];
+			weights[found->second] += 1.f;
+			remap[i] = found->second;
+		}
+		for (size_t i = 0; i < vertices.size(); i++) {
+			vertices[i].Position /= weights[i];
+			float length = glm::length(vertices[i].Normal);
+			vertices[i].Normal = length > 0.f ? vertices[i].Normal / length : glm::vec3(0.f, 1.f, 0.f);
+		}
+
+		for (size_t i = 0; i + 2 < meshIndices.size(); i += 3) {
+			unsigned int a = remap[meshIndices[i]], b = remap[meshIndices[i + 1]], c = remap[meshIndices[i + 2]];
+			if (a != b && b != c && a != c) {
+				indices.push_back(a);
+				indices.push_back(b);
+				indices.push_back(c);
+			}
+		}
+	}
+
+	glm::vec4 ModelProxy::averageColor(const TextureImage& image) {
+		//sparse sample is enough for a flat proxy color
+		const int samples = 64;
+		glm::vec4 sum(0.f);
+		float count = 0.f;
+		int stepX = std::max(1, image.width / samples);
+		int stepY = std::max(1, image.height / samples);
+		for (int y = 0; y < image.height; y += stepY) {
+			for (int x = 0; x < image.width; x += stepX) {
+				const unsigned char* pixel = image.data.get() + ((size_t)y * image.width + x) * image.channels;
+				glm::vec4 color(pixel[0], pixel[0], pixel[0], 255.f);
+				if (image.channels >= 3) {
+					color = glm::vec4(pixel[0], pixel[1], pixel[2], 255.f);
+				}
+				if (image.channels == 4 || image.channels == 2) {
+					color.a = pixel[image.channels - 1];
+				}
+				sum += color / 255.f;
+				count += 1.f;
+			}
+		}
+		return count > 0.f ? sum / count : glm::vec4(1.f);
+	}
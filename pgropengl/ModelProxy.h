@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "model.h"
+#include "GLDeletionQueue.h"
+
+//coarse stand-in drawn while full model is still loading
+//holds one simplified untextured mesh for every mesh of full model in the same order,
+//so meshes of full model can replace it one by one as they reach GPU
+class ModelProxy {
+public:
+    Model model;
+    //bounds of full model, so model matrix does not change once full model replaces proxy
+    glm::vec3 boundsMin = glm::vec3(0.f);
+    glm::vec3 boundsMax = glm::vec3(0.f);
+
+    //loads stored proxy of model file and uploads it, returns nullptr when there is none or model file changed since
+    static std::unique_ptr<ModelProxy> load(const std::string& proxyDirectory, const std::string& modelPath);
+    //simplifies CPU side data of model not uploaded yet and stores result, can run on loader thread
+    //meshes drawn from file data are simplified from their mapped accessors, which are released by upload
+    static bool build(const std::string& proxyDirectory, const std::string& modelPath, const Model& source, int gridResolution = 32);
+
+    void release(GLDeletionQueue& deletionQueue);
+
+private:
+    static std::string proxyPath(const std::string& proxyDirectory, const std::string& modelPath);
+    static bool fileStamp(const std::string& modelPath, uint64_t& fileSize, int64_t& modifiedTime);
+    //positions, normals and indices of mesh, from its vertices or from float accessors of its mapped file data
+    //false when mapped data was already released or its format is not readable
+    static bool readGeometry(const Mesh& mesh, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<unsigned int>& indices);
+    //vertex clustering - vertices falling into same grid cell are merged, collapsed triangles dropped
+    static void simplifyMesh(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<unsigned int>& meshIndices,
+        const glm::vec4& color, const glm::vec3& gridOrigin, float cellSize, int gridResolution, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+    static glm::vec4 averageColor(const TextureImage& image);
+};
@@ -0,0 +1,96 @@
+#include "ModelResidency.h"
+#include <iostream>
+
+	ModelResidency::ModelResidency(GLDeletionQueue& deletionQueue, size_t gpuBudgetBytes, size_t cpuBudgetBytes)
+		: deletionQueue(deletionQueue), gpuBudget(gpuBudgetBytes), cpuBudget(cpuBudgetBytes) {
+	}
+
+	ModelResidency::~ModelResidency() {
+		while (!lru.empty()) {
+			evict(lru.back());
+		}
+	}
+
+	Model* ModelResidency::acquire(const std::string& path) {
+		auto found = entries.find(path);
+		if (found != entries.end()) {
+			touch(found->second);
+			return found->second.model.get();
+		}
+		return adopt(path, std::make_unique<Model>(path));
+	}
+
+	Model* ModelResidency::adopt(const std::string& path, std::unique_ptr<Model> model) {
+		if (entries.count(path)) {
+			//already resident, drop the new copy
+			GLObjectList objects;
+			model->releaseGLObjects(objects);
+			deletionQueue.enqueue(std::move(objects));
+			return acquire(path);
+		}
+		if (everLoaded.count(path)) {
+			reloadCount++;
+		}
+		everLoaded.insert(path);
+
+		model->upload();
+		Entry entry;
+		entry.model = std::move(model);
+		entry.gpuBytes = entry.model->gpuBytes();
+		entry.cpuBytes = entry.model->cpuBytes();
+		lru.push_front(path);
+		entry.lruPosition = lru.begin();
+
+		gpuBytes += entry.gpuBytes;
+		cpuBytes += entry.cpuBytes;
+		Model* resident = entry.model.get();
+		entries.emplace(path, std::move(entry));
+
+		enforceBudget();
+		return resident;
+	}
+
+	bool ModelResidency::isResident(const std::string& path) const {
+		return entries.find(path) != entries.end();
+	}
+
+	Model* ModelResidency::peek(const std::string& path) const {
+		auto found = entries.find(path);
+		return found != entries.end() ? found->second.model.get() : nullptr;
+	}
+
+	void ModelResidency::setBudget(size_t gpuBudgetBytes, size_t cpuBudgetBytes) {
+		gpuBudget = gpuBudgetBytes;
+		cpuBudget = cpuBudgetBytes;
+		enforceBudget();
+	}
+
+	void ModelResidency::touch(Entry& entry) {
+		lru.splice(lru.begin(), lru, entry.lruPosition);
+	}
+
+	void ModelResidency::enforceBudget() {
+		while (lru.size() > 1 && (gpuBytes > gpuBudget || cpuBytes > cpuBudget)) {
+			evict(lru.back());
+		}
+	}
+
+	void ModelResidency::evict(std::string path) {
+		auto found = entries.find(path);
+		if (found == entries.end()) {
+			return;
+		}
+		Entry& entry = found->second;
+
+		//commands drawing the model may still be in flight, delete its objects after the fence passes
+		GLObjectList objects;
+		entry.model->releaseGLObjects(objects);
+		deletionQueue.enqueue(std::move(objects));
+
+		gpuBytes -= entry.gpuBytes;
+		cpuBytes -= entry.cpuBytes;
+		lru.erase(entry.lruPosition);
+		entries.erase(found);
+		evictionCount++;
+		std::cout << "Evicted model " << path << std::endl;
+	}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "model.h"
+#include "GLDeletionQueue.h"
+
+//keeps loaded models within video and main memory budget
+//least recently viewed models are evicted when over budget and loaded again on next request
+class ModelResidency {
+public:
+    ModelResidency(GLDeletionQueue& deletionQueue, size_t gpuBudgetBytes, size_t cpuBudgetBytes);
+    ~ModelResidency();
+
+    //returns resident model, loads it through Model constructor if it was not loaded or was evicted
+    Model* acquire(const std::string& path);
+    //takes over model loaded elsewhere (e.g. by prefetcher), model is uploaded to GPU if it was not yet
+    Model* adopt(const std::string& path, std::unique_ptr<Model> model);
+    bool isResident(const std::string& path) const;
+    //resident model without marking it as viewed, nullptr if not resident
+    Model* peek(const std::string& path) const;
+
+    void setBudget(size_t gpuBudgetBytes, size_t cpuBudgetBytes);
+
+    size_t getGpuBytes() const { return gpuBytes; }
+    size_t getCpuBytes() const { return cpuBytes; }
+    size_t getGpuBudget() const { return gpuBudget; }
+    size_t getCpuBudget() const { return cpuBudget; }
+    size_t getResidentCount() const { return entries.size(); }
+    unsigned int getEvictionCount() const { return evictionCount; }
+    unsigned int getReloadCount() const { return reloadCount; }
+
+private:
+    struct Entry {
+        std::unique_ptr<Model> model;
+        size_t gpuBytes;
+        size_t cpuBytes;
+        //position in lru list
+        std::list<std::string>::iterator lruPosition;
+    };
+
+    void touch(Entry& entry);
+    //evicts least recently viewed models until within budget, most recent model is always kept
+    void enforceBudget();
+    void evict(std::string path);
+
+    std::unordered_map<std::string, Entry> entries;
+    //front is most recently viewed model
+    std::list<std::string> lru;
+    //GL objects of evicted models are deleted once GPU finished all commands using them
+    GLDeletionQueue& deletionQueue;
+    //paths of models loaded at least once, used to count reloads after eviction
+    std::unordered_set<std::string> everLoaded;
+
+    size_t gpuBudget;
+    size_t cpuBudget;
+    size_t gpuBytes = 0;
+    size_t cpuBytes = 0;
+    unsigned int evictionCount = 0;
+    unsigned int reloadCount = 0;
+};
@@ -0,0 +1,576 @@
+#include "ObjLoader.h"
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <unordered_map>
+
+//smaller files are parsed by one thread, starting more would cost more than it saves
+static const size_t minChunkBytes = 1024 * 1024;
+
+//indices of face corner into positions, texture coordinates and normals, -1 when missing
+struct ObjCorner {
+	int32_t position;
+	int32_t texCoord;
+	int32_t normal;
+
+	bool operator==(const ObjCorner& other) const {
+		return position == other.position && texCoord == other.texCoord && normal == other.normal;
+	}
+};
+
+struct ObjCornerHash {
+	size_t operator()(const ObjCorner& corner) const {
+		uint64_t hash = (uint64_t)(uint32_t)corner.position * 0x9E3779B97F4A7C15ull;
+		hash ^= ((uint64_t)(uint32_t)corner.texCoord + 0x632BE59BD9B4E019ull) * 0xBF58476D1CE4E5B9ull;
+		hash ^= ((uint64_t)(uint32_t)corner.normal + 0x8CB92BA72F3D8DD7ull) * 0x94D049BB133111EBull;
+		return (size_t)(hash ^ (hash >> 31));
+	}
+};
+
+//object or material change inside chunk, applies to triangles from firstTriangle to next group
+struct ObjGroup {
+	bool setsObject = false;
+	bool setsMaterial = false;
+	std::string object;
+	std::string material;
+	size_t firstTriangle = 0;
+};
+
+//data of one line-aligned part of file, indices of positive references are already absolute
+struct ObjChunk {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> texCoords;
+	std::vector<glm::vec3> normals;
+	//three per triangle
+	std::vector<ObjCorner> corners;
+	//corner * 3 + attribute of negative references, they count back from end of chunk data so far and get chunk offset added later
+	std::vector<size_t> relative;
+	std::vector<ObjGroup> groups;
+	std::vector<std::string> materialLibraries;
+};
+
+struct ObjMaterial {
+	//assimp default for materials without Kd
+	glm::vec3 diffuse = glm::vec3(0.6f);
+	float alpha = 1.f;
+	std::string texture;
+};
+
+//triangles of one chunk belonging to mesh
+struct ObjMeshPart {
+	size_t chunk;
+	size_t firstTriangle;
+	size_t endTriangle;
+};
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool isBlank(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* skipBlanks(const char* p, const char* end) {
+	while (p < end && isBlank(*p)) {
+		p++;
+	}
+	return p;
+}
+
+//rest of line without surrounding blanks
+static std::string restOfLine(const char* p, const char* end) {
+	p = skipBlanks(p, end);
+	while (end > p && isBlank(end[-1])) {
+		end--;
+	}
+	return std::string(p, end);
+}
+
+static const char* parseFloat(const char* p, const char* end, float& value) {
+	p = skipBlanks(p, end);
+	//from_chars does not accept plus sign
+	if (p < end && *p == '+') {
+		p++;
+	}
+	std::from_chars_result result = std::from_chars(p, end, value);
+	if (result.ec != std::errc()) {
+		value = 0.f;
+		while (p < end && !isBlank(*p)) {
+			p++;
+		}
+		return p;
+	}
+	return result.ptr;
+}
+
+//one index of face corner, present is false when it is empty (like texture coordinate of a//c)
+static const char* parseIndex(const char* p, const char* end, int64_t& value, bool& present) {
+	bool negative = p < end && *p == '-';
+	if (negative || (p < end && *p == '+')) {
+		p++;
+	}
+	value = 0;
+	present = false;
+	while (p < end && *p >= '0' && *p <= '9') {
+		value = value * 10 + (*p - '0');
+		present = true;
+		p++;
+	}
+	if (negative) {
+		value = -value;
+	}
+	return p;
+}
+
+static bool startsWith(const char* p, const char* end, const char* keyword) {
+	size_t length = std::strlen(keyword);
+	return (size_t)(end - p) > length && std::memcmp(p, keyword, length) == 0 && isBlank(p[length]);
+}
+
+static void parseChunk(const char* begin, const char* end, ObjChunk& chunk) {
+	chunk.groups.push_back(ObjGroup());
+	//changes before first triangle of group replace it instead of leaving empty groups
+	auto group = [&chunk]() -> ObjGroup& {
+		if (chunk.groups.back().firstTriangle != chunk.corners.size() / 3) {
+			ObjGroup next;
+			next.firstTriangle = chunk.corners.size() / 3;
+			chunk.groups.push_back(next);
+		}
+		return chunk.groups.back();
+	};
+	std::vector<ObjCorner> polygon;
+	std::vector<uint8_t> polygonRelative;
+
+	const char* line = begin;
+	while (line < end) {
+		const char* lineEnd = (const char*)std::memchr(line, '\n', end - line);
+		if (!lineEnd) {
+			lineEnd = end;
+		}
+		const char* p = skipBlanks(line, lineEnd);
+		line = lineEnd + 1;
+		if (p == lineEnd) {
+			continue;
+		}
+		if (p[0] == 'v' && p + 1 < lineEnd) {
+			if (isBlank(p[1])) {
+				glm::vec3 position;
+				p = parseFloat(p + 1, lineEnd, position.x);
+				p = parseFloat(p, lineEnd, position.y);
+				parseFloat(p, lineEnd, position.z);
+				chunk.positions.push_back(position);
+			}
+			else if (p[1] == 't' && p + 2 < lineEnd && isBlank(p[2])) {
+				glm::vec2 texCoord;
+				p = parseFloat(p + 2, lineEnd, texCoord.x);
+				parseFloat(p, lineEnd, texCoord.y);
+				//aiProcess_FlipUVs
+				texCoord.y = 1.f - texCoord.y;
+				chunk.texCoords.push_back(texCoord);
+			}
+			else if (p[1] == 'n' && p + 2 < lineEnd && isBlank(p[2])) {
+				glm::vec3 normal;
+				p = parseFloat(p + 2, lineEnd, normal.x);
+				p = parseFloat(p, lineEnd, normal.y);
+				parseFloat(p, lineEnd, normal.z);
+				chunk.normals.push_back(normal);
+			}
+		}
+		else if (p[0] == 'f' && p + 1 < lineEnd && isBlank(p[1])) {
+			polygon.clear();
+			polygonRelative.clear();
+			const size_t counts[3] = { chunk.positions.size(), chunk.texCoords.size(), chunk.normals.size() };
+			p = skipBlanks(p + 1, lineEnd);
+			while (p < lineEnd) {
+				int32_t values[3] = { -1, -1, -1 };
+				uint8_t relative = 0;
+				for (int attribute = 0; attribute < 3; attribute++) {
+					int64_t value;
+					bool present;
+					p = parseIndex(p, lineEnd, value, present);
+					if (present && value > 0) {
+						values[attribute] = (int32_t)(value - 1);
+					}
+					else if (present && value < 0) {
+						values[attribute] = (int32_t)((int64_t)counts[attribute] + value);
+						relative |= 1 << attribute;
+					}
+					if (p >= lineEnd || *p != '/') {
+						break;
+					}
+					p++;
+				}
+				polygon.push_back({ values[0], values[1], values[2] });
+				polygonRelative.push_back(relative);
+				while (p < lineEnd && !isBlank(*p)) {
+					p++;
+				}
+				p = skipBlanks(p, lineEnd);
+			}
+			//fan triangulation, like aiProcess_Triangulate for convex polygons
+			for (size_t i = 2; i < polygon.size(); i++) {
+				for (size_t corner : { (size_t)0, i - 1, i }) {
+					for (int attribute = 0; attribute < 3; attribute++) {
+						if (polygonRelative[corner] & (1 << attribute)) {
+							chunk.relative.push_back(chunk.corners.size() * 3 + attribute);
+						}
+					}
+					chunk.corners.push_back(polygon[corner]);
+				}
+			}
+		}
+		else if ((p[0] == 'o' || p[0] == 'g') && p + 1 < lineEnd && isBlank(p[1])) {
+			ObjGroup& current = group();
+			current.setsObject = true;
+			current.object = restOfLine(p + 1, lineEnd);
+		}
+		else if (startsWith(p, lineEnd, "usemtl")) {
+			ObjGroup& current = group();
+			current.setsMaterial = true;
+			current.material = restOfLine(p + 6, lineEnd);
+		}
+		else if (startsWith(p, lineEnd, "mtllib")) {
+			chunk.materialLibraries.push_back(restOfLine(p + 6, lineEnd));
+		}
+	}
+}
+
+//path of map_Kd follows its options, which start with dash and take numeric or on/off arguments
+static std::string texturePath(const char* p, const char* end) {
+	p = skipBlanks(p, end);
+	while (p < end && *p == '-') {
+		while (p < end && !isBlank(*p)) {
+			p++;
+		}
+		p = skipBlanks(p, end);
+		while (p < end) {
+			const char* token = p;
+			while (p < end && !isBlank(*p)) {
+				p++;
+			}
+			std::string argument(token, p);
+			float number;
+			bool isArgument = argument == "on" || argument == "off" ||
+				std::from_chars(argument.data(), argument.data() + argument.size(), number).ptr == argument.data() + argument.size();
+			if (!isArgument) {
+				p = token;
+				break;
+			}
+			p = skipBlanks(p, end);
+		}
+	}
+	return restOfLine(p, end);
+}
+
+static void loadMaterialLibrary(const std::string& path, MappedFileCache* cache, std::map<std::string, ObjMaterial>& materials) {
+	std::shared_ptr<MappedFile> file = MapFile(path, cache);
+	if (!file) {
+		std::cout << "Failed to load material library " << path << std::endl;
+		return;
+	}
+	const char* data = (const char*)file->data();
+	const char* end = data + file->size();
+	ObjMaterial* material = nullptr;
+	for (const char* line = data; line < end;) {
+		const char* lineEnd = (const char*)std::memchr(line, '\n', end - line);
+		if (!lineEnd) {
+			lineEnd = end;
+		}
+		const char* p = skipBlanks(line, lineEnd);
+		line = lineEnd + 1;
+		if (startsWith(p, lineEnd, "newmtl")) {
+			material = &materials[restOfLine(p + 6, lineEnd)];
+			*material = ObjMaterial();
+		}
+		else if (!material) {
+			continue;
+		}
+		else if (startsWith(p, lineEnd, "Kd")) {
+			p = parseFloat(p + 2, lineEnd, material->diffuse.r);
+			p = parseFloat(p, lineEnd, material->diffuse.g);
+			parseFloat(p, lineEnd, material->diffuse.b);
+		}
+		else if (startsWith(p, lineEnd, "d")) {
+			parseFloat(p + 1, lineEnd, material->alpha);
+		}
+		else if (startsWith(p, lineEnd, "Tr")) {
+			float transparency;
+			parseFloat(p + 2, lineEnd, transparency);
+			material->alpha = 1.f - transparency;
+		}
+		else if (startsWith(p, lineEnd, "map_Kd")) {
+			material->texture = texturePath(p + 6, lineEnd);
+		}
+	}
+}
+
+static Mesh buildMesh(const std::vector<ObjChunk>& chunks, const std::vector<ObjMeshPart>& parts, const ObjMaterial& material,
+	const std::vector<glm::vec3>& positions, const std::vector<glm::vec2>& texCoords, const std::vector<glm::vec3>& normals) {
+	auto triangleCorners = [&chunks](const ObjMeshPart& part, size_t triangle) { return &chunks[part.chunk].corners[triangle * 3]; };
+	auto validPosition = [&positions](int32_t index) { return index >= 0 && (size_t)index < positions.size(); };
+
+	//aiProcess_GenSmoothNormals for corners without normal, average of normalized face normals around position
+	std::unordered_map<int32_t, glm::vec3> smoothNormals;
+	for (const auto& part : parts) {
+		for (size_t triangle = part.firstTriangle; triangle < part.endTriangle; triangle++) {
+			const ObjCorner* corners = triangleCorners(part, triangle);
+			bool missingNormal = false;
+			for (int i = 0; i < 3; i++) {
+				missingNormal |= corners[i].normal < 0 || (size_t)corners[i].normal >= normals.size();
+			}
+			if (!missingNormal || !validPosition(corners[0].position) || !validPosition(corners[1].position) || !validPosition(corners[2].position)) {
+				continue;
+			}
+			glm::vec3 faceNormal = glm::cross(positions[corners[1].position] - positions[corners[0].position], positions[corners[2].position] - positions[corners[0].position]);
+			float length = glm::length(faceNormal);
+			if (length > 0.f) {
+				for (int i = 0; i < 3; i++) {
+					smoothNormals[corners[i].position] += faceNormal / length;
+				}
+			}
+		}
+	}
+
+	glm::vec4 color = glm::vec4(material.diffuse, material.alpha);
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	std::unordered_map<ObjCorner, unsigned int, ObjCornerHash> vertexOf;
+	size_t triangles = 0;
+	for (const auto& part : parts) {
+		triangles += part.endTriangle - part.firstTriangle;
+	}
+	//closed meshes have about half as many vertices as triangles
+	vertexOf.reserve(triangles / 2 + 3);
+	vertices.reserve(triangles / 2 + 3);
+	indices.reserve(triangles * 3);
+	for (const auto& part : parts) {
+		for (size_t triangle = part.firstTriangle; triangle < part.endTriangle; triangle++) {
+			const ObjCorner* corners = triangleCorners(part, triangle);
+			//triangle referring to missing position is dropped, assimp would reject whole file
+			if (!validPosition(corners[0].position) || !validPosition(corners[1].position) || !validPosition(corners[2].position)) {
+				continue;
+			}
+			for (int i = 0; i < 3; i++) {
+				ObjCorner corner = corners[i];
+				if (corner.texCoord < 0 || corner.texCoord >= (int32_t)texCoords.size()) {
+					corner.texCoord = -1;
+				}
+				if (corner.normal < 0 || corner.normal >= (int32_t)normals.size()) {
+					corner.normal = -1;
+				}
+				auto inserted = vertexOf.emplace(corner, (unsigned int)vertices.size());
+				if (inserted.second) {
+					Vertex vertex;
+					vertex.Position = positions[corner.position];
+					if (corner.normal >= 0) {
+						vertex.Normal = normals[corner.normal];
+					}
+					else {
+						auto smooth = smoothNormals.find(corner.position);
+						vertex.Normal = smooth != smoothNormals.end() && glm::length(smooth->second) > 0.f ? glm::normalize(smooth->second) : glm::vec3(0.f);
+					}
+					vertex.TexCoords = corner.texCoord >= 0 ? texCoords[corner.texCoord] : glm::vec2(0.f);
+					vertex.Color = color;
+					vertices.push_back(vertex);
+				}
+				indices.push_back(inserted.first->second);
+			}
+		}
+	}
+	Texture texture;
+	texture.path = material.texture;
+	return Mesh(std::move(vertices), std::move(indices), texture, !material.texture.empty(), material.alpha < 1.f);
+}
+
+//runs task(i) for i below count on all hardware threads, at most one thread per item
+template <typename Task>
+static void parallelFor(size_t count, Task task) {
+	std::atomic<size_t> next{ 0 };
+	auto worker = [&]() {
+		for (size_t i = next++; i < count; i = next++) {
+			task(i);
+		}
+	};
+	unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = (unsigned int)std::min<size_t>(threadCount, count);
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < threadCount; i++) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : workers) {
+		thread.join();
+	}
+}
+
+bool IsObjPath(const std::string& path) {
+	static const char extension[] = ".obj";
+	size_t length = sizeof(extension) - 1;
+	if (path.size() < length) {
+		return false;
+	}
+	for (size_t i = 0; i < length; i++) {
+		if (std::tolower((unsigned char)path[path.size() - length + i]) != extension[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool LoadObj(const std::string& path, bool mergeByMaterial, ObjScene& scene, ObjLoadStats* stats, MappedFileCache* cache) {
+	auto start = std::chrono::steady_clock::now();
+	std::shared_ptr<MappedFile> file = MapFile(path, cache);
+	if (!file) {
+		std::cout << "Failed to open " << path << std::endl;
+		return false;
+	}
+	const char* data = (const char*)file->data();
+	size_t size = file->size();
+
+	//chunk boundaries are moved after next line end, so every line is parsed by one thread
+	unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+	size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, size / minChunkBytes));
+	std::vector<size_t> bounds(chunkCount + 1, size);
+	bounds[0] = 0;
+	for (size_t i = 1; i < chunkCount; i++) {
+		size_t bound = std::max(bounds[i - 1], size * i / chunkCount);
+		const char* lineEnd = bound < size ? (const char*)std::memchr(data + bound, '\n', size - bound) : nullptr;
+		bounds[i] = lineEnd ? lineEnd - data + 1 : size;
+	}
+	std::vector<ObjChunk> chunks(chunkCount);
+	parallelFor(chunkCount, [&](size_t i) {
+		parseChunk(data + bounds[i], data + bounds[i + 1], chunks[i]);
+	});
+	double parseMs = millisecondsSince(start);
+
+	//chunk data is joined, negative references get offset of their chunk
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> texCoords;
+	std::vector<glm::vec3> normals;
+	std::map<std::string, ObjMaterial> materials;
+	std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+	for (auto& chunk : chunks) {
+		const int32_t offsets[3] = { (int32_t)positions.size(), (int32_t)texCoords.size(), (int32_t)normals.size() };
+		for (size_t relative : chunk.relative) {
+			ObjCorner& corner = chunk.corners[relative / 3];
+			int32_t* values[3] = { &corner.position, &corner.texCoord, &corner.normal };
+			*values[relative % 3] += offsets[relative % 3];
+		}
+		positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+		texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+		normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+		for (const auto& library : chunk.materialLibraries) {
+			loadMaterialLibrary(directory + library, cache, materials);
+		}
+	}
+
+	//triangles are assigned to meshes by object and material in file order, state at start of chunk is state at end of previous one
+	std::map<std::pair<std::string, std::string>, size_t> meshOf;
+	std::map<std::string, size_t> objectOf;
+	std::vector<std::vector<ObjMeshPart>> meshParts;
+	std::vector<std::string> meshMaterials;
+	std::string object;
+	std::string material;
+	scene.meshes.clear();
+	scene.objects.clear();
+	for (size_t i = 0; i < chunks.size(); i++) {
+		const ObjChunk& chunk = chunks[i];
+		for (size_t g = 0; g < chunk.groups.size(); g++) {
+			const ObjGroup& group = chunk.groups[g];
+			object = group.setsObject ? group.object : object;
+			material = group.setsMaterial ? group.material : material;
+			size_t endTriangle = g + 1 < chunk.groups.size() ? chunk.groups[g + 1].firstTriangle : chunk.corners.size() / 3;
+			if (endTriangle == group.firstTriangle) {
+				continue;
+			}
+			std::string objectName = mergeByMaterial ? std::string() : object;
+			auto found = meshOf.find({ objectName, material });
+			if (found == meshOf.end()) {
+				auto objectFound = objectOf.find(objectName);
+				if (objectFound == objectOf.end()) {
+					objectFound = objectOf.emplace(objectName, scene.objects.size()).first;
+					scene.objects.push_back({ objectName, {} });
+				}
+				scene.objects[objectFound->second].meshes.push_back(meshParts.size());
+				found = meshOf.emplace(std::make_pair(objectName, material), meshParts.size()).first;
+				meshParts.emplace_back();
+				meshMaterials.push_back(material);
+			}
+			meshParts[found->second].push_back({ i, group.firstTriangle, endTriangle });
+		}
+	}
+
+	//largest meshes first, so one big mesh does not finish last on single thread
+	std::vector<size_t> order(meshParts.size());
+	std::vector<size_t> triangleCounts(meshParts.size(), 0);
+	for (size_t i = 0; i < order.size(); i++) {
+		order[i] = i;
+		for (const auto& part : meshParts[i]) {
+			triangleCounts[i] += part.endTriangle - part.firstTriangle;
+		}
+	}
+	std::sort(order.begin(), order.end(), [&triangleCounts](size_t a, size_t b) { return triangleCounts[a] > triangleCounts[b]; });
+	std::vector<Mesh> meshes(meshParts.size(), Mesh({}, {}, Texture(), false, false));
+	const ObjMaterial defaultMaterial;
+	parallelFor(order.size(), [&](size_t i) {
+		size_t mesh = order[i];
+		auto found = materials.find(meshMaterials[mesh]);
+		meshes[mesh] = buildMesh(chunks, meshParts[mesh], found != materials.end() ? found->second : defaultMaterial, positions, texCoords, normals);
+	});
+	scene.meshes = std::move(meshes);
+
+	if (stats) {
+		stats->fileBytes = size;
+		stats->chunks = (unsigned int)chunkCount;
+		stats->triangles = 0;
+		stats->vertices = 0;
+		for (const auto& mesh : scene.meshes) {
+			stats->triangles += mesh.indices.size() / 3;
+			stats->vertices += mesh.vertices.size();
+		}
+		stats->corners = stats->triangles * 3;
+		stats->parseMs = parseMs;
+		stats->totalMs = millisecondsSince(start);
+		stats->buildMs = stats->totalMs - parseMs;
+	}
+	return true;
+}
+
+ObjBenchmarkResult BenchmarkObjLoader(const std::string& path, int runs) {
+	ObjBenchmarkResult result;
+	result.runs = runs;
+	for (int run = 0; run < runs; run++) {
+		ObjScene scene;
+		ObjLoadStats stats;
+		if (!LoadObj(path, true, scene, &stats)) {
+			return result;
+		}
+		result.fileBytes = stats.fileBytes;
+		result.nativeMs = run == 0 ? stats.totalMs : std::min(result.nativeMs, stats.totalMs);
+
+		auto start = std::chrono::steady_clock::now();
+		Assimp::Importer importer;
+		const aiScene* assimpScene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_PreTransformVertices);
+		double assimpMs = millisecondsSince(start);
+		if (!assimpScene) {
+			std::cout << importer.GetErrorString() << std::endl;
+			return result;
+		}
+		result.assimpMs = run == 0 ? assimpMs : std::min(result.assimpMs, assimpMs);
+	}
+	result.valid = true;
+	std::cout << "Obj benchmark " << path << " (" << result.fileBytes / 1024 << " KB, best of " << runs << "): native " << result.nativeMs << " ms, "
+		<< result.nativeMegabytesPerSecond() << " MB/s, assimp " << result.assimpMs << " ms, " << result.assimpMegabytesPerSecond() << " MB/s" << std::endl;
+	return result;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "mesh.h"
+#include "MappedFileCache.h"
+
+//o or g section of obj file, meshes are its parts with different materials
+struct ObjObject {
+    std::string name;
+    std::vector<size_t> meshes;
+};
+
+struct ObjScene {
+    std::vector<Mesh> meshes;
+    //every mesh belongs to exactly one object, single unnamed object when meshes were merged by material
+    std::vector<ObjObject> objects;
+};
+
+//sizes and phase times of one load
+struct ObjLoadStats {
+    size_t fileBytes = 0;
+    unsigned int chunks = 0;
+    size_t triangles = 0;
+    //face corners before and after corners with same position, texture coordinate and normal were shared
+    size_t corners = 0;
+    size_t vertices = 0;
+    double parseMs = 0.0;
+    double buildMs = 0.0;
+    double totalMs = 0.0;
+
+    double megabytesPerSecond() const { return totalMs > 0.0 ? fileBytes / (1024.0 * 1024.0) / (totalMs / 1000.0) : 0.0; }
+};
+
+//true for .obj extension in any case
+bool IsObjPath(const std::string& path);
+
+//loads obj file and its mtl libraries into meshes matching those processAssimpMesh makes from assimp import with Triangulate, GenSmoothNormals and FlipUVs
+//file is mapped and split into line-aligned chunks parsed on all hardware threads (floats by std::from_chars), meshes are then built in parallel,
+//corners with same position, texture coordinate and normal index share one vertex, polygons are triangulated as fans
+//mergeByMaterial joins parts of all objects with the same material into one mesh, like aiProcess_PreTransformVertices
+//texture paths are left as written in mtl file, relative to directory of obj file, files are read through cache when given
+bool LoadObj(const std::string& path, bool mergeByMaterial, ObjScene& scene, ObjLoadStats* stats = nullptr, MappedFileCache* cache = nullptr);
+
+//best times of native parser and assimp importing the same file, both read from disk on every run
+struct ObjBenchmarkResult {
+    bool valid = false;
+    size_t fileBytes = 0;
+    int runs = 0;
+    double nativeMs = 0.0;
+    double assimpMs = 0.0;
+
+    double nativeMegabytesPerSecond() const { return nativeMs > 0.0 ? fileBytes / (1024.0 * 1024.0) / (nativeMs / 1000.0) : 0.0; }
+    double assimpMegabytesPerSecond() const { return assimpMs > 0.0 ? fileBytes / (1024.0 * 1024.0) / (assimpMs / 1000.0) : 0.0; }
+};
+
+//imports obj file runs times by LoadObj and by assimp (pretransformed, like flat models are loaded) and prints throughput in MB/s
+//native time includes building Mesh vertices, assimp time ends with aiScene, so comparison favours assimp
+ObjBenchmarkResult BenchmarkObjLoader(const std::string& path, int runs = 3);
@@ -0,0 +1,582 @@
+#include "OctreeBuilder.h"
+#include "ScanLoader.h"
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+//splits stop here even when node is over budget, its triangles may all share one spot
+static const uint32_t maxOctreeDepth = 16;
+//triangles read and written at once while collecting and splitting
+static const size_t blockTriangles = 16384;
+//color of scans and meshes without material, like assimp default
+static const glm::vec4 defaultColor = glm::vec4(0.6f, 0.6f, 0.6f, 1.f);
+
+//triangle as stored in temporary files between splits
+struct OctreeTriangle {
+	glm::vec3 corners[3];
+	uint32_t color;
+};
+
+//geometry of finished node kept until its parent clusters it, weights count original vertices merged into each vertex
+struct OctreeGeometry {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec4> colors;
+	std::vector<float> weights;
+	std::vector<uint32_t> indices;
+};
+
+//welding key of leaf vertex, bits of position and color
+struct OctreeVertexKey {
+	uint32_t bits[4];
+
+	bool operator==(const OctreeVertexKey& other) const {
+		return std::memcmp(bits, other.bits, sizeof(bits)) == 0;
+	}
+};
+
+struct OctreeVertexKeyHash {
+	size_t operator()(const OctreeVertexKey& key) const {
+		uint64_t hash = (uint64_t)key.bits[0] * 0x9E3779B97F4A7C15ull;
+		hash ^= ((uint64_t)key.bits[1] + 0x632BE59BD9B4E019ull) * 0xBF58476D1CE4E5B9ull;
+		hash ^= ((uint64_t)key.bits[2] + 0x8CB92BA72F3D8DD7ull) * 0x94D049BB133111EBull;
+		hash ^= ((uint64_t)key.bits[3] + 0x2545F4914F6CDD1Dull) * 0x9E3779B97F4A7C15ull;
+		return (size_t)(hash ^ (hash >> 31));
+	}
+};
+
+//clustered triangle by its cell vertices, rotated so smallest comes first and winding is kept
+struct OctreeClusterTriangle {
+	uint32_t vertices[3];
+
+	bool operator==(const OctreeClusterTriangle& other) const {
+		return vertices[0] == other.vertices[0] && vertices[1] == other.vertices[1] && vertices[2] == other.vertices[2];
+	}
+};
+
+struct OctreeClusterTriangleHash {
+	size_t operator()(const OctreeClusterTriangle& triangle) const {
+		uint64_t hash = (uint64_t)triangle.vertices[0] * 0x9E3779B97F4A7C15ull;
+		hash ^= ((uint64_t)triangle.vertices[1] + 0x632BE59BD9B4E019ull) * 0xBF58476D1CE4E5B9ull;
+		hash ^= ((uint64_t)triangle.vertices[2] + 0x8CB92BA72F3D8DD7ull) * 0x94D049BB133111EBull;
+		return (size_t)(hash ^ (hash >> 31));
+	}
+};
+
+//vertex clustering of node cell - vertices falling into same grid cell are merged weighted by vertices they stand for,
+//triangles collapsed by merging and triangles repeated by more children are dropped
+class OctreeClusterGrid {
+public:
+	OctreeClusterGrid(const glm::vec3& cellMin, float cellSize, int resolution)
+		: origin(cellMin), gridCellSize(cellSize / resolution), resolution(resolution) {
+	}
+
+	void add(const OctreeGeometry& geometry) {
+		std::vector<uint32_t> remap(geometry.positions.size());
+		for (size_t i = 0; i < geometry.positions.size(); i++) {
+			glm::ivec3 cell = glm::clamp(glm::ivec3(glm::floor((geometry.positions[i] - origin) / gridCellSize)), glm::ivec3(0), glm::ivec3(resolution - 1));
+			uint64_t key = ((uint64_t)cell.z * resolution + cell.y) * resolution + cell.x;
+			auto found = cells.emplace(key, (uint32_t)weights.size());
+			if (found.second) {
+				positions.push_back(glm::vec3(0.f));
+				normals.push_back(glm::vec3(0.f));
+				colors.push_back(glm::vec4(0.f));
+				weights.push_back(0.f);
+			}
+			uint32_t merged = found.first->second;
+			float weight = geometry.weights[i];
+			positions[merged] += geometry.positions[i] * weight;
+			normals[merged] += geometry.normals[i] * weight;
+			colors[merged] += geometry.colors[i] * weight;
+			weights[merged] += weight;
+			remap[i] = merged;
+		}
+		for (size_t i = 0; i + 2 < geometry.indices.size(); i += 3) {
+			uint32_t a = remap[geometry.indices[i]], b = remap[geometry.indices[i + 1]], c = remap[geometry.indices[i + 2]];
+			if (a == b || b == c || a == c) {
+				continue;
+			}
+			OctreeClusterTriangle triangle = { { a, b, c } };
+			while (triangle.vertices[0] > triangle.vertices[1] || triangle.vertices[0] > triangle.vertices[2]) {
+				std::rotate(triangle.vertices, triangle.vertices + 1, triangle.vertices + 3);
+			}
+			triangles.insert(triangle);
+		}
+	}
+
+	//merged vertices which are still used by some triangle
+	void extract(OctreeGeometry& geometry) {
+		geometry = OctreeGeometry();
+		std::vector<uint32_t> remap(weights.size(), octreeNoChild);
+		for (const auto& triangle : triangles) {
+			for (uint32_t vertex : triangle.vertices) {
+				if (remap[vertex] == octreeNoChild) {
+					remap[vertex] = (uint32_t)geometry.positions.size();
+					float length = glm::length(normals[vertex]);
+					geometry.positions.push_back(positions[vertex] / weights[vertex]);
+					geometry.normals.push_back(length > 0.f ? normals[vertex] / length : glm::vec3(0.f, 1.f, 0.f));
+					geometry.colors.push_back(colors[vertex] / weights[vertex]);
+					geometry.weights.push_back(weights[vertex]);
+				}
+				geometry.indices.push_back(remap[vertex]);
+			}
+		}
+	}
+
+private:
+	glm::vec3 origin;
+	float gridCellSize;
+	int resolution;
+	std::unordered_map<uint64_t, uint32_t> cells;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec4> colors;
+	std::vector<float> weights;
+	std::unordered_set<OctreeClusterTriangle, OctreeClusterTriangleHash> triangles;
+};
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint32_t packColor(const glm::vec4& color) {
+	glm::uvec4 bytes = glm::uvec4(glm::clamp(color, 0.f, 1.f) * 255.f + 0.5f);
+	return bytes.r | (bytes.g << 8) | (bytes.b << 16) | (bytes.a << 24);
+}
+
+static glm::vec4 unpackColor(uint32_t color) {
+	return glm::vec4(color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF, color >> 24) / 255.f;
+}
+
+static bool sourceStamp(const std::string& modelPath, uint64_t& size, int64_t& modified) {
+	std::error_code error;
+	size = std::filesystem::file_size(modelPath, error);
+	if (error) {
+		return false;
+	}
+	modified = (int64_t)std::filesystem::last_write_time(modelPath, error).time_since_epoch().count();
+	return !error;
+}
+
+//triangles of model written to temporary file in blocks, bounds grow with them
+class OctreeTriangleWriter {
+public:
+	explicit OctreeTriangleWriter(const std::string& path) : file(path, std::ios::binary | std::ios::trunc) {
+		block.reserve(blockTriangles);
+	}
+
+	void add(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, uint32_t color) {
+		//nan would break splitting and clustering
+		for (const glm::vec3* corner : { &a, &b, &c }) {
+			if (!std::isfinite(corner->x) || !std::isfinite(corner->y) || !std::isfinite(corner->z)) {
+				return;
+			}
+		}
+		if (count == 0 && block.empty()) {
+			boundsMin = boundsMax = a;
+		}
+		block.push_back({ { a, b, c }, color });
+		for (const glm::vec3* corner : { &a, &b, &c }) {
+			boundsMin = glm::min(boundsMin, *corner);
+			boundsMax = glm::max(boundsMax, *corner);
+		}
+		if (block.size() == blockTriangles) {
+			flush();
+		}
+	}
+
+	bool close() {
+		flush();
+		file.close();
+		return !file.fail();
+	}
+
+	bool isOpen() const { return file.is_open(); }
+
+	size_t count = 0;
+	glm::vec3 boundsMin = glm::vec3(0.f);
+	glm::vec3 boundsMax = glm::vec3(0.f);
+
+private:
+	void flush() {
+		file.write((const char*)block.data(), block.size() * sizeof(OctreeTriangle));
+		count += block.size();
+		block.clear();
+	}
+
+	std::ofstream file;
+	std::vector<OctreeTriangle> block;
+};
+
+//reads binary ply or stl by streaming loader, chunks are taken as soon as they are parsed so the whole file is never in memory
+static bool collectScan(const std::string& modelPath, OctreeTriangleWriter& writer, std::string& unsupported) {
+	std::shared_ptr<ScanStream> stream = ScanStream::open(modelPath, (size_t)4 << 20, unsupported);
+	if (!stream) {
+		return false;
+	}
+	uint32_t color = packColor(defaultColor);
+	while (!stream->isDone()) {
+		std::shared_ptr<MeshSource> chunk;
+		if (!stream->pop(chunk)) {
+			stream->wait();
+			continue;
+		}
+		const unsigned char* vertices = chunk->data + chunk->ranges[chunk->position.range].offset + chunk->position.offset;
+		const uint32_t* indices = (const uint32_t*)(chunk->data + chunk->ranges[chunk->indexRange].offset);
+		auto position = [&](uint32_t index) {
+			glm::vec3 value;
+			std::memcpy(&value, vertices + (size_t)index * chunk->position.stride, sizeof(value));
+			return value;
+		};
+		for (size_t i = 0; i + 2 < chunk->indexCount; i += 3) {
+			writer.add(position(indices[i]), position(indices[i + 1]), position(indices[i + 2]), color);
+		}
+	}
+	return true;
+}
+
+//other formats are imported whole by assimp with vertices pretransformed into model space
+static bool collectAssimp(const std::string& modelPath, OctreeTriangleWriter& writer, std::string& unsupported) {
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(modelPath, aiProcess_Triangulate | aiProcess_PreTransformVertices);
+	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+		unsupported = importer.GetErrorString();
+		return false;
+	}
+	for (unsigned int m = 0; m < scene->mNumMeshes; m++) {
+		const aiMesh* mesh = scene->mMeshes[m];
+		glm::vec4 color = defaultColor;
+		aiColor4D diffuse;
+		if (aiGetMaterialColor(scene->mMaterials[mesh->mMaterialIndex], AI_MATKEY_COLOR_DIFFUSE, &diffuse) == AI_SUCCESS) {
+			color = glm::vec4(diffuse.r, diffuse.g, diffuse.b, 1.f);
+		}
+		uint32_t packed = packColor(color);
+		for (unsigned int f = 0; f < mesh->mNumFaces; f++) {
+			const aiFace& face = mesh->mFaces[f];
+			if (face.mNumIndices != 3) {
+				continue;
+			}
+			glm::vec3 corners[3];
+			for (int c = 0; c < 3; c++) {
+				const aiVector3D& vertex = mesh->mVertices[face.mIndices[c]];
+				corners[c] = glm::vec3(vertex.x, vertex.y, vertex.z);
+			}
+			writer.add(corners[0], corners[1], corners[2], packed);
+		}
+	}
+	return true;
+}
+
+//writes nodes bottom up, children before parents, root is the last one
+class OctreeFileBuilder {
+public:
+	OctreeFileBuilder(const std::string& path, uint32_t maxTriangles, OctreeBuildResult& result)
+		: path(path), maxTriangles(maxTriangles), result(result), file(path + ".tmp", std::ios::binary | std::ios::trunc) {
+		//cells fine enough that clustered surface stays around budget, surfaces cover few cells per row of grid
+		resolution = std::max(4, std::min(1024, (int)std::sqrt(maxTriangles / 8.0)));
+		//header is written again once table is known
+		OctreeFileHeader header;
+		file.write((const char*)&header, sizeof(header));
+	}
+
+	bool isOpen() const { return file.is_open(); }
+
+	//splits triangles of file until they fit budget, file is deleted once read
+	uint32_t buildNode(const std::string& trianglePath, size_t count, const glm::vec3& cellMin, float cellSize, uint32_t depth,
+		OctreeGeometry& geometry, float& error) {
+		result.depth = std::max(result.depth, depth);
+		if (count <= maxTriangles || depth >= maxOctreeDepth) {
+			buildLeaf(trianglePath, count, geometry);
+			error = 0.f;
+			result.leaves++;
+			uint32_t children[8];
+			std::fill(children, children + 8, octreeNoChild);
+			return writeNode(geometry, error, children);
+		}
+
+		float childSize = cellSize * 0.5f;
+		glm::vec3 center = cellMin + glm::vec3(childSize);
+		std::string childPaths[8];
+		size_t childCounts[8] = {};
+		{
+			std::unique_ptr<std::ofstream> childFiles[8];
+			std::ifstream input(trianglePath, std::ios::binary);
+			std::vector<OctreeTriangle> block(blockTriangles);
+			for (size_t read = 0; read < count && input; ) {
+				size_t blockCount = std::min(blockTriangles, count - read);
+				input.read((char*)block.data(), blockCount * sizeof(OctreeTriangle));
+				for (size_t i = 0; i < blockCount; i++) {
+					glm::vec3 centroid = (block[i].corners[0] + block[i].corners[1] + block[i].corners[2]) / 3.f;
+					int child = (centroid.x >= center.x ? 1 : 0) | (centroid.y >= center.y ? 2 : 0) | (centroid.z >= center.z ? 4 : 0);
+					if (!childFiles[child]) {
+						childPaths[child] = temporaryPath();
+						childFiles[child] = std::make_unique<std::ofstream>(childPaths[child], std::ios::binary | std::ios::trunc);
+					}
+					childFiles[child]->write((const char*)&block[i], sizeof(OctreeTriangle));
+					childCounts[child]++;
+				}
+				read += blockCount;
+			}
+			for (auto& childFile : childFiles) {
+				if (childFile && !childFile->good()) {
+					failed = true;
+				}
+			}
+		}
+		removeFile(trianglePath);
+
+		//children are clustered into parent one by one, so only one child geometry is kept at a time
+		OctreeClusterGrid grid(cellMin, cellSize, resolution);
+		uint32_t children[8];
+		float childError = 0.f;
+		for (int i = 0; i < 8; i++) {
+			children[i] = octreeNoChild;
+			if (childCounts[i] == 0) {
+				continue;
+			}
+			glm::vec3 childMin = cellMin + glm::vec3((i & 1) ? childSize : 0.f, (i & 2) ? childSize : 0.f, (i & 4) ? childSize : 0.f);
+			OctreeGeometry childGeometry;
+			float childNodeError = 0.f;
+			children[i] = buildNode(childPaths[i], childCounts[i], childMin, childSize, depth + 1, childGeometry, childNodeError);
+			childError = std::max(childError, childNodeError);
+			grid.add(childGeometry);
+		}
+		grid.extract(geometry);
+		int nodeResolution = resolution;
+		while (geometry.indices.size() / 3 > maxTriangles && nodeResolution > 1) {
+			nodeResolution /= 2;
+			OctreeClusterGrid coarser(cellMin, cellSize, nodeResolution);
+			coarser.add(geometry);
+			coarser.extract(geometry);
+		}
+		error = childError + cellSize / nodeResolution * std::sqrt(3.f);
+		return writeNode(geometry, error, children);
+	}
+
+	//header at start, table of nodes after their data
+	bool finish(uint32_t root, const OctreeFileHeader& source) {
+		OctreeFileHeader header = source;
+		header.nodeCount = (uint32_t)nodes.size();
+		header.root = root;
+		header.maxTriangles = maxTriangles;
+		header.tableOffset = (uint64_t)file.tellp();
+		file.write((const char*)nodes.data(), nodes.size() * sizeof(OctreeFileNode));
+		result.fileBytes = (size_t)file.tellp();
+		file.seekp(0);
+		file.write((const char*)&header, sizeof(header));
+		file.close();
+		if (failed || file.fail()) {
+			removeFile(path + ".tmp");
+			return false;
+		}
+		std::error_code error;
+		std::filesystem::rename(path + ".tmp", path, error);
+		return !error;
+	}
+
+	//removes unfinished file when collecting triangles failed
+	void abandon() {
+		file.close();
+		removeFile(path + ".tmp");
+	}
+
+	std::string temporaryPath() {
+		return path + "." + std::to_string(temporaryCount++) + ".tris";
+	}
+
+	void removeFile(const std::string& filePath) {
+		std::error_code error;
+		std::filesystem::remove(filePath, error);
+	}
+
+	bool hasFailed() const { return failed; }
+
+private:
+	//original triangles welded by position and color, normals summed from faces weighted by area
+	void buildLeaf(const std::string& trianglePath, size_t count, OctreeGeometry& geometry) {
+		std::vector<OctreeTriangle> triangles(count);
+		{
+			std::ifstream input(trianglePath, std::ios::binary);
+			input.read((char*)triangles.data(), count * sizeof(OctreeTriangle));
+			if (!input) {
+				failed = true;
+			}
+		}
+		removeFile(trianglePath);
+		std::unordered_map<OctreeVertexKey, uint32_t, OctreeVertexKeyHash> welded;
+		welded.reserve(count * 3);
+		for (const auto& triangle : triangles) {
+			uint32_t corners[3];
+			for (int c = 0; c < 3; c++) {
+				//negative zero welds with zero
+				glm::vec3 position = triangle.corners[c] + glm::vec3(0.f);
+				OctreeVertexKey key;
+				std::memcpy(key.bits, &position, sizeof(position));
+				key.bits[3] = triangle.color;
+				auto inserted = welded.emplace(key, (uint32_t)geometry.positions.size());
+				if (inserted.second) {
+					geometry.positions.push_back(position);
+					geometry.normals.push_back(glm::vec3(0.f));
+					geometry.colors.push_back(unpackColor(triangle.color));
+					geometry.weights.push_back(1.f);
+				}
+				corners[c] = inserted.first->second;
+			}
+			if (corners[0] == corners[1] || corners[1] == corners[2] || corners[0] == corners[2]) {
+				continue;
+			}
+			glm::vec3 normal = glm::cross(geometry.positions[corners[1]] - geometry.positions[corners[0]], geometry.positions[corners[2]] - geometry.positions[corners[0]]);
+			for (uint32_t corner : corners) {
+				geometry.normals[corner] += normal;
+				geometry.indices.push_back(corner);
+			}
+		}
+		for (auto& normal : geometry.normals) {
+			float length = glm::length(normal);
+			normal = length > 0.f ? normal / length : glm::vec3(0.f, 1.f, 0.f);
+		}
+	}
+
+	//node data start at next page boundary
+	uint32_t writeNode(const OctreeGeometry& geometry, float error, const uint32_t children[8]) {
+		uint64_t end = (uint64_t)file.tellp();
+		uint64_t offset = (end + octreePageSize - 1) / octreePageSize * octreePageSize;
+		std::vector<char> padding((size_t)(offset - end), 0);
+		file.write(padding.data(), padding.size());
+
+		OctreeFileNode node;
+		std::memset(&node, 0, sizeof(node));
+		node.offset = offset;
+		node.error = error;
+		node.vertexCount = (uint32_t)geometry.positions.size();
+		node.indexCount = (uint32_t)geometry.indices.size();
+		std::copy(children, children + 8, node.children);
+		std::vector<OctreeVertex> vertices(geometry.positions.size());
+		for (size_t i = 0; i < vertices.size(); i++) {
+			vertices[i] = { geometry.positions[i], geometry.normals[i], packColor(geometry.colors[i]) };
+			node.boundsMin = i == 0 ? geometry.positions[i] : glm::min(node.boundsMin, geometry.positions[i]);
+			node.boundsMax = i == 0 ? geometry.positions[i] : glm::max(node.boundsMax, geometry.positions[i]);
+		}
+		//clustered vertices lie within children, their bounds cover original triangles
+		bool first = vertices.empty();
+		for (int i = 0; i < 8; i++) {
+			if (children[i] != octreeNoChild) {
+				node.boundsMin = first ? nodes[children[i]].boundsMin : glm::min(node.boundsMin, nodes[children[i]].boundsMin);
+				node.boundsMax = first ? nodes[children[i]].boundsMax : glm::max(node.boundsMax, nodes[children[i]].boundsMax);
+				first = false;
+			}
+		}
+		file.write((const char*)vertices.data(), vertices.size() * sizeof(OctreeVertex));
+		file.write((const char*)geometry.indices.data(), geometry.indices.size() * sizeof(uint32_t));
+		if (!file) {
+			failed = true;
+		}
+		nodes.push_back(node);
+		result.nodes++;
+		return (uint32_t)nodes.size() - 1;
+	}
+
+	std::string path;
+	uint32_t maxTriangles;
+	int resolution;
+	OctreeBuildResult& result;
+	std::ofstream file;
+	std::vector<OctreeFileNode> nodes;
+	size_t temporaryCount = 0;
+	bool failed = false;
+};
+
+std::string OctreePath(const std::string& directory, const std::string& modelPath) {
+	//FNV-1a of model path, file stamp inside octree tells whether it is still valid
+	uint64_t hash = 14695981039346656037ull;
+	for (unsigned char c : modelPath) {
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+	std::ostringstream name;
+	name << directory << '/' << std::hex << std::setw(16) << std::setfill('0') << hash << ".octree";
+	return name.str();
+}
+
+bool ReadOctreeHeader(const std::string& octreePath, const std::string& modelPath, OctreeFileHeader& header) {
+	uint64_t size;
+	int64_t modified;
+	if (!sourceStamp(modelPath, size, modified)) {
+		return false;
+	}
+	std::ifstream file(octreePath, std::ios::binary);
+	if (!file.read((char*)&header, sizeof(header))) {
+		return false;
+	}
+	return header.magic == octreeMagic && header.version == octreeVersion && header.pageSize == octreePageSize
+		&& header.sourceSize == size && header.sourceTime == modified && header.nodeCount > 0 && header.root < header.nodeCount;
+}
+
+bool HasOctree(const std::string& directory, const std::string& modelPath) {
+	OctreeFileHeader header;
+	return ReadOctreeHeader(OctreePath(directory, modelPath), modelPath, header);
+}
+
+OctreeBuildResult BuildOctree(const std::string& modelPath, const std::string& directory, uint32_t maxTriangles) {
+	auto startTime = std::chrono::steady_clock::now();
+	OctreeBuildResult result;
+	OctreeFileHeader header;
+	if (!sourceStamp(modelPath, header.sourceSize, header.sourceTime)) {
+		result.error = "model file not found";
+		return result;
+	}
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	std::string path = OctreePath(directory, modelPath);
+	OctreeFileBuilder builder(path, std::max<uint32_t>(maxTriangles, 64), result);
+	std::string trianglePath = builder.temporaryPath();
+	OctreeTriangleWriter writer(trianglePath);
+	if (!builder.isOpen() || !writer.isOpen()) {
+		result.error = "cannot write to " + directory;
+		return result;
+	}
+	//ascii scans and unusual ply layouts go to assimp like on load
+	std::string unsupported;
+	bool collected = IsScanPath(modelPath) && collectScan(modelPath, writer, unsupported);
+	if (!collected) {
+		collected = collectAssimp(modelPath, writer, unsupported);
+	}
+	if (!writer.close() || !collected || writer.count == 0) {
+		builder.removeFile(trianglePath);
+		builder.abandon();
+		result.error = collected ? (writer.count == 0 ? "model has no triangles" : "cannot write temporary file") : unsupported;
+		return result;
+	}
+	result.sourceTriangles = writer.count;
+
+	//octree cells are cubes around model bounds
+	glm::vec3 extent = writer.boundsMax - writer.boundsMin;
+	float cellSize = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f)) * 1.001f;
+	header.boundsMin = writer.boundsMin;
+	header.boundsMax = writer.boundsMax;
+	OctreeGeometry rootGeometry;
+	float rootError = 0.f;
+	uint32_t root = builder.buildNode(trianglePath, writer.count, writer.boundsMin, cellSize, 0, rootGeometry, rootError);
+	if (!builder.finish(root, header)) {
+		result.error = "cannot write " + path;
+		return result;
+	}
+	result.valid = true;
+	result.totalMs = millisecondsSince(startTime);
+	std::cout << "Built octree of " << modelPath << ": " << result.sourceTriangles << " triangles in " << result.nodes << " nodes (" << result.leaves
+		<< " leaves, depth " << result.depth << "), " << result.fileBytes / 1024 << " KB, " << result.totalMs << " ms" << std::endl;
+	return result;
+}
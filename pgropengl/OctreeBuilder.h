@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//octree file: header, data of every node starting at page boundary, node table at end
+//node data are vertices (OctreeVertex) followed by 32 bit indices, read by one aligned read and uploaded as they are
+static const uint32_t octreeMagic = 0x4545524F; //"OREE"
+static const uint32_t octreeVersion = 1;
+static const uint32_t octreePageSize = 64 * 1024;
+static const uint32_t octreeNoChild = 0xFFFFFFFFu;
+
+struct OctreeVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    //rgba8
+    uint32_t color;
+};
+
+struct OctreeFileHeader {
+    uint32_t magic = octreeMagic;
+    uint32_t version = octreeVersion;
+    uint32_t pageSize = octreePageSize;
+    uint32_t nodeCount = 0;
+    uint32_t root = 0;
+    //node budget the file was built with
+    uint32_t maxTriangles = 0;
+    //size and modification time of model file, stale octree is not used
+    uint64_t sourceSize = 0;
+    int64_t sourceTime = 0;
+    uint64_t tableOffset = 0;
+    glm::vec3 boundsMin = glm::vec3(0.f);
+    glm::vec3 boundsMax = glm::vec3(0.f);
+};
+
+struct OctreeFileNode {
+    //first byte of node data, multiple of page size
+    uint64_t offset;
+    //bounds of all geometry below node, it can reach out of its octree cell
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    //largest distance of simplified surface from original, 0 for leaves holding original triangles
+    float error;
+    uint32_t children[8];
+    uint32_t vertexCount;
+    uint32_t indexCount;
+
+    size_t dataBytes() const { return vertexCount * sizeof(OctreeVertex) + (size_t)indexCount * sizeof(uint32_t); }
+    //pages read for node
+    size_t pagedBytes() const { return (dataBytes() + octreePageSize - 1) / octreePageSize * octreePageSize; }
+};
+
+struct OctreeBuildResult {
+    bool valid = false;
+    std::string error;
+    size_t sourceTriangles = 0;
+    size_t nodes = 0;
+    size_t leaves = 0;
+    uint32_t depth = 0;
+    size_t fileBytes = 0;
+    double totalMs = 0.0;
+};
+
+//path of octree file of model inside directory, named by hash of model path like proxies
+std::string OctreePath(const std::string& directory, const std::string& modelPath);
+//reads header of octree file, false when it is missing, damaged or was built from other version of model file
+bool ReadOctreeHeader(const std::string& octreePath, const std::string& modelPath, OctreeFileHeader& header);
+//true when octree of model exists and was built from its current file
+bool HasOctree(const std::string& directory, const std::string& modelPath);
+
+//offline conversion of model to octree file, nodes hold at most maxTriangles triangles
+//triangles are read once into temporary file (binary ply and stl chunk by chunk through ScanStream, others by assimp),
+//node files are split by triangle centroids into eight children on disk until they fit budget, so memory holds one leaf
+//and clustered geometry of nodes on path to it instead of whole model
+//leaves keep original triangles welded by position, inner nodes are vertex clustered from their children on grid fitting the budget,
+//their error is cell diagonal plus largest error of children, can run on any thread
+OctreeBuildResult BuildOctree(const std::string& modelPath, const std::string& directory, uint32_t maxTriangles = 65536);
@@ -0,0 +1,300 @@
+#include "OctreeRenderer.h"
+#include "Frustum.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+//geometry of octree is untextured, colors come from vertices
+static MeshSourceAttribute octreeAttribute(size_t offset, GLint size, GLenum type, GLboolean normalized) {
+	MeshSourceAttribute attribute;
+	attribute.range = 0;
+	attribute.offset = offset;
+	attribute.stride = sizeof(OctreeVertex);
+	attribute.size = size;
+	attribute.type = type;
+	attribute.normalized = normalized;
+	return attribute;
+}
+
+	std::unique_ptr<OctreeRenderer> OctreeRenderer::open(const std::string& directory, const std::string& modelPath, GLDeletionQueue& deletionQueue) {
+		std::string path = OctreePath(directory, modelPath);
+		OctreeFileHeader header;
+		if (!ReadOctreeHeader(path, modelPath, header)) {
+			return nullptr;
+		}
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		uint64_t fileSize = (uint64_t)file.tellg();
+		//damaged header must not size table beyond file
+		if (header.tableOffset > fileSize || (uint64_t)header.nodeCount * sizeof(OctreeFileNode) > fileSize - header.tableOffset) {
+			std::cout << "Corrupted octree: " << path << std::endl;
+			return nullptr;
+		}
+		std::vector<OctreeFileNode> table(header.nodeCount);
+		file.seekg(header.tableOffset);
+		file.read((char*)table.data(), table.size() * sizeof(OctreeFileNode));
+		if (!file) {
+			std::cout << "Corrupted octree: " << path << std::endl;
+			return nullptr;
+		}
+		std::unique_ptr<OctreeRenderer> renderer(new OctreeRenderer(deletionQueue));
+		renderer->path = path;
+		renderer->root = header.root;
+		renderer->boundsMin = header.boundsMin;
+		renderer->boundsMax = header.boundsMax;
+		renderer->nodes.resize(table.size());
+		for (size_t i = 0; i < table.size(); i++) {
+			const OctreeFileNode& node = table[i];
+			bool valid = node.offset % octreePageSize == 0 && node.offset + node.dataBytes() <= header.tableOffset;
+			for (uint32_t child : node.children) {
+				//children are written before parents
+				valid = valid && (child == octreeNoChild || child < i);
+			}
+			if (!valid) {
+				std::cout << "Corrupted octree: " << path << std::endl;
+				return nullptr;
+			}
+			renderer->nodes[i].file = node;
+		}
+		renderer->loader = std::thread(&OctreeRenderer::load, renderer.get());
+		return renderer;
+	}
+
+	OctreeRenderer::~OctreeRenderer() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		changed.notify_all();
+		if (loader.joinable()) {
+			loader.join();
+		}
+		GLObjectList objects;
+		for (auto& node : nodes) {
+			if (node.mesh) {
+				node.mesh->releaseGLObjects(objects);
+			}
+		}
+		deletionQueue.enqueue(std::move(objects));
+	}
+
+	void OctreeRenderer::update(const Camera& camera, const glm::mat4& modelMatrix, const glm::mat4& projectionMatrix, int viewportHeight) {
+		uploadLoadedNodes();
+
+		frame++;
+		cullMatrix = projectionMatrix * camera.getViewMatrix() * modelMatrix;
+		cameraPosition = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(camera.getCameraPosition(), 1.f));
+		//perspective projection divides by depth, orthographic keeps size at any distance
+		perspective = projectionMatrix[2][3] != 0.f;
+		pixelScale = projectionMatrix[1][1] * viewportHeight * 0.5f;
+		modelScale = glm::length(glm::vec3(modelMatrix[0]));
+		drawn.clear();
+		wanted.clear();
+		selectNode(root);
+		requestNodes();
+	}
+
+	void OctreeRenderer::submit(RenderQueue& queue, const glm::mat4& modelViewMatrix) {
+		for (uint32_t index : drawn) {
+			if (nodes[index].mesh) {
+				queue.add(*nodes[index].mesh, modelViewMatrix);
+			}
+		}
+	}
+
+	OctreeRenderer::Stats OctreeRenderer::getStats() const {
+		Stats stats;
+		stats.nodes = nodes.size();
+		stats.residentNodes = residentNodes;
+		stats.drawnNodes = drawn.size();
+		stats.loadingNodes = loadingNodes;
+		stats.bytesInFlight = bytesInFlight;
+		stats.residentBytes = residentBytes;
+		stats.budgetBytes = budgetBytes;
+		stats.loads = loads;
+		stats.evictions = evictions;
+		return stats;
+	}
+
+	void OctreeRenderer::selectNode(uint32_t index) {
+		Node& node = nodes[index];
+		node.lastUsed = frame;
+		float error = screenError(node);
+		if (node.state != NodeState::Resident) {
+			wanted.push_back({ error, index });
+			return;
+		}
+		bool refine = error > pixelError;
+		bool leaf = true;
+		bool childrenResident = true;
+		for (uint32_t child : node.file.children) {
+			if (child == octreeNoChild) {
+				continue;
+			}
+			leaf = false;
+			Node& childNode = nodes[child];
+			//children outside view are not needed to cover it
+			if (refine && isVisible(childNode) && childNode.state != NodeState::Resident) {
+				childNode.lastUsed = frame;
+				wanted.push_back({ screenError(childNode), child });
+				childrenResident = false;
+			}
+		}
+		if (!refine || leaf || !childrenResident) {
+			drawn.push_back(index);
+			return;
+		}
+		for (uint32_t child : node.file.children) {
+			if (child != octreeNoChild && isVisible(nodes[child])) {
+				selectNode(child);
+			}
+		}
+	}
+
+	bool OctreeRenderer::isVisible(const Node& node) const {
+		glm::vec3 center = (node.file.boundsMin + node.file.boundsMax) * 0.5f;
+		float radius = glm::length(node.file.boundsMax - node.file.boundsMin) * 0.5f;
+		//planes of model space frustum are normalized in model units
+		return Frustum(cullMatrix).intersectsSphere(center, radius);
+	}
+
+	float OctreeRenderer::screenError(const Node& node) const {
+		if (!perspective) {
+			return node.file.error * modelScale * pixelScale;
+		}
+		glm::vec3 nearest = glm::clamp(cameraPosition, node.file.boundsMin, node.file.boundsMax);
+		float distance = glm::length(nearest - cameraPosition);
+		//error and distance are both in model units, their ratio does not depend on model matrix scale
+		return distance > 0.f ? node.file.error * pixelScale / distance : std::numeric_limits<float>::infinity();
+	}
+
+	void OctreeRenderer::uploadLoadedNodes() {
+		std::deque<std::pair<uint32_t, std::shared_ptr<std::vector<unsigned char>>>> finished;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			finished.swap(loaded);
+		}
+		for (auto& result : finished) {
+			Node& node = nodes[result.first];
+			const OctreeFileNode& file = node.file;
+			loadingNodes--;
+			bytesInFlight -= file.dataBytes();
+			node.state = NodeState::Resident;
+			residentNodes++;
+			if (!result.second) {
+				//unreadable node is kept as empty one, so it is not requested again every frame
+				std::cout << "Failed to read octree node " << result.first << " of " << path << std::endl;
+				continue;
+			}
+			if (file.indexCount == 0) {
+				continue;
+			}
+			size_t vertexBytes = file.vertexCount * sizeof(OctreeVertex);
+			auto source = std::make_shared<MeshSource>();
+			source->data = result.second->data();
+			source->owner = std::move(result.second);
+			source->ranges = { { 0, vertexBytes }, { vertexBytes, file.indexCount * sizeof(uint32_t) } };
+			source->position = octreeAttribute(offsetof(OctreeVertex, position), 3, GL_FLOAT, GL_FALSE);
+			source->normal = octreeAttribute(offsetof(OctreeVertex, normal), 3, GL_FLOAT, GL_FALSE);
+			source->colors = octreeAttribute(offsetof(OctreeVertex, color), 4, GL_UNSIGNED_BYTE, GL_TRUE);
+			source->indexRange = 1;
+			source->indexType = GL_UNSIGNED_INT;
+			source->indexCount = file.indexCount;
+			source->vertexCount = file.vertexCount;
+			source->boundsMin = file.boundsMin;
+			source->boundsMax = file.boundsMax;
+			node.mesh = std::make_unique<Mesh>(std::move(source), Texture(), false, false);
+			node.mesh->upload();
+			residentBytes += file.dataBytes();
+			loads++;
+		}
+	}
+
+	void OctreeRenderer::requestNodes() {
+		//nodes covering most pixels of error first, coarse nodes come before their children this way
+		std::sort(wanted.begin(), wanted.end(), [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) { return a.first > b.first; });
+		GLObjectList objects;
+		size_t requested = 0;
+		for (const auto& entry : wanted) {
+			Node& node = nodes[entry.second];
+			if (node.state != NodeState::Unloaded) {
+				continue;
+			}
+			if (loadingNodes >= maxLoadingNodes) {
+				break;
+			}
+			size_t bytes = node.file.dataBytes();
+			bool fits = true;
+			while (residentBytes + bytesInFlight + bytes > budgetBytes) {
+				if (!evictNode(objects)) {
+					fits = false;
+					break;
+				}
+			}
+			//root is always loaded, without it nothing could be drawn
+			if (!fits && entry.second != root) {
+				break;
+			}
+			node.state = NodeState::Loading;
+			loadingNodes++;
+			bytesInFlight += bytes;
+			std::lock_guard<std::mutex> lock(mutex);
+			requests.push_back(entry.second);
+			requested++;
+		}
+		if (!objects.buffers.empty()) {
+			deletionQueue.enqueue(std::move(objects));
+		}
+		if (requested > 0) {
+			changed.notify_all();
+		}
+	}
+
+	bool OctreeRenderer::evictNode(GLObjectList& objects) {
+		Node* oldest = nullptr;
+		for (uint32_t i = 0; i < nodes.size(); i++) {
+			Node& node = nodes[i];
+			if (node.state == NodeState::Resident && node.lastUsed < frame && i != root && (!oldest || node.lastUsed < oldest->lastUsed)) {
+				oldest = &node;
+			}
+		}
+		if (!oldest) {
+			return false;
+		}
+		if (oldest->mesh) {
+			oldest->mesh->releaseGLObjects(objects);
+			oldest->mesh.reset();
+			residentBytes -= oldest->file.dataBytes();
+		}
+		oldest->state = NodeState::Unloaded;
+		residentNodes--;
+		evictions++;
+		return true;
+	}
+
+	void OctreeRenderer::load() {
+		std::ifstream file(path, std::ios::binary);
+		while (true) {
+			uint32_t index;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [this]() { return stopping || !requests.empty(); });
+				if (stopping) {
+					return;
+				}
+				index = requests.front();
+				requests.pop_front();
+			}
+			//file part of node never changes after open, it is read without lock
+			const OctreeFileNode& node = nodes[index].file;
+			auto data = std::make_shared<std::vector<unsigned char>>(node.dataBytes());
+			file.clear();
+			file.seekg(node.offset);
+			//node starts at page boundary, its data are read by one read
+			if (!file.read((char*)data->data(), data->size())) {
+				data.reset();
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			loaded.push_back({ index, std::move(data) });
+		}
+	}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Camera.h"
+#include "GLDeletionQueue.h"
+#include "OctreeBuilder.h"
+#include "RenderQueue.h"
+#include "mesh.h"
+
+//draws model from octree file without loading all of it, only nodes fine enough for current view are read and kept on GPU
+//node is refined into its children once its error projected to screen exceeds pixel error and all visible children are resident,
+//until then node itself stays drawn, so view never has holes while loading
+//missing nodes are read by loader thread in order of their screen error, few at a time, least recently used ones are evicted
+//when resident and requested data would exceed budget, has to be used on thread owning GL context
+class OctreeRenderer {
+public:
+    //bounds of whole model, model matrix is computed from them like from bounds of model
+    glm::vec3 boundsMin = glm::vec3(0.f);
+    glm::vec3 boundsMax = glm::vec3(0.f);
+
+    struct Stats {
+        size_t nodes = 0;
+        size_t residentNodes = 0;
+        size_t drawnNodes = 0;
+        size_t loadingNodes = 0;
+        //node data requested from file and not on GPU yet, counted into budget
+        size_t bytesInFlight = 0;
+        size_t residentBytes = 0;
+        size_t budgetBytes = 0;
+        uint64_t loads = 0;
+        uint64_t evictions = 0;
+    };
+
+    //opens octree of model built by BuildOctree, nullptr when there is none or it is stale, nothing is loaded until first update
+    static std::unique_ptr<OctreeRenderer> open(const std::string& directory, const std::string& modelPath, GLDeletionQueue& deletionQueue);
+    //stops loader thread, GL objects of resident nodes go to deletion queue
+    ~OctreeRenderer();
+
+    OctreeRenderer(const OctreeRenderer&) = delete;
+    OctreeRenderer& operator=(const OctreeRenderer&) = delete;
+
+    //uploads nodes read since last frame, selects nodes for view of camera and requests missing ones
+    //projection decides whether error shrinks with distance, viewport height converts it to pixels
+    void update(const Camera& camera, const glm::mat4& modelMatrix, const glm::mat4& projectionMatrix, int viewportHeight);
+    //adds selected resident nodes to render queue
+    void submit(RenderQueue& queue, const glm::mat4& modelViewMatrix);
+
+    void setBudget(size_t bytes) { budgetBytes = bytes; }
+    void setPixelError(float pixels) { pixelError = pixels; }
+    //true while some node is being read, frames have to continue to show it
+    bool isLoading() const { return loadingNodes > 0; }
+    Stats getStats() const;
+
+private:
+    enum class NodeState {
+        Unloaded,
+        Loading,
+        Resident
+    };
+
+    struct Node {
+        OctreeFileNode file;
+        NodeState state = NodeState::Unloaded;
+        //nullptr for resident node without triangles
+        std::unique_ptr<Mesh> mesh;
+        //frame node was last visible, evicted nodes are the ones not seen longest
+        uint64_t lastUsed = 0;
+    };
+
+    OctreeRenderer(GLDeletionQueue& deletionQueue) : deletionQueue(deletionQueue) {}
+
+    void selectNode(uint32_t index);
+    bool isVisible(const Node& node) const;
+    //projected error of node in pixels, infinite when camera is inside its bounds
+    float screenError(const Node& node) const;
+    void uploadLoadedNodes();
+    void requestNodes();
+    //evicts least recently used node not used in this frame, false when there is none
+    bool evictNode(GLObjectList& objects);
+    void load();
+
+    std::string path;
+    GLDeletionQueue& deletionQueue;
+    std::vector<Node> nodes;
+    uint32_t root = 0;
+    size_t budgetBytes = (size_t)256 << 20;
+    float pixelError = 2.f;
+    //at most this many nodes are read at once, so nodes wanted by later frames are not queued behind stale ones
+    size_t maxLoadingNodes = 4;
+
+    //view of current update, in model space
+    glm::mat4 cullMatrix = glm::mat4(1.f);
+    glm::vec3 cameraPosition = glm::vec3(0.f);
+    bool perspective = true;
+    float pixelScale = 1.f;
+    float modelScale = 1.f;
+    uint64_t frame = 0;
+    std::vector<uint32_t> drawn;
+    //nodes missing for current view with their screen error
+    std::vector<std::pair<float, uint32_t>> wanted;
+
+    size_t residentNodes = 0;
+    size_t residentBytes = 0;
+    size_t loadingNodes = 0;
+    size_t bytesInFlight = 0;
+    uint64_t loads = 0;
+    uint64_t evictions = 0;
+
+    //loader thread reads node data, main thread creates meshes from them
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<uint32_t> requests;
+    std::deque<std::pair<uint32_t, std::shared_ptr<std::vector<unsigned char>>>> loaded;
+    bool stopping = false;
+    std::thread loader;
+};
@@ -0,0 +1,169 @@
+#include "RenderQueue.h"
+#include <SDL.h>
+#include <algorithm>
+#include <cmath>
+
+//key layout from most significant bit
+//opaque:      pass(1) | program(7) | texture(16) | vertex array(16) | depth(24)
+//transparent: pass(1) | inverted depth(24) | program(7) | texture(16) | vertex array(16)
+static const int depthBits = 24;
+static const uint64_t depthMask = (1ull << depthBits) - 1;
+static const uint64_t objectMask = 0xFFFF;
+static const uint64_t programMask = 0x7F;
+static const uint64_t transparentPass = 1ull << 63;
+
+	RenderQueue::RenderQueue(float farPlane) : farPlane(farPlane) {
+	}
+
+	void RenderQueue::clear() {
+		items.clear();
+		culledCount = 0;
+	}
+
+	void RenderQueue::setCullMatrices(const std::vector<glm::mat4>& modelViewProjections) {
+		cullFrustums.assign(modelViewProjections.begin(), modelViewProjections.end());
+	}
+
+	void RenderQueue::add(Mesh& mesh, const glm::mat4& modelViewMatrix, const glm::mat4* nodeTransform) {
+		if (!isVisible(mesh, nodeTransform)) {
+			culledCount++;
+			return;
+		}
+		//camera looks down negative z
+		float depth = -(modelViewMatrix * glm::vec4(meshCenter(mesh, nodeTransform), 1.f)).z;
+		items.push_back({ &mesh, makeKey(mesh, mesh.shaderFeatures, depth), mesh.shaderFeatures, 1, 0, nodeTransform, 0 });
+	}
+
+	void RenderQueue::addInstanced(Mesh& mesh, const glm::mat4& modelViewMatrix, uint32_t instanceCount, uint32_t baseInstance, const glm::mat4* nodeTransform, GLuint instanceBuffer) {
+		float depth = -(modelViewMatrix * glm::vec4(meshCenter(mesh, nodeTransform), 1.f)).z;
+		int features = mesh.shaderFeatures | ShaderInstanced;
+		items.push_back({ &mesh, makeKey(mesh, features, depth), features, instanceCount, baseInstance, nodeTransform, instanceBuffer });
+	}
+
+	void RenderQueue::sort() {
+		Uint64 start = SDL_GetPerformanceCounter();
+		orderReused = false;
+		//same number of draws means previous order is still a permutation of items, camera and scene usually change little
+		if (order.size() == items.size()) {
+			orderReused = true;
+			for (size_t i = 1; i < order.size() && orderReused; i++) {
+				orderReused = items[order[i - 1]].key <= items[order[i]].key;
+			}
+		}
+		if (!orderReused) {
+			radixSort();
+		}
+		sortMicroseconds = (SDL_GetPerformanceCounter() - start) * 1000000.0 / SDL_GetPerformanceFrequency();
+	}
+
+	void RenderQueue::executeDepthPrepass(GLStateCache& state, ShaderPermutations& shaders) {
+		//passes drawn between queues (gui, thumbnails, fullscreen passes) may leave other constant attributes
+		state.forgetVertexAttribs();
+		state.colorMask(false);
+		state.setEnabled(GL_DEPTH_TEST, true);
+		state.depthFunc(GL_LEQUAL);
+		state.depthMask(true);
+		//opaque items come first in order
+		for (uint32_t index : order) {
+			const Item& item = items[index];
+			if (item.key & transparentPass) {
+				break;
+			}
+			state.useProgram(shaders.getProgram(ShaderDepthOnly | (item.features & ShaderInstanced)));
+			if (item.instanceBuffer != 0) {
+				state.bindStorageBuffer(InstanceBufferBinding, item.instanceBuffer);
+			}
+			item.mesh->DrawDepth(state, item.instanceCount, item.baseInstance, item.nodeTransform ? *item.nodeTransform : glm::mat4(1.f));
+		}
+		state.colorMask(true);
+	}
+
+	void RenderQueue::execute(GLStateCache& state, ShaderPermutations& shaders, bool afterDepthPrepass, int viewCount) {
+		int viewFeatures = viewCount > 1 ? ShaderMultiView : 0;
+		state.forgetVertexAttribs();
+		state.colorMask(true);
+		state.setEnabled(GL_BLEND, true);
+		state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		state.setEnabled(GL_DEPTH_TEST, true);
+		//depth is complete already, so every hidden fragment is rejected before shading
+		state.depthFunc(afterDepthPrepass ? GL_EQUAL : GL_LEQUAL);
+		state.depthMask(!afterDepthPrepass);
+		for (uint32_t index : order) {
+			const Item& item = items[index];
+			if (item.key & transparentPass) {
+				//transparent meshes are tested against depth but do not hide each other
+				state.depthFunc(GL_LEQUAL);
+				state.depthMask(false);
+			}
+			state.useProgram(shaders.getProgram(item.features | viewFeatures));
+			if (item.instanceBuffer != 0) {
+				state.bindStorageBuffer(InstanceBufferBinding, item.instanceBuffer);
+			}
+			item.mesh->Draw(state, item.instanceCount * viewCount, item.baseInstance, item.nodeTransform ? *item.nodeTransform : glm::mat4(1.f));
+		}
+		state.depthMask(true);
+	}
+
+	uint64_t RenderQueue::makeKey(const Mesh& mesh, int features, float depth) const {
+		uint64_t quantizedDepth = (uint64_t)(std::min(std::max(depth / farPlane, 0.f), 1.f) * depthMask);
+		uint64_t program = (uint64_t)features & programMask;
+		uint64_t texture = (mesh.hasTexture ? mesh.texture.id : 0) & objectMask;
+		uint64_t vertexArray = mesh.VAO & objectMask;
+		if (mesh.isTransparent) {
+			return transparentPass | (depthMask - quantizedDepth) << 39 | program << 32 | texture << 16 | vertexArray;
+		}
+		return program << 56 | texture << 40 | vertexArray << 24 | quantizedDepth;
+	}
+
+	bool RenderQueue::isVisible(const Mesh& mesh, const glm::mat4* nodeTransform) const {
+		if (cullFrustums.empty()) {
+			return true;
+		}
+		glm::vec3 center = meshCenter(mesh, nodeTransform);
+		float radius = mesh.radius;
+		if (nodeTransform) {
+			//largest axis scale keeps sphere conservative under non-uniform scaling
+			radius *= std::sqrt(std::max(glm::dot((*nodeTransform)[0], (*nodeTransform)[0]), std::max(glm::dot((*nodeTransform)[1], (*nodeTransform)[1]), glm::dot((*nodeTransform)[2], (*nodeTransform)[2]))));
+		}
+		//visible in any frustum
+		for (const Frustum& frustum : cullFrustums) {
+			if (frustum.intersectsSphere(center, radius)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	glm::vec3 RenderQueue::meshCenter(const Mesh& mesh, const glm::mat4* nodeTransform) {
+		return nodeTransform ? glm::vec3(*nodeTransform * glm::vec4(mesh.center, 1.f)) : mesh.center;
+	}
+
+	void RenderQueue::radixSort() {
+		size_t count = items.size();
+		order.resize(count);
+		sortBuffer.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			order[i] = (uint32_t)i;
+		}
+		//least significant digit first, 8 bits per pass, stable so earlier passes are kept
+		for (int shift = 0; shift < 64; shift += 8) {
+			size_t histogram[256] = {};
+			for (const auto& item : items) {
+				histogram[(item.key >> shift) & 0xFF]++;
+			}
+			//digit shared by all keys does not change order
+			if (histogram[(items.empty() ? 0 : items[0].key >> shift) & 0xFF] == count) {
+				continue;
+			}
+			size_t offset = 0;
+			for (size_t& bucket : histogram) {
+				size_t bucketCount = bucket;
+				bucket = offset;
+				offset += bucketCount;
+			}
+			for (uint32_t index : order) {
+				sortBuffer[histogram[(items[index].key >> shift) & 0xFF]++] = index;
+			}
+			order.swap(sortBuffer);
+		}
+	}
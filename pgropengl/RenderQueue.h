@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "mesh.h"
+#include "GLStateCache.h"
+#include "ShaderPermutations.h"
+#include "Frustum.h"
+
+//collects draws of a frame, orders them by packed 64-bit keys and submits them through state cache
+//opaque draws are grouped by program, texture and vertex array and then sorted front to back,
+//transparent draws are sorted back to front first so blending stays correct
+class RenderQueue {
+public:
+    //depth beyond far plane is clamped when quantized into key
+    RenderQueue(float farPlane = 100.f);
+
+    void clear();
+    //meshes outside frustums of all given model view projection matrices are not queued, so every view shares one culling
+    //set before meshes are added, empty list disables culling
+    void setCullMatrices(const std::vector<glm::mat4>& modelViewProjections);
+    //mesh is positioned by model view matrix, its view space depth decides order within its group
+    //node transform of preserved scene hierarchy is applied before model matrix, it has to stay alive until execution
+    void add(Mesh& mesh, const glm::mat4& modelViewMatrix, const glm::mat4* nodeTransform = nullptr);
+    //one draw of instanceCount instances starting at baseInstance of instance buffer, caller culls instances itself
+    void addInstanced(Mesh& mesh, const glm::mat4& modelViewMatrix, uint32_t instanceCount, uint32_t baseInstance, const glm::mat4* nodeTransform, GLuint instanceBuffer);
+    //radix sorts keys, order of previous frame is reused when it is still sorted
+    void sort();
+    //fills depth buffer with opaque meshes only, color writes are off
+    void executeDepthPrepass(GLStateCache& state, ShaderPermutations& shaders);
+    //draws in sorted order, frame uniforms have to be set already
+    //after depth pre-pass opaque meshes are shaded only where their depth equals stored one
+    //more views are rendered by instanced draws of multi view programs into viewports of their index
+    void execute(GLStateCache& state, ShaderPermutations& shaders, bool afterDepthPrepass = false, int viewCount = 1);
+
+    size_t getItemCount() const { return items.size(); }
+    size_t getCulledCount() const { return culledCount; }
+    bool wasOrderReused() const { return orderReused; }
+    double getSortMicroseconds() const { return sortMicroseconds; }
+
+private:
+    struct Item {
+        Mesh* mesh;
+        uint64_t key;
+        int features;
+        uint32_t instanceCount;
+        uint32_t baseInstance;
+        //nullptr for identity
+        const glm::mat4* nodeTransform;
+        GLuint instanceBuffer;
+    };
+
+    uint64_t makeKey(const Mesh& mesh, int features, float depth) const;
+    bool isVisible(const Mesh& mesh, const glm::mat4* nodeTransform) const;
+    static glm::vec3 meshCenter(const Mesh& mesh, const glm::mat4* nodeTransform);
+    void radixSort();
+
+    float farPlane;
+    std::vector<Item> items;
+    //in model space
+    std::vector<Frustum> cullFrustums;
+    size_t culledCount = 0;
+    //indices into items in draw order, kept from previous frame
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> sortBuffer;
+    bool orderReused = false;
+    double sortMicroseconds = 0.0;
+};
@@ -0,0 +1,711 @@
+#include "ScanLoader.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+
+//binary stl: 80 byte header, triangle count, then 50 bytes per triangle (normal, three corners, attribute)
+static const size_t stlHeaderBytes = 84;
+static const size_t stlTriangleBytes = 50;
+//assimp default for stl and ply files without material
+static const glm::vec4 scanColor = glm::vec4(0.6f, 0.6f, 0.6f, 1.f);
+
+enum class PlyType {
+	Int8,
+	UInt8,
+	Int16,
+	UInt16,
+	Int32,
+	UInt32,
+	Float32,
+	Float64
+};
+
+struct PlyProperty {
+	std::string name;
+	PlyType type = PlyType::Float32;
+	bool list = false;
+	//type of element count before list values
+	PlyType countType = PlyType::UInt8;
+};
+
+struct PlyElement {
+	std::string name;
+	size_t count = 0;
+	std::vector<PlyProperty> properties;
+};
+
+struct ScanLayout {
+	bool ply = false;
+	bool bigEndian = false;
+	//triangle records of stl or face records of ply, face records of ply differ in size
+	size_t facesBegin = 0;
+	size_t facesEnd = 0;
+	size_t faceCount = 0;
+	//ply vertex records have fixed size, positions and normals are read from them by offset
+	size_t verticesBegin = 0;
+	size_t vertexCount = 0;
+	size_t vertexStride = 0;
+	PlyType positionType = PlyType::Float32;
+	size_t positionOffsets[3] = {};
+	bool hasNormals = false;
+	PlyType normalType = PlyType::Float32;
+	size_t normalOffsets[3] = {};
+	//every property of face record has to be stepped over, only index list is used
+	std::vector<PlyProperty> faceProperties;
+	size_t indexProperty = 0;
+};
+
+//welding key of stl corner, bits of its coordinates
+struct ScanPosition {
+	uint32_t bits[3];
+
+	bool operator==(const ScanPosition& other) const {
+		return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+	}
+};
+
+struct ScanPositionHash {
+	size_t operator()(const ScanPosition& position) const {
+		uint64_t hash = (uint64_t)position.bits[0] * 0x9E3779B97F4A7C15ull;
+		hash ^= ((uint64_t)position.bits[1] + 0x632BE59BD9B4E019ull) * 0xBF58476D1CE4E5B9ull;
+		hash ^= ((uint64_t)position.bits[2] + 0x8CB92BA72F3D8DD7ull) * 0x94D049BB133111EBull;
+		return (size_t)(hash ^ (hash >> 31));
+	}
+};
+
+//vertices and indices of one chunk, packed into single buffer once complete
+struct ScanChunkBuilder {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<uint32_t> indices;
+	size_t droppedTriangles = 0;
+	//normals of file are kept, otherwise they are summed from face normals weighted by area
+	bool accumulateNormals = true;
+
+	void addTriangle(uint32_t a, uint32_t b, uint32_t c) {
+		if (a == b || b == c || a == c) {
+			droppedTriangles++;
+			return;
+		}
+		indices.push_back(a);
+		indices.push_back(b);
+		indices.push_back(c);
+		if (accumulateNormals) {
+			glm::vec3 normal = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+			normals[a] += normal;
+			normals[b] += normal;
+			normals[c] += normal;
+		}
+	}
+};
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool hasExtension(const std::string& path, const char* extension) {
+	size_t length = std::strlen(extension);
+	if (path.size() < length) {
+		return false;
+	}
+	for (size_t i = 0; i < length; i++) {
+		if (std::tolower((unsigned char)path[path.size() - length + i]) != extension[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool parsePlyType(const std::string& name, PlyType& type) {
+	static const std::pair<const char*, PlyType> names[] = {
+		{ "char", PlyType::Int8 }, { "int8", PlyType::Int8 }, { "uchar", PlyType::UInt8 }, { "uint8", PlyType::UInt8 },
+		{ "short", PlyType::Int16 }, { "int16", PlyType::Int16 }, { "ushort", PlyType::UInt16 }, { "uint16", PlyType::UInt16 },
+		{ "int", PlyType::Int32 }, { "int32", PlyType::Int32 }, { "uint", PlyType::UInt32 }, { "uint32", PlyType::UInt32 },
+		{ "float", PlyType::Float32 }, { "float32", PlyType::Float32 }, { "double", PlyType::Float64 }, { "float64", PlyType::Float64 }
+	};
+	for (const auto& entry : names) {
+		if (name == entry.first) {
+			type = entry.second;
+			return true;
+		}
+	}
+	return false;
+}
+
+static size_t plyTypeSize(PlyType type) {
+	switch (type) {
+	case PlyType::Int8:
+	case PlyType::UInt8:
+		return 1;
+	case PlyType::Int16:
+	case PlyType::UInt16:
+		return 2;
+	case PlyType::Int32:
+	case PlyType::UInt32:
+	case PlyType::Float32:
+		return 4;
+	default:
+		return 8;
+	}
+}
+
+//value of given size in file byte order
+template<typename T>
+static T loadValue(const unsigned char* p, bool swap) {
+	T value;
+	if (swap) {
+		unsigned char bytes[sizeof(T)];
+		for (size_t i = 0; i < sizeof(T); i++) {
+			bytes[i] = p[sizeof(T) - 1 - i];
+		}
+		std::memcpy(&value, bytes, sizeof(T));
+	}
+	else {
+		std::memcpy(&value, p, sizeof(T));
+	}
+	return value;
+}
+
+static double loadScalar(const unsigned char* p, PlyType type, bool swap) {
+	switch (type) {
+	case PlyType::Int8:
+		return (int8_t)*p;
+	case PlyType::UInt8:
+		return *p;
+	case PlyType::Int16:
+		return loadValue<int16_t>(p, swap);
+	case PlyType::UInt16:
+		return loadValue<uint16_t>(p, swap);
+	case PlyType::Int32:
+		return loadValue<int32_t>(p, swap);
+	case PlyType::UInt32:
+		return loadValue<uint32_t>(p, swap);
+	case PlyType::Float32:
+		return loadValue<float>(p, swap);
+	default:
+		return loadValue<double>(p, swap);
+	}
+}
+
+//list counts and vertex indices, negative values become huge and fail range checks
+static uint64_t loadInteger(const unsigned char* p, PlyType type, bool swap) {
+	switch (type) {
+	case PlyType::Int8:
+		return (uint64_t)(int64_t)(int8_t)*p;
+	case PlyType::UInt8:
+		return *p;
+	case PlyType::Int16:
+		return (uint64_t)(int64_t)loadValue<int16_t>(p, swap);
+	case PlyType::UInt16:
+		return loadValue<uint16_t>(p, swap);
+	case PlyType::Int32:
+		return (uint64_t)(int64_t)loadValue<int32_t>(p, swap);
+	case PlyType::UInt32:
+		return loadValue<uint32_t>(p, swap);
+	default:
+		return (uint64_t)loadScalar(p, type, swap);
+	}
+}
+
+static glm::vec3 loadPlyVector(const unsigned char* record, PlyType type, const size_t offsets[3], bool swap) {
+	return glm::vec3((float)loadScalar(record + offsets[0], type, swap), (float)loadScalar(record + offsets[1], type, swap),
+		(float)loadScalar(record + offsets[2], type, swap));
+}
+
+//steps over one face record, returns its end and index list, nullptr when record does not fit before end of data
+static const unsigned char* parsePlyFace(const unsigned char* p, const unsigned char* end, const ScanLayout& layout, const unsigned char*& indices, uint64_t& count) {
+	for (size_t i = 0; i < layout.faceProperties.size(); i++) {
+		const PlyProperty& property = layout.faceProperties[i];
+		if (!property.list) {
+			if ((size_t)(end - p) < plyTypeSize(property.type)) {
+				return nullptr;
+			}
+			p += plyTypeSize(property.type);
+			continue;
+		}
+		size_t countSize = plyTypeSize(property.countType);
+		if ((size_t)(end - p) < countSize) {
+			return nullptr;
+		}
+		uint64_t values = loadInteger(p, property.countType, layout.bigEndian);
+		p += countSize;
+		if (values > (uint64_t)(end - p) / plyTypeSize(property.type)) {
+			return nullptr;
+		}
+		if (i == layout.indexProperty) {
+			indices = p;
+			count = values;
+		}
+		p += values * plyTypeSize(property.type);
+	}
+	return p;
+}
+
+//triangle corners of face with given number of corners, polygons are triangulated as fans
+static size_t fanCorners(uint64_t count) {
+	return count >= 3 ? (size_t)(count - 2) * 3 : 0;
+}
+
+static bool parseStlHeader(const MappedFile& file, ScanLayout& layout, std::string& unsupported) {
+	if (file.size() < stlHeaderBytes) {
+		unsupported = "file too small for binary stl";
+		return false;
+	}
+	uint32_t count = loadValue<uint32_t>(file.data() + 80, false);
+	uint64_t expected = stlHeaderBytes + (uint64_t)count * stlTriangleBytes;
+	//binary files may start with "solid" like ascii ones, then their size has to match exactly
+	bool solid = std::memcmp(file.data(), "solid", 5) == 0;
+	if (file.size() < expected || (solid && file.size() != expected)) {
+		unsupported = "ascii stl";
+		return false;
+	}
+	if (count == 0) {
+		unsupported = "no triangles";
+		return false;
+	}
+	layout.facesBegin = stlHeaderBytes;
+	layout.facesEnd = (size_t)expected;
+	layout.faceCount = count;
+	return true;
+}
+
+static bool parsePlyHeader(const MappedFile& file, ScanLayout& layout, std::string& unsupported) {
+	layout.ply = true;
+	const char* text = (const char*)file.data();
+	size_t size = file.size();
+	std::vector<PlyElement> elements;
+	std::string format;
+	size_t position = 0;
+	size_t dataBegin = 0;
+	bool first = true;
+	while (position < size && dataBegin == 0) {
+		const char* lineEnd = (const char*)std::memchr(text + position, '\n', size - position);
+		if (!lineEnd) {
+			break;
+		}
+		std::string line(text + position, lineEnd);
+		position = lineEnd - text + 1;
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		std::istringstream words(line);
+		std::string keyword;
+		words >> keyword;
+		if (first) {
+			if (keyword != "ply") {
+				unsupported = "missing ply signature";
+				return false;
+			}
+			first = false;
+		}
+		else if (keyword == "format") {
+			words >> format;
+		}
+		else if (keyword == "element") {
+			PlyElement element;
+			words >> element.name >> element.count;
+			elements.push_back(element);
+		}
+		else if (keyword == "property") {
+			if (elements.empty()) {
+				unsupported = "property outside of element";
+				return false;
+			}
+			PlyProperty property;
+			std::string type;
+			words >> type;
+			if (type == "list") {
+				std::string countType;
+				words >> countType >> type;
+				property.list = true;
+				if (!parsePlyType(countType, property.countType)) {
+					unsupported = "unknown ply type " + countType;
+					return false;
+				}
+			}
+			if (!parsePlyType(type, property.type)) {
+				unsupported = "unknown ply type " + type;
+				return false;
+			}
+			words >> property.name;
+			elements.back().properties.push_back(property);
+		}
+		else if (keyword == "end_header") {
+			dataBegin = position;
+		}
+	}
+	if (dataBegin == 0) {
+		unsupported = "incomplete ply header";
+		return false;
+	}
+	if (format != "binary_little_endian" && format != "binary_big_endian") {
+		unsupported = format + " ply";
+		return false;
+	}
+	layout.bigEndian = format == "binary_big_endian";
+
+	//elements before faces are stepped over by their fixed size
+	size_t offset = dataBegin;
+	bool vertices = false;
+	for (const auto& element : elements) {
+		if (element.name == "face") {
+			if (!vertices) {
+				unsupported = "faces stored before vertices";
+				return false;
+			}
+			layout.faceProperties = element.properties;
+			layout.faceCount = element.count;
+			layout.facesBegin = offset;
+			layout.facesEnd = size;
+			for (size_t i = 0; i < element.properties.size(); i++) {
+				const PlyProperty& property = element.properties[i];
+				if (property.list && (property.name == "vertex_indices" || property.name == "vertex_index")) {
+					layout.indexProperty = i;
+					if (property.type == PlyType::Float32 || property.type == PlyType::Float64) {
+						unsupported = "vertex indices stored as floats";
+						return false;
+					}
+					if (layout.faceCount == 0) {
+						unsupported = "no faces";
+						return false;
+					}
+					return true;
+				}
+			}
+			unsupported = "faces without vertex indices";
+			return false;
+		}
+		size_t stride = 0;
+		int found = 0;
+		int normalsFound = 0;
+		for (const auto& property : element.properties) {
+			if (property.list) {
+				unsupported = "list property in element " + element.name;
+				return false;
+			}
+			static const char* positionNames[] = { "x", "y", "z" };
+			static const char* normalNames[] = { "nx", "ny", "nz" };
+			for (int c = 0; c < 3; c++) {
+				if (property.name == positionNames[c]) {
+					layout.positionOffsets[c] = stride;
+					layout.positionType = property.type;
+					found++;
+				}
+				if (property.name == normalNames[c]) {
+					layout.normalOffsets[c] = stride;
+					layout.normalType = property.type;
+					normalsFound++;
+				}
+			}
+			stride += plyTypeSize(property.type);
+		}
+		if (element.name == "vertex") {
+			//x, y and z of different types are read as type of the last one, scanners never mix them
+			if (found != 3) {
+				unsupported = "vertices without positions";
+				return false;
+			}
+			vertices = true;
+			layout.verticesBegin = offset;
+			layout.vertexCount = element.count;
+			layout.vertexStride = stride;
+			layout.hasNormals = normalsFound == 3;
+		}
+		if (element.count > (size - offset) / std::max<size_t>(stride, 1)) {
+			unsupported = "element " + element.name + " exceeds file";
+			return false;
+		}
+		offset += element.count * stride;
+	}
+	unsupported = vertices ? "point cloud without faces" : "no vertices";
+	return false;
+}
+
+//welds corners with bit-identical positions, stl stores every corner on its own
+static void buildStlChunk(const MappedFile& file, const ScanStream::Chunk& chunk, ScanChunkBuilder& builder) {
+	std::unordered_map<ScanPosition, uint32_t, ScanPositionHash> welded;
+	welded.reserve(chunk.corners);
+	builder.indices.reserve(chunk.corners);
+	const unsigned char* triangle = file.data() + chunk.begin;
+	for (size_t t = 0; t < chunk.faces; t++, triangle += stlTriangleBytes) {
+		uint32_t corners[3];
+		for (int c = 0; c < 3; c++) {
+			glm::vec3 position;
+			std::memcpy(&position, triangle + 12 + c * sizeof(glm::vec3), sizeof(glm::vec3));
+			//negative zero welds with zero
+			position += glm::vec3(0.f);
+			ScanPosition key;
+			std::memcpy(key.bits, &position, sizeof(key.bits));
+			auto inserted = welded.emplace(key, (uint32_t)builder.positions.size());
+			if (inserted.second) {
+				builder.positions.push_back(position);
+				builder.normals.push_back(glm::vec3(0.f));
+			}
+			corners[c] = inserted.first->second;
+		}
+		builder.addTriangle(corners[0], corners[1], corners[2]);
+	}
+}
+
+//vertex indices of file are mapped to indices within chunk in order of first use
+static void buildPlyChunk(const MappedFile& file, const ScanLayout& layout, const ScanStream::Chunk& chunk, ScanChunkBuilder& builder) {
+	std::unordered_map<uint64_t, uint32_t> welded;
+	welded.reserve(chunk.corners / 2);
+	builder.indices.reserve(chunk.corners);
+	builder.accumulateNormals = !layout.hasNormals;
+	const unsigned char* p = file.data() + chunk.begin;
+	const unsigned char* end = file.data() + chunk.end;
+	size_t indexSize = plyTypeSize(layout.faceProperties[layout.indexProperty].type);
+	PlyType indexType = layout.faceProperties[layout.indexProperty].type;
+	std::vector<uint32_t> polygon;
+	for (size_t f = 0; f < chunk.faces; f++) {
+		const unsigned char* indices = nullptr;
+		uint64_t count = 0;
+		p = parsePlyFace(p, end, layout, indices, count);
+		polygon.clear();
+		for (uint64_t i = 0; i < count; i++) {
+			uint64_t index = loadInteger(indices + i * indexSize, indexType, layout.bigEndian);
+			if (index >= layout.vertexCount) {
+				polygon.clear();
+				builder.droppedTriangles += fanCorners(count) / 3;
+				break;
+			}
+			auto inserted = welded.emplace(index, (uint32_t)builder.positions.size());
+			if (inserted.second) {
+				const unsigned char* record = file.data() + layout.verticesBegin + index * layout.vertexStride;
+				builder.positions.push_back(loadPlyVector(record, layout.positionType, layout.positionOffsets, layout.bigEndian));
+				builder.normals.push_back(layout.hasNormals ? loadPlyVector(record, layout.normalType, layout.normalOffsets, layout.bigEndian) : glm::vec3(0.f));
+			}
+			polygon.push_back(inserted.first->second);
+		}
+		for (size_t i = 2; i < polygon.size(); i++) {
+			builder.addTriangle(polygon[0], polygon[i - 1], polygon[i]);
+		}
+	}
+}
+
+//positions and normals interleaved followed by indices, one buffer range each
+static std::shared_ptr<MeshSource> packChunk(ScanChunkBuilder& builder) {
+	if (builder.indices.empty()) {
+		return nullptr;
+	}
+	size_t vertexBytes = builder.positions.size() * 2 * sizeof(glm::vec3);
+	size_t indexBytes = builder.indices.size() * sizeof(uint32_t);
+	auto buffer = std::make_shared<std::vector<unsigned char>>(vertexBytes + indexBytes);
+	unsigned char* vertex = buffer->data();
+	auto source = std::make_shared<MeshSource>();
+	source->boundsMin = source->boundsMax = builder.positions[0];
+	for (size_t i = 0; i < builder.positions.size(); i++) {
+		float length = glm::length(builder.normals[i]);
+		glm::vec3 normal = length > 0.f ? builder.normals[i] / length : glm::vec3(0.f, 0.f, 1.f);
+		std::memcpy(vertex, &builder.positions[i], sizeof(glm::vec3));
+		std::memcpy(vertex + sizeof(glm::vec3), &normal, sizeof(glm::vec3));
+		vertex += 2 * sizeof(glm::vec3);
+		source->boundsMin = glm::min(source->boundsMin, builder.positions[i]);
+		source->boundsMax = glm::max(source->boundsMax, builder.positions[i]);
+	}
+	std::memcpy(vertex, builder.indices.data(), indexBytes);
+
+	source->data = buffer->data();
+	source->owner = std::move(buffer);
+	source->ranges = { { 0, vertexBytes }, { vertexBytes, indexBytes } };
+	source->position = { 0, 0, (GLsizei)(2 * sizeof(glm::vec3)), 3, GL_FLOAT, GL_FALSE };
+	source->normal = { 0, sizeof(glm::vec3), (GLsizei)(2 * sizeof(glm::vec3)), 3, GL_FLOAT, GL_FALSE };
+	source->indexRange = 1;
+	source->indexType = GL_UNSIGNED_INT;
+	source->indexCount = builder.indices.size();
+	source->vertexCount = builder.positions.size();
+	source->color = scanColor;
+	return source;
+}
+
+bool IsScanPath(const std::string& path) {
+	return hasExtension(path, ".ply") || hasExtension(path, ".stl");
+}
+
+	ScanStream::ScanStream() {
+	}
+
+	ScanStream::~ScanStream() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		changed.notify_all();
+		for (auto& thread : threads) {
+			thread.join();
+		}
+	}
+
+	std::shared_ptr<ScanStream> ScanStream::open(const std::string& path, size_t chunkBytes, std::string& unsupported, MappedFileCache* cache) {
+		auto startTime = std::chrono::steady_clock::now();
+		if (!IsScanPath(path)) {
+			unsupported = "not ply or stl";
+			return nullptr;
+		}
+		std::shared_ptr<MappedFile> file = MapFile(path, cache);
+		if (!file) {
+			unsupported = "file cannot be read";
+			return nullptr;
+		}
+		auto layout = std::make_unique<ScanLayout>();
+		bool parsed = hasExtension(path, ".ply") ? parsePlyHeader(*file, *layout, unsupported) : parseStlHeader(*file, *layout, unsupported);
+		if (!parsed) {
+			return nullptr;
+		}
+		std::shared_ptr<ScanStream> stream(new ScanStream());
+		stream->path = path;
+		stream->file = std::move(file);
+		stream->layout = std::move(layout);
+		stream->chunkBytes = std::max<size_t>(chunkBytes, stlTriangleBytes);
+		stream->startTime = startTime;
+		stream->stats.fileBytes = stream->file->size();
+		//one hardware thread is left to thread uploading chunks
+		unsigned int threadCount = std::thread::hardware_concurrency();
+		stream->start(threadCount > 1 ? threadCount - 1 : 1);
+		return stream;
+	}
+
+	void ScanStream::start(unsigned int workerCount) {
+		//every worker can hold one chunk while a few more wait for upload
+		capacity = workerCount + 2;
+		threads.emplace_back(&ScanStream::read, this);
+		for (unsigned int i = 0; i < workerCount; i++) {
+			threads.emplace_back(&ScanStream::work, this);
+		}
+	}
+
+	bool ScanStream::hasCapacity() const {
+		return pending < capacity;
+	}
+
+	void ScanStream::read() {
+		size_t position = layout->facesBegin;
+		size_t faces = 0;
+		bool truncated = false;
+		while (faces < layout->faceCount && !truncated) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [this]() { return stopping || hasCapacity(); });
+				if (stopping) {
+					break;
+				}
+			}
+			Chunk chunk;
+			chunk.begin = position;
+			if (layout->ply) {
+				//face records differ in size, chunk ends with first record crossing chunk size
+				const unsigned char* data = file->data();
+				const unsigned char* end = data + layout->facesEnd;
+				const unsigned char* p = data + position;
+				while (faces < layout->faceCount && (size_t)(p - data) - chunk.begin < chunkBytes) {
+					const unsigned char* indices = nullptr;
+					uint64_t count = 0;
+					const unsigned char* next = parsePlyFace(p, end, *layout, indices, count);
+					if (!next) {
+						truncated = true;
+						break;
+					}
+					p = next;
+					chunk.faces++;
+					chunk.corners += fanCorners(count);
+					faces++;
+				}
+				position = p - data;
+			}
+			else {
+				chunk.faces = std::min(chunkBytes / stlTriangleBytes, layout->faceCount - faces);
+				chunk.corners = chunk.faces * 3;
+				faces += chunk.faces;
+				position += chunk.faces * stlTriangleBytes;
+			}
+			chunk.end = position;
+			std::lock_guard<std::mutex> lock(mutex);
+			stats.parsedBytes = position;
+			if (chunk.faces > 0) {
+				queued.push_back(chunk);
+				pending++;
+			}
+			changed.notify_all();
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.truncated = truncated;
+		readerDone = true;
+		changed.notify_all();
+	}
+
+	void ScanStream::work() {
+		while (true) {
+			Chunk chunk;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [this]() { return stopping || !queued.empty() || readerDone; });
+				if (stopping || queued.empty()) {
+					return;
+				}
+				chunk = queued.front();
+				queued.pop_front();
+			}
+			ScanChunkBuilder builder;
+			if (layout->ply) {
+				buildPlyChunk(*file, *layout, chunk, builder);
+			}
+			else {
+				buildStlChunk(*file, chunk, builder);
+			}
+			size_t vertices = builder.positions.size();
+			std::shared_ptr<MeshSource> source = packChunk(builder);
+			//face records are not read again, positions of ply vertices may be
+			file->release(chunk.begin, chunk.end - chunk.begin);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			stats.chunks++;
+			stats.triangles += builder.indices.size() / 3;
+			stats.corners += chunk.corners;
+			stats.vertices += vertices;
+			stats.droppedTriangles += builder.droppedTriangles;
+			if (stats.chunks == 1) {
+				stats.firstChunkMs = millisecondsSince(startTime);
+			}
+			stats.totalMs = millisecondsSince(startTime);
+			if (source) {
+				stats.queuedBytes += source->bytes();
+				stats.peakQueuedBytes = std::max(stats.peakQueuedBytes, stats.queuedBytes);
+				finished.push_back(std::move(source));
+			}
+			else {
+				pending--;
+			}
+			changed.notify_all();
+		}
+	}
+
+	bool ScanStream::pop(std::shared_ptr<MeshSource>& chunk) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (finished.empty()) {
+			return false;
+		}
+		chunk = std::move(finished.front());
+		finished.pop_front();
+		pending--;
+		stats.queuedBytes -= chunk->bytes();
+		changed.notify_all();
+		return true;
+	}
+
+	void ScanStream::wait() {
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [this]() { return stopping || !finished.empty() || (readerDone && pending == 0); });
+	}
+
+	bool ScanStream::isDone() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return readerDone && pending == 0;
+	}
+
+	ScanStreamStats ScanStream::getStats() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return stats;
+	}
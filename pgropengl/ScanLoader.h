@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mesh.h"
+#include "MappedFileCache.h"
+
+//progress of one streamed file, totals grow as chunks are finished
+struct ScanStreamStats {
+    size_t fileBytes = 0;
+    //file bytes up to end of last chunk split off, ply vertices are counted with first chunk
+    size_t parsedBytes = 0;
+    size_t chunks = 0;
+    size_t triangles = 0;
+    //triangle corners before and after welding within chunk
+    size_t corners = 0;
+    size_t vertices = 0;
+    //triangles dropped because welding or bad indices made them degenerate
+    size_t droppedTriangles = 0;
+    //vertex and index bytes of finished chunks waiting for upload, the most the loader held at once
+    size_t queuedBytes = 0;
+    size_t peakQueuedBytes = 0;
+    double firstChunkMs = 0.0;
+    double totalMs = 0.0;
+    //file ended in the middle of face data, chunks before are still used
+    bool truncated = false;
+};
+
+//header of stl or ply file, defined by loader
+struct ScanLayout;
+
+//true for .ply and .stl extensions in any case
+bool IsScanPath(const std::string& path);
+
+//binary stl or ply (either byte order) parsed on background threads in chunks of fixed size into meshes drawn from own buffers
+//reader thread splits triangle or face data of mapped file into chunks, workers weld every chunk on its own (exact positions for stl,
+//vertex indices for ply) and build its indices and smooth normals, finished chunks wait in queue until taken for upload
+//at most a few chunks per worker are in flight, reader waits until upload takes one, and pages of parsed chunks are dropped,
+//so memory held stays at a small multiple of chunk size instead of the file size
+//ply positions are looked up in mapped vertex data, normals are taken from file when it has them
+class ScanStream {
+public:
+    //returns nullptr and reason when file is not binary stl or ply with triangle or polygon faces, caller falls back to assimp
+    static std::shared_ptr<ScanStream> open(const std::string& path, size_t chunkBytes, std::string& unsupported, MappedFileCache* cache = nullptr);
+    //stops reader and workers, chunks being parsed are finished first
+    ~ScanStream();
+
+    ScanStream(const ScanStream&) = delete;
+    ScanStream& operator=(const ScanStream&) = delete;
+
+    //takes next finished chunk, false when none is ready
+    bool pop(std::shared_ptr<MeshSource>& chunk);
+    //blocks until some chunk is ready or whole file is done
+    void wait();
+    //true once every chunk was parsed and taken
+    bool isDone() const;
+    ScanStreamStats getStats() const;
+
+    const std::string& getPath() const { return path; }
+
+    //byte range of triangle or face records parsed as one mesh
+    struct Chunk {
+        size_t begin = 0;
+        size_t end = 0;
+        size_t faces = 0;
+        size_t corners = 0;
+    };
+
+private:
+    ScanStream();
+
+    void start(unsigned int workerCount);
+    void read();
+    void work();
+    //true when reader may queue another chunk, called under lock
+    bool hasCapacity() const;
+
+    std::string path;
+    std::shared_ptr<MappedFile> file;
+    std::unique_ptr<ScanLayout> layout;
+    size_t chunkBytes = 0;
+    std::chrono::steady_clock::time_point startTime;
+
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Chunk> queued;
+    std::deque<std::shared_ptr<MeshSource>> finished;
+    //chunks queued, being parsed or waiting for upload, bounded by capacity
+    size_t pending = 0;
+    size_t capacity = 0;
+    bool readerDone = false;
+    bool stopping = false;
+    ScanStreamStats stats;
+    std::vector<std::thread> threads;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+//node hierarchy of imported scene stored as flat arrays, parents always come before their children,
+//so world transforms are refreshed by one linear pass which recomputes only nodes whose own or parent transform changed
+class SceneGraph {
+public:
+    //returns index of new node, parent has to exist already (-1 for root)
+    int addNode(int parent, const glm::mat4& localTransform)
+    {
+        parents.push_back(parent);
+        localTransforms.push_back(localTransform);
+        worldTransforms.push_back(localTransform);
+        dirty.push_back(1);
+        anyDirty = true;
+        return (int)parents.size() - 1;
+    }
+
+    void setLocalTransform(int node, const glm::mat4& localTransform)
+    {
+        localTransforms[node] = localTransform;
+        dirty[node] = 1;
+        anyDirty = true;
+    }
+
+    //recomputes world transforms of changed nodes and their descendants, returns false when nothing changed
+    bool update()
+    {
+        if (!anyDirty) {
+            return false;
+        }
+        for (size_t i = 0; i < parents.size(); i++) {
+            int parent = parents[i];
+            //parent was visited first, its flag already tells whether it moved in this pass
+            if (parent >= 0 && dirty[parent]) {
+                dirty[i] = 1;
+            }
+            if (dirty[i]) {
+                worldTransforms[i] = parent >= 0 ? worldTransforms[parent] * localTransforms[i] : localTransforms[i];
+            }
+        }
+        std::fill(dirty.begin(), dirty.end(), (uint8_t)0);
+        anyDirty = false;
+        return true;
+    }
+
+    void clear()
+    {
+        parents.clear();
+        localTransforms.clear();
+        worldTransforms.clear();
+        dirty.clear();
+        anyDirty = false;
+    }
+
+    size_t size() const { return parents.size(); }
+    int getParent(int node) const { return parents[node]; }
+    const glm::mat4& getLocalTransform(int node) const { return localTransforms[node]; }
+    //valid after update()
+    const glm::mat4& getWorldTransform(int node) const { return worldTransforms[node]; }
+
+private:
+    std::vector<int> parents;
+    std::vector<glm::mat4> localTransforms;
+    std::vector<glm::mat4> worldTransforms;
+    std::vector<uint8_t> dirty;
+    bool anyDirty = false;
+};
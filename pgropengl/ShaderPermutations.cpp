@@ -0,0 +1,289 @@
+#include "ShaderPermutations.h"
+#include <SDL.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+
+static const int lightingModelShift = 5;
+//material feature combinations, depth only program is single one
+static const int featureCombinations = ShaderDepthOnly;
+
+//all depth only requests share one program, only instancing changes it
+static int normalizeKey(int key) {
+	return (key & ShaderDepthOnly) ? key & (ShaderDepthOnly | ShaderInstanced) : key;
+}
+
+bool LoadShaderFile(const std::string& fileName, std::string& source) {
+	std::ifstream file(fileName);
+	if (!file.is_open()) {
+		std::cout << "Failed to open file: " << fileName << std::endl;
+		return false;
+	}
+	std::string line;
+	source.clear();
+	while (std::getline(file, line)) {
+		source += line + "\n";
+	}
+	return true;
+}
+
+GLuint CompileShader(GLenum type, const std::string& src, const std::string& defines) {
+	GLuint shader = glCreateShader(type);
+	size_t versionEnd = src.find('\n') + 1;
+	std::string version = src.substr(0, versionEnd);
+	const char* sources[] = { version.c_str(), defines.c_str(), src.c_str() + versionEnd };
+	glShaderSource(shader, 3, sources, nullptr);
+	glCompileShader(shader);
+	return shader;
+}
+
+bool PrintShaderLog(GLuint shader) {
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (compiled) {
+		return true;
+	}
+	GLint length = 0;
+	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+	std::string log(length, '\0');
+	glGetShaderInfoLog(shader, length, nullptr, &log[0]);
+	std::cout << "Shader compilation failed: " << log << std::endl;
+	return false;
+}
+
+	ShaderPermutations::ShaderPermutations(const std::string& vertexPath, const std::string& fragmentPath, const std::string& geometryPath, const std::string& cacheDirectory)
+		: vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath), cacheDirectory(cacheDirectory) {
+	}
+
+	void ShaderPermutations::compileAll() {
+		//model cannot be drawn at all without its shaders
+		if (!LoadShaderFile(vertexPath, vertexSource) || !LoadShaderFile(fragmentPath, fragmentSource) || !LoadShaderFile(geometryPath, geometrySource)) {
+			exit(1);
+		}
+		viewportExtension = GLAD_GL_ARB_shader_viewport_layer_array ? 1 : GLAD_GL_AMD_vertex_shader_viewport_index ? 2 : 0;
+		driverId = std::string((const char*)glGetString(GL_RENDERER)) + (const char*)glGetString(GL_VERSION);
+
+		parallel = GLAD_GL_KHR_parallel_shader_compile != 0;
+		if (parallel) {
+			//let driver use as many compiler threads as it wants
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		}
+		if (uniformBuffer == 0) {
+			glCreateBuffers(1, &uniformBuffer);
+			glNamedBufferStorage(uniformBuffer, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_STORAGE_BIT);
+			glCreateBuffers(1, &multiViewBuffer);
+			glNamedBufferStorage(multiViewBuffer, sizeof(MultiViewUniforms), nullptr, GL_DYNAMIC_STORAGE_BIT);
+		}
+
+		compileStart = SDL_GetPerformanceCounter();
+		//current lighting model first, its programs are needed for first frame
+		for (int i = 0; i < LightingModelCount; i++) {
+			int lighting = (lightingModel + i) % LightingModelCount;
+			for (int features = 0; features < featureCombinations; features++) {
+				int key = features | lighting << lightingModelShift;
+				if (programs.find(key) == programs.end()) {
+					createProgram(key);
+				}
+			}
+		}
+		if (programs.find(ShaderDepthOnly) == programs.end()) {
+			createProgram(ShaderDepthOnly);
+		}
+	}
+
+	GLuint ShaderPermutations::getProgram(int features) {
+		int key = normalizeKey(features | lightingModel << lightingModelShift);
+		auto found = programs.find(key);
+		Program& program = found != programs.end() ? found->second : createProgram(key);
+		if (!program.ready) {
+			//driver would wait for compilation on first use anyway
+			finishProgram(program);
+		}
+		return program.id;
+	}
+
+	void ShaderPermutations::update() {
+		if (!parallel || readyCount == programs.size()) {
+			return;
+		}
+		for (auto& program : programs) {
+			if (program.second.ready) {
+				continue;
+			}
+			GLint completed = GL_FALSE;
+			glGetProgramiv(program.second.id, GL_COMPLETION_STATUS_KHR, &completed);
+			if (completed) {
+				finishProgram(program.second);
+			}
+		}
+	}
+
+	void ShaderPermutations::setFrameUniforms(GLStateCache& state, const FrameUniforms& uniforms) {
+		state.bufferSubData(uniformBuffer, 0, sizeof(FrameUniforms), &uniforms);
+		state.bindUniformBuffer(0, uniformBuffer);
+	}
+
+	void ShaderPermutations::setMultiViewUniforms(GLStateCache& state, const MultiViewUniforms& uniforms) {
+		state.bufferSubData(multiViewBuffer, 0, sizeof(MultiViewUniforms), &uniforms);
+		state.bindUniformBuffer(1, multiViewBuffer);
+	}
+
+	void ShaderPermutations::release() {
+		for (auto& program : programs) {
+			glDeleteShader(program.second.vertexShader);
+			glDeleteShader(program.second.fragmentShader);
+			glDeleteShader(program.second.geometryShader);
+			glDeleteProgram(program.second.id);
+		}
+		programs.clear();
+		glDeleteBuffers(1, &uniformBuffer);
+		glDeleteBuffers(1, &multiViewBuffer);
+		uniformBuffer = multiViewBuffer = 0;
+		readyCount = cachedCount = 0;
+	}
+
+	ShaderPermutations::Program& ShaderPermutations::createProgram(int key) {
+		if (compileStart == 0) {
+			compileStart = SDL_GetPerformanceCounter();
+		}
+		Program& program = programs[key];
+		program.id = glCreateProgram();
+		std::string defines = buildDefines(key);
+
+		//FNV-1a of everything the binary depends on
+		uint64_t hash = 14695981039346656037ull;
+		for (const std::string* part : { &driverId, &defines, &vertexSource, &fragmentSource, &geometrySource }) {
+			for (unsigned char c : *part) {
+				hash ^= c;
+				hash *= 1099511628211ull;
+			}
+		}
+		std::ostringstream name;
+		name << cacheDirectory << '/' << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+		program.cachePath = name.str();
+
+		if (loadBinary(program)) {
+			cachedCount++;
+			finishProgram(program);
+			return program;
+		}
+
+		program.vertexShader = CompileShader(GL_VERTEX_SHADER, vertexSource, defines);
+		glAttachShader(program.id, program.vertexShader);
+		if (!(key & ShaderDepthOnly)) {
+			program.fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentSource, defines);
+			glAttachShader(program.id, program.fragmentShader);
+		}
+		if ((key & ShaderMultiView) && viewportExtension == 0) {
+			program.geometryShader = CompileShader(GL_GEOMETRY_SHADER, geometrySource, defines);
+			glAttachShader(program.id, program.geometryShader);
+		}
+		glProgramParameteri(program.id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(program.id);
+		//without parallel compilation link is finished right away, otherwise update() picks it up later
+		if (!parallel) {
+			finishProgram(program);
+		}
+		return program;
+	}
+
+	void ShaderPermutations::finishProgram(Program& program) {
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program.id, GL_LINK_STATUS, &linked);
+		if (!linked) {
+			PrintShaderLog(program.vertexShader);
+			if (program.fragmentShader != 0) {
+				PrintShaderLog(program.fragmentShader);
+			}
+			if (program.geometryShader != 0) {
+				PrintShaderLog(program.geometryShader);
+			}
+			GLint length = 0;
+			glGetProgramiv(program.id, GL_INFO_LOG_LENGTH, &length);
+			std::string log(length, '\0');
+			glGetProgramInfoLog(program.id, length, nullptr, &log[0]);
+			std::cout << "Program linking failed: " << log << std::endl;
+		}
+		else if (program.vertexShader != 0) {
+			saveBinary(program);
+		}
+		if (program.vertexShader != 0) {
+			glDetachShader(program.id, program.vertexShader);
+			if (program.fragmentShader != 0) {
+				glDetachShader(program.id, program.fragmentShader);
+			}
+			if (program.geometryShader != 0) {
+				glDetachShader(program.id, program.geometryShader);
+			}
+			glDeleteShader(program.vertexShader);
+			glDeleteShader(program.fragmentShader);
+			glDeleteShader(program.geometryShader);
+			program.vertexShader = program.fragmentShader = program.geometryShader = 0;
+		}
+		program.ready = true;
+		readyCount++;
+		if (readyCount == programs.size()) {
+			compileMs = (SDL_GetPerformanceCounter() - compileStart) * 1000.0 / SDL_GetPerformanceFrequency();
+		}
+	}
+
+	std::string ShaderPermutations::buildDefines(int key) const {
+		std::ostringstream defines;
+		defines << "#define LIGHTING_PHONG " << LightingPhong << "\n";
+		defines << "#define LIGHTING_BLINN_PHONG " << LightingBlinnPhong << "\n";
+		defines << "#define LIGHTING_UNLIT " << LightingUnlit << "\n";
+		defines << "#define TEXTURED " << ((key & ShaderTextured) ? 1 : 0) << "\n";
+		defines << "#define TRANSPARENT " << ((key & ShaderTransparent) ? 1 : 0) << "\n";
+		defines << "#define DEPTH_ONLY " << ((key & ShaderDepthOnly) ? 1 : 0) << "\n";
+		defines << "#define MULTI_VIEW " << ((key & ShaderMultiView) ? 1 : 0) << "\n";
+		defines << "#define INSTANCED " << ((key & ShaderInstanced) ? 1 : 0) << "\n";
+		defines << "#define MULTI_VIEW_COUNT " << MultiViewCount << "\n";
+		defines << "#define VIEWPORT_EXTENSION " << viewportExtension << "\n";
+		defines << "#define LIGHTING_MODEL " << (key >> lightingModelShift) << "\n";
+		return defines.str();
+	}
+
+	bool ShaderPermutations::loadBinary(Program& program) const {
+		std::ifstream file(program.cachePath, std::ios::binary);
+		if (!file.is_open()) {
+			return false;
+		}
+		GLenum format = 0;
+		file.read((char*)&format, sizeof(format));
+		if (!file) {
+			return false;
+		}
+		std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (binary.empty()) {
+			return false;
+		}
+		glProgramBinary(program.id, format, binary.data(), (GLsizei)binary.size());
+		//driver rejects binaries of older driver versions, program is then compiled from source
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program.id, GL_LINK_STATUS, &linked);
+		return linked == GL_TRUE;
+	}
+
+	void ShaderPermutations::saveBinary(const Program& program) const {
+		GLint length = 0;
+		glGetProgramiv(program.id, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) {
+			return;
+		}
+		std::vector<char> binary(length);
+		GLenum format = 0;
+		glGetProgramBinary(program.id, length, nullptr, &format, binary.data());
+
+		std::error_code error;
+		std::filesystem::create_directories(cacheDirectory, error);
+		std::ofstream file(program.cachePath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			std::cout << "Failed to write shader cache: " << program.cachePath << std::endl;
+			return;
+		}
+		file.write((const char*)&format, sizeof(format));
+		file.write(binary.data(), binary.size());
+	}
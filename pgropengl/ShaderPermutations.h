@@ -0,0 +1,137 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "GLStateCache.h"
+
+//reads whole shader source file, false when it cannot be opened
+bool LoadShaderFile(const std::string& fileName, std::string& source);
+//defines are inserted right after #version line, which has to stay first
+//compile status is not queried, so parallel compilation is not waited for
+GLuint CompileShader(GLenum type, const std::string& src, const std::string& defines = "");
+//prints compile log of failed shader, false when it failed
+bool PrintShaderLog(GLuint shader);
+
+//features of mesh material, each combination gets its own specialized program
+enum ShaderFeature {
+    ShaderTextured = 1,
+    ShaderTransparent = 2,
+    //positions only, no fragment shader, other features and lighting model are ignored
+    ShaderDepthOnly = 4,
+    //instanced draw renders instance i with view i of MultiViewUniforms into viewport i
+    ShaderMultiView = 8,
+    //instance matrix and color override come from instance buffer, indexed from gl_BaseInstance
+    ShaderInstanced = 16,
+};
+
+//views rendered by one instanced draw
+const int MultiViewCount = 4;
+
+enum LightingModel {
+    LightingPhong,
+    LightingBlinnPhong,
+    LightingUnlit,
+    LightingModelCount
+};
+
+//uniform block shared by all permutations, layout matches FrameUniforms in shaders (std140)
+struct FrameUniforms {
+    glm::mat4 modelMatrix;
+    glm::mat4 viewMatrix;
+    glm::mat4 projectionMatrix;
+    glm::vec4 lightPosition;
+    glm::vec4 lightColor;
+};
+
+//per view matrices of multi view permutations, layout matches MultiViewUniforms in vertex shader (std140)
+struct MultiViewUniforms {
+    glm::mat4 viewMatrices[MultiViewCount];
+    glm::mat4 projectionMatrices[MultiViewCount];
+};
+
+//shader storage binding of instance buffer
+const GLuint InstanceBufferBinding = 2;
+
+//one element of instance buffer of instanced permutations, layout matches Instance in vertex shader (std430)
+//instance matrix is applied after model matrix of frame uniforms
+struct InstanceData {
+    glm::mat4 modelMatrix;
+    //rgb replaces material color by amount in alpha
+    glm::vec4 colorOverride;
+};
+
+//programs specialized by feature defines injected into one pair of shader sources
+//permutations are compiled in parallel when driver supports GL_KHR_parallel_shader_compile
+//and their binaries are cached on disk, so next start only loads them
+//multi view permutations select viewport in vertex shader, geometry shader does it when driver cannot
+class ShaderPermutations {
+public:
+    ShaderPermutations(const std::string& vertexPath, const std::string& fragmentPath, const std::string& geometryPath, const std::string& cacheDirectory);
+
+    //loads sources and starts compilation of every permutation, does not wait for it
+    void compileAll();
+    //program for material features with current lighting model, using program not compiled yet waits for it
+    GLuint getProgram(int features);
+    //finishes programs whose background compilation completed, call once per frame
+    void update();
+    //uploads uniforms shared by all permutations and binds them
+    void setFrameUniforms(GLStateCache& state, const FrameUniforms& uniforms);
+    void setMultiViewUniforms(GLStateCache& state, const MultiViewUniforms& uniforms);
+    //deletes all GL objects, call before GL context is destroyed
+    void release();
+
+    void setLightingModel(LightingModel model) { lightingModel = model; }
+    LightingModel getLightingModel() const { return lightingModel; }
+
+    size_t getProgramCount() const { return programs.size(); }
+    size_t getReadyCount() const { return readyCount; }
+    size_t getCachedCount() const { return cachedCount; }
+    bool isParallel() const { return parallel; }
+    //false when multi view needs geometry shader
+    bool isViewportFromVertexShader() const { return viewportExtension != 0; }
+    //time from compileAll until last program finished
+    double getCompileMs() const { return compileMs; }
+
+private:
+    struct Program {
+        GLuint id = 0;
+        GLuint vertexShader = 0;
+        GLuint fragmentShader = 0;
+        GLuint geometryShader = 0;
+        bool ready = false;
+        std::string cachePath;
+    };
+
+    Program& createProgram(int key);
+    //checks link result of finished program and stores its binary
+    void finishProgram(Program& program);
+    std::string buildDefines(int key) const;
+    bool loadBinary(Program& program) const;
+    void saveBinary(const Program& program) const;
+
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string geometryPath;
+    std::string cacheDirectory;
+    std::string vertexSource;
+    std::string fragmentSource;
+    std::string geometrySource;
+    //identifies driver, binaries of other drivers are rejected anyway but would cost failed load every start
+    std::string driverId;
+
+    //key is feature bits with lighting model above them
+    std::unordered_map<int, Program> programs;
+    LightingModel lightingModel = LightingPhong;
+    bool parallel = false;
+    //extension letting vertex shader write gl_ViewportIndex, 1 = ARB, 2 = AMD, 0 = none
+    int viewportExtension = 0;
+    size_t readyCount = 0;
+    size_t cachedCount = 0;
+    uint64_t compileStart = 0;
+    double compileMs = 0.0;
+    GLuint uniformBuffer = 0;
+    GLuint multiViewBuffer = 0;
+};
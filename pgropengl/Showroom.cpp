@@ -0,0 +1,185 @@
+#include "Showroom.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "Frustum.h"
+
+//instance counts of benchmark, each is rendered for benchmarkFrames frames, first warmupFrames are not measured
+static const int benchmarkCounts[] = { 1, 10, 100, 1000, 10000 };
+static const int benchmarkStepCount = sizeof(benchmarkCounts) / sizeof(benchmarkCounts[0]);
+static const int benchmarkFrames = 90;
+static const int warmupFrames = 10;
+
+	void Showroom::addModel(const std::string& path, Model& model, const glm::mat4& modelMatrix) {
+		for (const auto& existing : models) {
+			if (existing.path == path) {
+				return;
+			}
+		}
+		ShowroomModel entry;
+		entry.path = path;
+		entry.modelMatrix = modelMatrix;
+		glm::vec3 boundsMin, boundsMax;
+		model.getBounds(boundsMin, boundsMax);
+		entry.center = glm::vec3(modelMatrix * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.f));
+		//model matrix scales uniformly
+		entry.radius = glm::length(boundsMax - boundsMin) * 0.5f * glm::length(glm::vec3(modelMatrix[0]));
+		entry.model = &model;
+		models.push_back(entry);
+		layout(std::max((int)instances.size(), 1));
+	}
+
+	void Showroom::clearModels() {
+		models.clear();
+		instances.clear();
+	}
+
+	void Showroom::layout(int instanceCount) {
+		instances.clear();
+		if (models.empty()) {
+			return;
+		}
+		int columns = (int)std::ceil(std::sqrt((double)instanceCount));
+		float offset = (columns - 1) * spacing * 0.5f;
+		for (int i = 0; i < instanceCount; i++) {
+			Instance instance;
+			instance.modelIndex = i % (int)models.size();
+			glm::vec3 position((i % columns) * spacing - offset, 0.f, (i / columns) * spacing - offset);
+			//cars turned a little differently so grid does not look copied
+			float yaw = (float)((i * 37) % 360);
+			instance.transform = glm::rotate(glm::translate(glm::mat4(1.f), position), glm::radians(yaw), glm::vec3(0, 1, 0));
+			//hue around color wheel by golden ratio
+			float hue = std::fmod(i * 0.618034f, 1.f) * 6.f;
+			glm::vec3 color = glm::clamp(glm::vec3(std::abs(hue - 3.f) - 1.f, 2.f - std::abs(hue - 2.f), 2.f - std::abs(hue - 4.f)), 0.f, 1.f);
+			instance.color = glm::vec4(color, 1.f);
+			instances.push_back(instance);
+		}
+	}
+
+	void Showroom::resolveModels(const std::function<Model*(const std::string&)>& resolve) {
+		for (auto& model : models) {
+			model.model = resolve(model.path);
+		}
+	}
+
+	void Showroom::submit(RenderQueue& queue, GLStateCache& state, const glm::mat4& viewMatrix, const std::vector<glm::mat4>& viewProjections) {
+		std::vector<Frustum> frustums(viewProjections.begin(), viewProjections.end());
+		visible.clear();
+		visibleCounts.assign(models.size(), 0);
+		//instances of one model have to be consecutive, they are collected model by model
+		for (size_t modelIndex = 0; modelIndex < models.size(); modelIndex++) {
+			const ShowroomModel& model = models[modelIndex];
+			if (!model.model) {
+				continue;
+			}
+			for (const auto& instance : instances) {
+				if (instance.modelIndex != (int)modelIndex) {
+					continue;
+				}
+				if (cullInstances) {
+					glm::vec3 center = glm::vec3(instance.transform * glm::vec4(model.center, 1.f));
+					bool inside = false;
+					for (size_t i = 0; i < frustums.size() && !inside; i++) {
+						inside = frustums[i].intersectsSphere(center, model.radius);
+					}
+					if (!inside) {
+						continue;
+					}
+				}
+				visible.push_back({ instance.transform * model.modelMatrix, glm::vec4(glm::vec3(instance.color), colorOverrideStrength) });
+				visibleCounts[modelIndex]++;
+			}
+		}
+		visibleCount = visible.size();
+
+		//uploaded only when something changed, buffer is orphaned so GPU never waits for it
+		if (visible.size() != uploaded.size() || !std::equal(visible.begin(), visible.end(), uploaded.begin(), [](const InstanceData& a, const InstanceData& b) {
+			return a.modelMatrix == b.modelMatrix && a.colorOverride == b.colorOverride;
+		})) {
+			if (instanceBuffer == 0 || visible.size() > instanceBufferCapacity) {
+				glDeleteBuffers(1, &instanceBuffer);
+				instanceBufferCapacity = std::max(visible.size(), instanceBufferCapacity * 2);
+				glCreateBuffers(1, &instanceBuffer);
+				state.invalidate();
+			}
+			glNamedBufferData(instanceBuffer, instanceBufferCapacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+			glNamedBufferSubData(instanceBuffer, 0, visible.size() * sizeof(InstanceData), visible.data());
+			uploaded = visible;
+		}
+
+		uint32_t baseInstance = 0;
+		for (size_t modelIndex = 0; modelIndex < models.size(); modelIndex++) {
+			if (visibleCounts[modelIndex] == 0) {
+				continue;
+			}
+			//depth of model at origin is good enough for ordering draws of whole grid
+			models[modelIndex].model->submitInstanced(queue, viewMatrix * models[modelIndex].modelMatrix, visibleCounts[modelIndex], baseInstance, instanceBuffer);
+			baseInstance += visibleCounts[modelIndex];
+		}
+	}
+
+	void Showroom::release() {
+		glDeleteBuffers(1, &instanceBuffer);
+		instanceBuffer = 0;
+		instanceBufferCapacity = 0;
+		uploaded.clear();
+		timer.release();
+	}
+
+	void Showroom::startBenchmark() {
+		restoreInstanceCount = (int)instances.size();
+		benchmarkResults.clear();
+		benchmarkStep = 0;
+		benchmarkFrame = 0;
+		cpuMsSum = gpuMsSum = 0.0;
+		cpuSamples = gpuSamples = 0;
+		layout(benchmarkCounts[0]);
+	}
+
+	void Showroom::beginMeasure() {
+		if (!isBenchmarking()) {
+			return;
+		}
+		measureStart = SDL_GetPerformanceCounter();
+		//tag tells step, results of previous step arriving late are dropped
+		timer.begin(benchmarkStep);
+	}
+
+	void Showroom::endMeasure(size_t drawCount) {
+		if (!isBenchmarking()) {
+			return;
+		}
+		timer.end();
+		if (timer.poll() && timer.getTag() == benchmarkStep && benchmarkFrame >= warmupFrames) {
+			gpuMsSum += timer.getMilliseconds();
+			gpuSamples++;
+		}
+		if (benchmarkFrame >= warmupFrames) {
+			cpuMsSum += (SDL_GetPerformanceCounter() - measureStart) * 1000.0 / SDL_GetPerformanceFrequency();
+			cpuSamples++;
+		}
+		if (++benchmarkFrame == benchmarkFrames) {
+			benchmarkResults.push_back({ benchmarkCounts[benchmarkStep], visibleCount, drawCount,
+				cpuSamples ? cpuMsSum / cpuSamples : 0.0, gpuSamples ? gpuMsSum / gpuSamples : -1.0 });
+			finishBenchmarkStep();
+		}
+	}
+
+	void Showroom::finishBenchmarkStep() {
+		benchmarkStep++;
+		benchmarkFrame = 0;
+		cpuMsSum = gpuMsSum = 0.0;
+		cpuSamples = gpuSamples = 0;
+		if (benchmarkStep < benchmarkStepCount) {
+			layout(benchmarkCounts[benchmarkStep]);
+			return;
+		}
+		benchmarkStep = -1;
+		layout(restoreInstanceCount);
+		std::cout << "Showroom benchmark (instances, visible, draws, CPU ms, GPU ms):" << std::endl;
+		for (const auto& result : benchmarkResults) {
+			std::cout << result.instanceCount << ", " << result.visibleCount << ", " << result.drawCount << ", "
+				<< result.cpuMs << ", " << result.gpuMs << std::endl;
+		}
+	}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <SDL.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "model.h"
+#include "RenderQueue.h"
+#include "GLStateCache.h"
+#include "GpuTimer.h"
+
+//many instances of loaded models placed on grid, every instance has its own transform and color override
+//instances of one model are drawn by one instanced draw per mesh, instance data live in shader storage buffer
+class Showroom {
+public:
+    struct BenchmarkResult {
+        int instanceCount;
+        size_t visibleCount;
+        size_t drawCount;
+        double cpuMs;
+        double gpuMs;
+    };
+
+    bool enabled = false;
+    //instances outside all views are not uploaded nor drawn
+    bool cullInstances = true;
+    //how much instance color replaces material color
+    float colorOverrideStrength = 0.5f;
+    float spacing = 2.5f;
+
+    //model matrix scales model into common size, instances are placed around it
+    void addModel(const std::string& path, Model& model, const glm::mat4& modelMatrix);
+    void clearModels();
+    //places instances on square grid around origin, models are taken in turn
+    void layout(int instanceCount);
+    //finds models of this frame, models which are not resident (resolve returns nullptr) are skipped
+    void resolveModels(const std::function<Model*(const std::string&)>& resolve);
+    //culls instances against frustums of all views, uploads visible ones and queues their draws
+    //instances are placed in world space, model matrix of frame uniforms has to be identity
+    void submit(RenderQueue& queue, GLStateCache& state, const glm::mat4& viewMatrix, const std::vector<glm::mat4>& viewProjections);
+    void release();
+
+    //renders every benchmarked instance count for a while and records times
+    void startBenchmark();
+    bool isBenchmarking() const { return benchmarkStep >= 0; }
+    //enclose rendering of showroom, times are recorded only while benchmarking
+    void beginMeasure();
+    void endMeasure(size_t drawCount);
+    const std::vector<BenchmarkResult>& getBenchmarkResults() const { return benchmarkResults; }
+
+    size_t getModelCount() const { return models.size(); }
+    size_t getInstanceCount() const { return instances.size(); }
+    size_t getVisibleCount() const { return visibleCount; }
+
+private:
+    struct ShowroomModel {
+        std::string path;
+        glm::mat4 modelMatrix;
+        //bounding sphere after model matrix
+        glm::vec3 center;
+        float radius;
+        Model* model = nullptr;
+    };
+    struct Instance {
+        int modelIndex;
+        glm::mat4 transform;
+        glm::vec4 color;
+    };
+
+    void finishBenchmarkStep();
+
+    std::vector<ShowroomModel> models;
+    std::vector<Instance> instances;
+    //visible instances grouped by model, as uploaded
+    std::vector<InstanceData> uploaded;
+    std::vector<InstanceData> visible;
+    std::vector<uint32_t> visibleCounts;
+    GLuint instanceBuffer = 0;
+    size_t instanceBufferCapacity = 0;
+    size_t visibleCount = 0;
+
+    GpuTimer timer;
+    int benchmarkStep = -1;
+    int benchmarkFrame = 0;
+    int restoreInstanceCount = 0;
+    Uint64 measureStart = 0;
+    double cpuMsSum = 0.0;
+    double gpuMsSum = 0.0;
+    int cpuSamples = 0;
+    int gpuSamples = 0;
+    std::vector<BenchmarkResult> benchmarkResults;
+};
@@ -0,0 +1,197 @@
+#include "ThumbnailAtlas.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include "OrbitCamera.h"
+
+static const uint32_t thumbnailMagic = 0x424d4854; //"THMB"
+//free pixels around every thumbnail so linear filtering never samples neighbour
+static const int thumbnailPadding = 1;
+static const int thumbnailSamples = 8;
+
+	ThumbnailAtlas::ThumbnailAtlas(const std::string& cacheDirectory, int thumbnailSize, int pageSize)
+		: cacheDirectory(cacheDirectory), thumbnailSize(thumbnailSize), pageSize(pageSize) {
+	}
+
+	bool ThumbnailAtlas::find(uint64_t key, Thumbnail& thumbnail) {
+		auto found = thumbnails.find(key);
+		if (found != thumbnails.end()) {
+			thumbnail = found->second;
+			return true;
+		}
+		if (notCached.count(key)) {
+			return false;
+		}
+
+		std::vector<unsigned char> pixels;
+		int x, y;
+		if (!loadFromDisk(key, pixels) || !allocate(thumbnail, x, y)) {
+			notCached.insert(key);
+			return false;
+		}
+		glTextureSubImage2D(thumbnail.texture, 0, x, y, thumbnailSize, thumbnailSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		thumbnails.emplace(key, thumbnail);
+		return true;
+	}
+
+	bool ThumbnailAtlas::render(uint64_t key, Model& model, const glm::mat4& modelMatrix, const RenderFunction& renderModel) {
+		Thumbnail thumbnail;
+		int x, y;
+		if (!allocate(thumbnail, x, y)) {
+			return false;
+		}
+		if (renderFramebuffer == 0) {
+			createRenderTarget();
+		}
+
+		//same pose as orbit camera after reset
+		OrbitCamera camera(glm::vec3(0, 0, 0), 3, 0, 0, 0);
+		glm::mat4 viewMatrix = camera.getViewMatrix();
+		glm::mat4 projectionMatrix = glm::perspective(glm::radians(45.f), 1.f, 0.1f, 100.f);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, renderFramebuffer);
+		glViewport(0, 0, thumbnailSize, thumbnailSize);
+		glClearColor(0.85, 0.85, 0.85, 1.f);
+		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+		renderModel(model, modelMatrix, viewMatrix, projectionMatrix);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		//resolve multisampled image straight into its place in atlas page
+		glNamedFramebufferTexture(pageFramebuffer, GL_COLOR_ATTACHMENT0, thumbnail.texture, 0);
+		glBlitNamedFramebuffer(renderFramebuffer, pageFramebuffer, 0, 0, thumbnailSize, thumbnailSize, x, y, x + thumbnailSize, y + thumbnailSize, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+		std::vector<unsigned char> pixels((size_t)thumbnailSize * thumbnailSize * 4);
+		glGetTextureSubImage(thumbnail.texture, 0, x, y, 0, thumbnailSize, thumbnailSize, 1, GL_RGBA, GL_UNSIGNED_BYTE, (GLsizei)pixels.size(), pixels.data());
+		saveToDisk(key, pixels);
+
+		thumbnails[key] = thumbnail;
+		notCached.erase(key);
+		return true;
+	}
+
+	void ThumbnailAtlas::release(GLDeletionQueue& deletionQueue) {
+		GLObjectList objects;
+		for (auto& page : pages) {
+			objects.textures.push_back(page->texture);
+		}
+		deletionQueue.enqueue(std::move(objects));
+		pages.clear();
+		thumbnails.clear();
+		notCached.clear();
+
+		//framebuffers and renderbuffers are not shared with other users, they can go right away
+		glDeleteFramebuffers(1, &renderFramebuffer);
+		glDeleteFramebuffers(1, &pageFramebuffer);
+		glDeleteRenderbuffers(1, &colorRenderbuffer);
+		glDeleteRenderbuffers(1, &depthRenderbuffer);
+		renderFramebuffer = pageFramebuffer = colorRenderbuffer = depthRenderbuffer = 0;
+	}
+
+	uint64_t ThumbnailAtlas::hashEntry(const CatalogEntry& entry) {
+		//FNV-1a over path, size and modification time
+		uint64_t hash = 14695981039346656037ull;
+		auto add = [&hash](const void* data, size_t size) {
+			const unsigned char* bytes = (const unsigned char*)data;
+			for (size_t i = 0; i < size; i++) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+		};
+		add(entry.path.data(), entry.path.size());
+		add(&entry.fileSize, sizeof(entry.fileSize));
+		add(&entry.modifiedTime, sizeof(entry.modifiedTime));
+		return hash;
+	}
+
+	bool ThumbnailAtlas::allocate(Thumbnail& thumbnail, int& x, int& y) {
+		int paddedSize = thumbnailSize + 2 * thumbnailPadding;
+		if (paddedSize > pageSize) {
+			return false;
+		}
+		stbrp_rect rect = {};
+		rect.w = paddedSize;
+		rect.h = paddedSize;
+
+		//only last page can have free space, earlier pages were filled before it was created
+		if (pages.empty() || !stbrp_pack_rects(&pages.back()->context, &rect, 1)) {
+			auto page = std::make_unique<Page>();
+			page->nodes.resize(pageSize);
+			stbrp_init_target(&page->context, pageSize, pageSize, page->nodes.data(), (int)page->nodes.size());
+			glCreateTextures(GL_TEXTURE_2D, 1, &page->texture);
+			glTextureStorage2D(page->texture, 1, GL_RGBA8, pageSize, pageSize);
+			glTextureParameteri(page->texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTextureParameteri(page->texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTextureParameteri(page->texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(page->texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			unsigned char clearColor[4] = { 0, 0, 0, 0 };
+			glClearTexImage(page->texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, clearColor);
+			pages.push_back(std::move(page));
+			rect.was_packed = 0;
+			stbrp_pack_rects(&pages.back()->context, &rect, 1);
+		}
+		if (!rect.was_packed) {
+			return false;
+		}
+
+		x = rect.x + thumbnailPadding;
+		y = rect.y + thumbnailPadding;
+		//GL textures start at bottom row while imgui expects top left corner first
+		thumbnail.texture = pages.back()->texture;
+		thumbnail.uv0 = glm::vec2((float)x / pageSize, (float)(y + thumbnailSize) / pageSize);
+		thumbnail.uv1 = glm::vec2((float)(x + thumbnailSize) / pageSize, (float)y / pageSize);
+		return true;
+	}
+
+	void ThumbnailAtlas::createRenderTarget() {
+		glCreateRenderbuffers(1, &colorRenderbuffer);
+		glNamedRenderbufferStorageMultisample(colorRenderbuffer, thumbnailSamples, GL_RGBA8, thumbnailSize, thumbnailSize);
+		glCreateRenderbuffers(1, &depthRenderbuffer);
+		glNamedRenderbufferStorageMultisample(depthRenderbuffer, thumbnailSamples, GL_DEPTH_COMPONENT24, thumbnailSize, thumbnailSize);
+
+		glCreateFramebuffers(1, &renderFramebuffer);
+		glNamedFramebufferRenderbuffer(renderFramebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+		glNamedFramebufferRenderbuffer(renderFramebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+		if (glCheckNamedFramebufferStatus(renderFramebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Thumbnail framebuffer is not complete" << std::endl;
+		}
+		glCreateFramebuffers(1, &pageFramebuffer);
+	}
+
+	std::string ThumbnailAtlas::cachePath(uint64_t key) const {
+		std::ostringstream name;
+		name << cacheDirectory << '/' << std::hex << std::setw(16) << std::setfill('0') << key << ".thumb";
+		return name.str();
+	}
+
+	bool ThumbnailAtlas::loadFromDisk(uint64_t key, std::vector<unsigned char>& pixels) const {
+		std::ifstream file(cachePath(key), std::ios::binary);
+		if (!file.is_open()) {
+			return false;
+		}
+		uint32_t magic = 0, size = 0;
+		file.read((char*)&magic, sizeof(magic));
+		file.read((char*)&size, sizeof(size));
+		if (!file || magic != thumbnailMagic || size != (uint32_t)thumbnailSize) {
+			return false;
+		}
+		pixels.resize((size_t)thumbnailSize * thumbnailSize * 4);
+		file.read((char*)pixels.data(), pixels.size());
+		return (bool)file;
+	}
+
+	void ThumbnailAtlas::saveToDisk(uint64_t key, const std::vector<unsigned char>& pixels) const {
+		std::error_code error;
+		std::filesystem::create_directories(cacheDirectory, error);
+		std::ofstream file(cachePath(key), std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			std::cout << "Failed to write thumbnail cache: " << cachePath(key) << std::endl;
+			return;
+		}
+		uint32_t size = (uint32_t)thumbnailSize;
+		file.write((const char*)&thumbnailMagic, sizeof(thumbnailMagic));
+		file.write((const char*)&size, sizeof(size));
+		file.write((const char*)pixels.data(), pixels.size());
+	}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "imstb_rectpack.h"
+#include "ModelCatalog.h"
+#include "GLDeletionQueue.h"
+
+class Model;
+
+//small prerendered images of catalog models packed into shared atlas textures
+//every thumbnail is rendered only once, pixels are cached on disk under hash of model file
+class ThumbnailAtlas {
+public:
+    struct Thumbnail {
+        GLuint texture;
+        //texture coordinates in imgui convention, top left and bottom right corner
+        glm::vec2 uv0;
+        glm::vec2 uv1;
+    };
+    //draws model with given model, view and projection matrices into currently bound framebuffer
+    using RenderFunction = std::function<void(Model& model, const glm::mat4& modelMatrix, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)>;
+
+    ThumbnailAtlas(const std::string& cacheDirectory, int thumbnailSize = 96, int pageSize = 1024);
+
+    //finds thumbnail in atlas or loads it from disk cache, returns false when it has to be rendered
+    bool find(uint64_t key, Thumbnail& thumbnail);
+    //renders model from fixed orbit pose into atlas and stores pixels in disk cache
+    bool render(uint64_t key, Model& model, const glm::mat4& modelMatrix, const RenderFunction& renderModel);
+    //hands all GL objects over to deletion queue, call before GL context is destroyed
+    void release(GLDeletionQueue& deletionQueue);
+
+    //key of thumbnail, changes whenever model file changes
+    static uint64_t hashEntry(const CatalogEntry& entry);
+
+    int getThumbnailSize() const { return thumbnailSize; }
+    size_t getPageCount() const { return pages.size(); }
+    size_t getThumbnailCount() const { return thumbnails.size(); }
+
+private:
+    struct Page {
+        GLuint texture;
+        stbrp_context context;
+        std::vector<stbrp_node> nodes;
+    };
+
+    //finds free place for one thumbnail, creates new page when all are full
+    bool allocate(Thumbnail& thumbnail, int& x, int& y);
+    void createRenderTarget();
+    std::string cachePath(uint64_t key) const;
+    bool loadFromDisk(uint64_t key, std::vector<unsigned char>& pixels) const;
+    void saveToDisk(uint64_t key, const std::vector<unsigned char>& pixels) const;
+
+    std::string cacheDirectory;
+    int thumbnailSize;
+    int pageSize;
+    //page holds packer context pointing to its own nodes, so pages must not move in memory
+    std::vector<std::unique_ptr<Page>> pages;
+    std::unordered_map<uint64_t, Thumbnail> thumbnails;
+    //keys already looked up on disk without success
+    std::unordered_set<uint64_t> notCached;
+
+    //model is rendered into multisampled target which is resolved directly into atlas page
+    GLuint renderFramebuffer = 0;
+    GLuint colorRenderbuffer = 0;
+    GLuint depthRenderbuffer = 0;
+    GLuint pageFramebuffer = 0;
+};
@@ -0,0 +1,143 @@
+#include "VertexWelding.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <unordered_map>
+
+//normals within about 2.5 degrees are the same, larger angles are hard edges
+static const float normalTolerance = 0.999f;
+static const float attributeTolerance = 0.00001f;
+//worker threads are started only for meshes of at least this many vertices
+static const size_t minParallelVertices = 4096;
+
+static uint64_t cellKey(const glm::ivec3& cell) {
+	//21 bits per axis, wrapping cells only add candidates which fail distance test
+	const uint64_t mask = (1ull << 21) - 1;
+	return ((uint64_t)cell.x & mask) | ((uint64_t)cell.y & mask) << 21 | ((uint64_t)cell.z & mask) << 42;
+}
+
+static bool canWeld(const Vertex& a, const Vertex& b, float tolerance) {
+	if (glm::length(a.Position - b.Position) > tolerance) {
+		return false;
+	}
+	if (glm::any(glm::greaterThan(glm::abs(a.TexCoords - b.TexCoords), glm::vec2(attributeTolerance))) ||
+		glm::any(glm::greaterThan(glm::abs(a.Color - b.Color), glm::vec4(attributeTolerance)))) {
+		return false;
+	}
+	float lengths = glm::length(a.Normal) * glm::length(b.Normal);
+	return lengths == 0.f ? a.Normal == b.Normal : glm::dot(a.Normal, b.Normal) >= normalTolerance * lengths;
+}
+
+WeldResult WeldVertices(Mesh& mesh, float positionTolerance) {
+	WeldResult result;
+	result.verticesBefore = mesh.vertices.size();
+	result.acmrBefore = AverageCacheMissRatio(mesh.indices, mesh.vertices.size());
+
+	float tolerance = positionTolerance * mesh.radius * 2.f;
+	float cellSize = tolerance > 0.f ? tolerance : 1.f;
+	std::vector<Vertex> welded;
+	welded.reserve(mesh.vertices.size());
+	std::vector<unsigned int> remap(mesh.vertices.size());
+	//welded vertices of each cell as linked list through next
+	std::unordered_map<uint64_t, uint32_t> cellHeads;
+	cellHeads.reserve(mesh.vertices.size());
+	std::vector<uint32_t> next;
+	next.reserve(mesh.vertices.size());
+	const uint32_t end = UINT32_MAX;
+
+	for (size_t i = 0; i < mesh.vertices.size(); i++) {
+		const Vertex& vertex = mesh.vertices[i];
+		glm::ivec3 cell = glm::ivec3(glm::floor((vertex.Position - mesh.center) / cellSize));
+		uint32_t found = end;
+		//vertex within tolerance can lie in neighbouring cell
+		for (int z = -1; z <= 1 && found == end; z++) {
+			for (int y = -1; y <= 1 && found == end; y++) {
+				for (int x = -1; x <= 1 && found == end; x++) {
+					auto head = cellHeads.find(cellKey(cell + glm::ivec3(x, y, z)));
+					for (uint32_t candidate = head == cellHeads.end() ? end : head->second; candidate != end; candidate = next[candidate]) {
+						if (canWeld(welded[candidate], vertex, tolerance)) {
+							found = candidate;
+							break;
+						}
+					}
+				}
+			}
+		}
+		if (found == end) {
+			found = (uint32_t)welded.size();
+			welded.push_back(vertex);
+			auto head = cellHeads.emplace(cellKey(cell), end).first;
+			next.push_back(head->second);
+			head->second = found;
+		}
+		remap[i] = found;
+	}
+
+	std::vector<unsigned int> indices;
+	indices.reserve(mesh.indices.size());
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		unsigned int a = remap[mesh.indices[i]], b = remap[mesh.indices[i + 1]], c = remap[mesh.indices[i + 2]];
+		if (a == b || b == c || a == c) {
+			result.collapsedTriangles++;
+			continue;
+		}
+		indices.push_back(a);
+		indices.push_back(b);
+		indices.push_back(c);
+	}
+	mesh.vertices = std::move(welded);
+	mesh.indices = std::move(indices);
+	result.verticesAfter = mesh.vertices.size();
+	result.acmrAfter = AverageCacheMissRatio(mesh.indices, mesh.vertices.size());
+	return result;
+}
+
+std::vector<WeldResult> WeldMeshes(const std::vector<Mesh*>& meshes, float positionTolerance) {
+	std::vector<WeldResult> results(meshes.size());
+	//largest meshes first, so one big mesh does not finish last on single thread
+	std::vector<size_t> order(meshes.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&meshes](size_t a, size_t b) { return meshes[a]->vertices.size() > meshes[b]->vertices.size(); });
+
+	std::atomic<size_t> next{ 0 };
+	auto worker = [&]() {
+		for (size_t i = next++; i < order.size(); i = next++) {
+			results[order[i]] = WeldVertices(*meshes[order[i]], positionTolerance);
+		}
+	};
+	size_t parallelMeshes = 0;
+	while (parallelMeshes < order.size() && meshes[order[parallelMeshes]]->vertices.size() >= minParallelVertices) {
+		parallelMeshes++;
+	}
+	unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = (unsigned int)std::min<size_t>(threadCount, parallelMeshes);
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < threadCount; i++) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : workers) {
+		thread.join();
+	}
+	return results;
+}
+
+float AverageCacheMissRatio(const std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize) {
+	if (indices.size() < 3) {
+		return 0.f;
+	}
+	//vertex is in FIFO cache while fewer than cacheSize misses happened since it was loaded
+	std::vector<size_t> loadedAt(vertexCount, SIZE_MAX);
+	size_t misses = 0;
+	for (unsigned int index : indices) {
+		if (loadedAt[index] == SIZE_MAX || misses - loadedAt[index] >= (size_t)cacheSize) {
+			loadedAt[index] = misses;
+			misses++;
+		}
+	}
+	return (float)misses / (indices.size() / 3);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "mesh.h"
+
+//vertex counts and post-transform cache efficiency of one mesh before and after welding
+struct WeldResult {
+    size_t verticesBefore = 0;
+    size_t verticesAfter = 0;
+    size_t collapsedTriangles = 0;
+    //average cache miss ratio, vertices transformed per triangle
+    float acmrBefore = 0.f;
+    float acmrAfter = 0.f;
+};
+
+//merges vertices closer than positionTolerance (fraction of mesh bounds diagonal) which also share normal, texture coordinates and color,
+//so hard edges and texture seams keep their own vertices, candidates are found through spatial hash of tolerance sized cells
+//indices are rebuilt to shared vertices in order of first use and triangles collapsed by welding are dropped
+WeldResult WeldVertices(Mesh& mesh, float positionTolerance = 0.00001f);
+//welds meshes on all hardware threads, largest first, results are in order of meshes
+//has to run before meshes are uploaded
+std::vector<WeldResult> WeldMeshes(const std::vector<Mesh*>& meshes, float positionTolerance = 0.00001f);
+//vertices transformed per triangle by FIFO post-transform cache of given size, 3 for unindexed mesh, about 0.5 at best
+float AverageCacheMissRatio(const std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize = 32);
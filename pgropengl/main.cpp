@@ -3,10 +3,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
-
-//stb image for loading textures in files
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include <future>
 
 //3rd party libs
 #include <SDL.h>
@@ -19,7 +16,7 @@
 #include "imgui.h"
 #include "imgui_impl_sdl2.h"
 #include "imgui_impl_opengl3.h"
-#include <assimp/Importer.hpp>W
+#include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
@@ -27,6 +24,26 @@
 #include "FreeLookCamera.h"
 #include "OrbitCamera.h"
 #include "model.h"
+#include "ModelResidency.h"
+#include "ModelCatalog.h"
+#include "ModelBrowser.h"
+#include "ThumbnailAtlas.h"
+#include "GLDeletionQueue.h"
+#include "ModelPrefetcher.h"
+#include "ModelProxy.h"
+#include "ShaderPermutations.h"
+#include "GLStateCache.h"
+#include "RenderQueue.h"
+#include "DepthPrepass.h"
+#include "FramePacer.h"
+#include "AccumulationBuffer.h"
+#include "DynamicResolution.h"
+#include "AntiAliasing.h"
+#include "Showroom.h"
+#include "ImportProfiles.h"
+#include "OctreeBuilder.h"
+#include "OctreeRenderer.h"
+#include <cstring>
 
 
 //globals
@@ -35,7 +52,33 @@ int gScreenWidth = 1366;
 int gScreenHeight = 768;
 SDL_Window* gWindow = nullptr;
 SDL_GLContext gOpenGLContext = nullptr;
-GLuint gPipelineProgram = 0;
+//specialized programs for mesh materials and selected lighting model
+ShaderPermutations gShaders("shaders/modelVS.glsl", "shaders/modelFS.glsl", "shaders/modelGS.glsl", "shaders/.cache");
+int gLightingModel = LightingPhong;
+//all model rendering goes through it so redundant state changes are skipped
+GLStateCache gState;
+//draws of main view and of thumbnails are sorted separately, so main view can reuse its order between frames
+RenderQueue gRenderQueue;
+RenderQueue gThumbnailQueue;
+//optional depth only pass before shading main view, auto mode keeps whichever is faster on GPU
+DepthPrepass gDepthPrepass;
+int gDepthPrepassMode = DepthPrepass::Auto;
+bool gCompactPositions = false;
+//main loop renders only when something changes, frames are capped
+FramePacer gFramePacer;
+int gVSyncMode = FramePacer::VSyncOn;
+//still image is refined by averaging jittered frames
+AccumulationBuffer gAccumulation;
+//moving view is rendered at lower resolution when GPU cannot keep target frame time
+DynamicResolution gDynamicResolution;
+//post-process or multisampled anti-aliasing of scene, gui is drawn afterwards without it
+AntiAliasing gAntiAliasing;
+int gAntiAliasingMode = AntiAliasing::Fxaa;
+//front, side, top and camera view rendered at once by instanced draws into viewport array
+bool gQuadView = false;
+//grid of many model instances drawn with instanced draws instead of single model
+Showroom gShowroom;
+int gShowroomInstances = 100;
 
 //input handling helpers
 bool lMouseDown = false;
@@ -54,8 +97,44 @@ enum projectionMode {Perspective, Orthographic};
 projectionMode g_currentProjectionMode = Perspective;
 
 //models
-enum modelsEnum {Octavia, GolfMk1, GolfMk5, AudiA4, MercedesV8};
-modelsEnum g_currentModel = GolfMk1;
+std::string g_currentModelPath = "models/golfmk1_obj/model.obj";
+//rotation around y axis for models exported facing other direction than the rest
+std::map<std::string, float> gModelRotationsY = { {"models/golfmk5_gti/model.obj", 180.f} };
+//memory budget for resident models in megabytes
+int gGpuBudgetMB = 1024;
+int gCpuBudgetMB = 2048;
+bool gShowThumbnails = true;
+bool gPrefetchEnabled = true;
+//selected model is streamed in, coarse proxy stored here is shown until it is complete
+std::string gProxyDirectory = "models/.proxies";
+int gStreamingUploadMB = 8;
+int gAtlasMaxTextureSize = Model::atlasMaxTextureSize;
+bool gPreserveHierarchy = Model::preserveHierarchy;
+bool gDeduplicateMeshes = Model::deduplicateMeshes;
+bool gWeldVertices = Model::weldVertices;
+bool gNativeObjLoader = Model::nativeObjLoader;
+bool gNativeGltfLoader = Model::nativeGltfLoader;
+bool gStreamScans = Model::streamScans;
+int gScanChunkMB = Model::scanChunkMB;
+//models with octree built here are drawn from it node by node instead of being loaded whole
+std::string gOctreeDirectory = "models/.octrees";
+bool gOutOfCore = false;
+int gOctreeBudgetMB = 256;
+float gOctreePixelError = 2.f;
+int gOctreeNodeTriangles = 65536;
+//octree build running in background, result of last finished one
+std::future<OctreeBuildResult> gOctreeBuild;
+OctreeBuildResult gOctreeBuildResult;
+std::string gOctreeBuildPath;
+//obj import comparison running in background, result of last finished one
+std::future<ObjBenchmarkResult> gObjBenchmark;
+ObjBenchmarkResult gObjBenchmarkResult;
+//assimp flags by file extension, loaded from file next to shaders
+ImportProfiles gImportProfiles;
+const char* gImportProfilesPath = "importProfiles.ini";
+MappedFileCache gFileCache;
+//time of program start, used for time to first frame
+Uint64 gStartCounter = 0;
 
 //other GUI globals
 glm::vec3 lightPosition(3.f, 3.0f, 0.5f);
@@ -63,20 +142,6 @@ glm::vec3 lightColor(1.0f, 1.0f, 1.0f);
 
 
 
-std::string loadShaderFile(const std::string& fileName) {
-	std::ifstream file(fileName);
-	if (!file.is_open()) {
-		std::cout << "Failed to open file: " << fileName << std::endl;
-		exit(1);
-	}
-	std::string line;
-	std::string output;
-	while (std::getline(file, line)) {
-		output += line + "\n";
-	}
-	return output;
-}
-
 void Init() {
 	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
 		std::cout << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
@@ -108,32 +173,9 @@ void Init() {
 
 }
 
-GLuint CompileShader(GLuint type, const std::string& src) {
-	GLuint shader;
-	if (type == GL_VERTEX_SHADER || type == GL_FRAGMENT_SHADER) {
-		shader = glCreateShader(type);
-	}
-	else {
-		std::cout << "Invalid shader type" << std::endl;
-		return 0;
-	}
-	const char* srcPtr = src.c_str();
-	glShaderSource(shader, 1, &srcPtr, nullptr);
-	glCompileShader(shader);
-	return shader;
-}
-
 void CreatePipelineProgram() {
-
-	std::string vsSrc = loadShaderFile("shaders/modelVS.glsl");
-	std::string fsSrc = loadShaderFile("shaders/modelFS.glsl");
-	gPipelineProgram = glCreateProgram();
-	GLuint vs = CompileShader(GL_VERTEX_SHADER, vsSrc);
-	GLuint fs = CompileShader(GL_FRAGMENT_SHADER, fsSrc);
-	glAttachShader(gPipelineProgram, vs);
-	glAttachShader(gPipelineProgram, fs);
-	glLinkProgram(gPipelineProgram);
-	glValidateProgram(gPipelineProgram);
+	//all permutations are compiled up front, in parallel when driver allows it
+	gShaders.compileAll();
 }
 
 void HandleInput() {
@@ -224,17 +266,67 @@ void HandleInput() {
 		const Uint8* state = SDL_GetKeyboardState(NULL);
 	}
 }
-void Draw(Model &model, glm::mat4 &modelMatrix) {
+//sets transformation and light uniforms shared by all shader permutations
+void SetupModelPipeline(const glm::mat4& modelMatrix, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix) {
+	FrameUniforms uniforms;
+	uniforms.modelMatrix = modelMatrix;
+	uniforms.viewMatrix = viewMatrix;
+	uniforms.projectionMatrix = projectionMatrix;
+	uniforms.lightPosition = glm::vec4(lightPosition, 1.f);
+	uniforms.lightColor = glm::vec4(lightColor, 1.f);
+	gShaders.setFrameUniforms(gState, uniforms);
+}
+
+//draws model into currently bound framebuffer, used for main view and offscreen thumbnails
+void DrawModel(Model& model, const glm::mat4& modelMatrix, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix) {
+	SetupModelPipeline(modelMatrix, viewMatrix, projectionMatrix);
+	gThumbnailQueue.clear();
+	model.submit(gThumbnailQueue, viewMatrix * modelMatrix);
+	gThumbnailQueue.sort();
+	gThumbnailQueue.execute(gState, gShaders);
+}
+
+//model can be missing while it is being imported, proxy is drawn instead of its meshes not on GPU yet
+void Draw(Model* model, Model* proxy, glm::mat4 &modelMatrix, OctreeRenderer* octree = nullptr) {
+	//framebuffer receiving image of native resolution
+	GLuint outputFramebuffer = 0;
+	if (gAccumulation.enabled) {
+		gAccumulation.resize(gScreenWidth, gScreenHeight);
+	}
+	//resize turns refinement off when its shader is broken
+	if (gAccumulation.enabled) {
+		//converged image only needs to be shown again, e.g. under changed gui
+		if (gAccumulation.isConverged()) {
+			gAccumulation.present();
+			return;
+		}
+		outputFramebuffer = gAccumulation.getSampleFramebuffer();
+	}
+	//still image being refined is always rendered at native resolution
+	bool scaled = gDynamicResolution.enabled && !(gAccumulation.enabled && gAccumulation.getSampleCount() > 0);
+	int renderWidth = gScreenWidth;
+	int renderHeight = gScreenHeight;
+	GLuint sceneFramebuffer = outputFramebuffer;
+	if (scaled) {
+		gDynamicResolution.resize(gScreenWidth, gScreenHeight);
+		scaled = gDynamicResolution.enabled;
+	}
+	if (scaled) {
+		gDynamicResolution.beginScene();
+		renderWidth = gDynamicResolution.getRenderWidth();
+		renderHeight = gDynamicResolution.getRenderHeight();
+		sceneFramebuffer = gDynamicResolution.getFramebuffer();
+	}
+	//anti-aliasing works at render resolution, before upscaling
+	gAntiAliasing.resize(gScreenWidth, gScreenHeight);
+	gAntiAliasing.beginScene(sceneFramebuffer, renderWidth, renderHeight);
 
-	glEnable(GL_DEPTH_TEST);
-	glViewport(0, 0, gScreenWidth, gScreenHeight);
+	//depth writes have to be enabled for clear to reach depth buffer
+	gState.depthMask(true);
+	glViewport(0, 0, renderWidth, renderHeight);
 	glClearColor(0.85, 0.85, 0.85, 1.f);
 	glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glUseProgram(gPipelineProgram);
-
 	glm::mat4 viewMatrix;
 	if (g_currentCameraMode == FreeLook) {
 		viewMatrix = freeLookCamera.getViewMatrix();
@@ -247,44 +339,109 @@ void Draw(Model &model, glm::mat4 &modelMatrix) {
 	float aspectRatio = (float)gScreenWidth / (float)gScreenHeight;
 	glm::mat4 orthographicMatrix = glm::ortho(-2.f, 2.f, -2.f / aspectRatio,2.f / aspectRatio, 0.1f, 100.f);
 	glm::mat4 projectionMatrix = g_currentProjectionMode == Perspective ? perspectiveMatrix : orthographicMatrix;
+	if (gAccumulation.enabled) {
+		projectionMatrix = gAccumulation.jitterProjection(projectionMatrix);
+	}
 
-	glUniformMatrix4fv(glGetUniformLocation(gPipelineProgram, "modelMatrix"),1,GL_FALSE,&modelMatrix[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(gPipelineProgram, "viewMatrix"), 1, GL_FALSE, &viewMatrix[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(gPipelineProgram, "projectionMatrix"), 1, GL_FALSE, &projectionMatrix[0][0]);
-	glUniform3fv(glGetUniformLocation(gPipelineProgram, "lightPos"), 1, &lightPosition[0]);
-	glUniform3fv(glGetUniformLocation(gPipelineProgram, "lightColor"), 1, &lightColor[0]);
-	model.Draw(gPipelineProgram);
-}
-
-glm::mat4 computeModelMatrix(Model& model) {
-
-	float minx = 0;
-	float miny = 0;
-	float minz = 0;
-	float maxx = 0;
-	float maxy = 0;
-	float maxz = 0;
-	for (const auto& mesh : model.opaqueMeshes) {
-		for (const auto& vertex : mesh.vertices) {
-			minx = std::min(minx, vertex.Position.x);
-			miny = std::min(miny, vertex.Position.y);
-			minz = std::min(minz, vertex.Position.z);
-			maxx = std::max(maxx, vertex.Position.x);
-			maxy = std::max(maxy, vertex.Position.y);
-			maxz = std::max(maxz, vertex.Position.z);
+	//showroom instances carry their whole transform
+	SetupModelPipeline(gShowroom.enabled ? glm::mat4(1.f) : modelMatrix, viewMatrix, projectionMatrix);
+
+	//culling is shared by all views, mesh is queued once when any view sees it
+	int viewCount = gQuadView ? MultiViewCount : 1;
+	std::vector<glm::mat4> viewProjections;
+	if (gQuadView) {
+		MultiViewUniforms views;
+		//model is scaled into 2 units around origin, fixed views look at it from outside
+		glm::mat4 fixedProjection = glm::ortho(-1.2f, 1.2f, -1.2f / aspectRatio, 1.2f / aspectRatio, 0.1f, 100.f);
+		views.viewMatrices[0] = glm::lookAt(glm::vec3(0, 0, 5), glm::vec3(0), glm::vec3(0, 1, 0));
+		views.viewMatrices[1] = glm::lookAt(glm::vec3(5, 0, 0), glm::vec3(0), glm::vec3(0, 1, 0));
+		views.viewMatrices[2] = glm::lookAt(glm::vec3(0, 5, 0), glm::vec3(0), glm::vec3(0, 0, -1));
+		views.viewMatrices[3] = viewMatrix;
+		for (int i = 0; i < 3; i++) {
+			views.projectionMatrices[i] = gAccumulation.enabled ? gAccumulation.jitterProjection(fixedProjection) : fixedProjection;
 		}
+		views.projectionMatrices[3] = projectionMatrix;
+		gShaders.setMultiViewUniforms(gState, views);
+		for (int i = 0; i < MultiViewCount; i++) {
+			viewProjections.push_back(views.projectionMatrices[i] * views.viewMatrices[i]);
+		}
+
+		//front and side on top, top view and camera view below
+		float halfWidth = renderWidth * 0.5f;
+		float halfHeight = renderHeight * 0.5f;
+		glViewportIndexedf(0, 0.f, halfHeight, halfWidth, halfHeight);
+		glViewportIndexedf(1, halfWidth, halfHeight, halfWidth, halfHeight);
+		glViewportIndexedf(2, 0.f, 0.f, halfWidth, halfHeight);
+		glViewportIndexedf(3, halfWidth, 0.f, halfWidth, halfHeight);
+	}
+	else {
+		viewProjections.push_back(projectionMatrix * viewMatrix);
+	}
+	std::vector<glm::mat4> cullMatrices;
+	for (const glm::mat4& viewProjection : viewProjections) {
+		cullMatrices.push_back(viewProjection * modelMatrix);
 	}
+	gRenderQueue.setCullMatrices(cullMatrices);
 
-	for (const auto& mesh : model.transparentMeshes) {
-		for (const auto& vertex : mesh.vertices) {
-			minx = std::min(minx, vertex.Position.x);
-			miny = std::min(miny, vertex.Position.y);
-			minz = std::min(minz, vertex.Position.z);
-			maxx = std::max(maxx, vertex.Position.x);
-			maxy = std::max(maxy, vertex.Position.y);
-			maxz = std::max(maxz, vertex.Position.z);
+	gRenderQueue.clear();
+	if (gShowroom.enabled) {
+		//showroom culls its instances itself
+		gShowroom.beginMeasure();
+		gShowroom.submit(gRenderQueue, gState, viewMatrix, viewProjections);
+	}
+	else if (octree) {
+		//nodes are selected by view of active camera, jitter of accumulation does not change them
+		const Camera& camera = g_currentCameraMode == FreeLook ? (const Camera&)freeLookCamera : (const Camera&)orbitCamera;
+		octree->update(camera, modelMatrix, g_currentProjectionMode == Perspective ? perspectiveMatrix : orthographicMatrix, gScreenHeight);
+		octree->submit(gRenderQueue, viewMatrix * modelMatrix);
+	}
+	else if (model) {
+		model->submit(gRenderQueue, viewMatrix * modelMatrix, proxy);
+	}
+	else if (proxy) {
+		proxy->submit(gRenderQueue, viewMatrix * modelMatrix);
+	}
+	gRenderQueue.sort();
+	//depth pre-pass is used and measured only with single view
+	bool prepass = false;
+	if (viewCount == 1) {
+		prepass = gDepthPrepass.beginFrame();
+		if (prepass) {
+			gDepthPrepass.beginPrepass();
+			gRenderQueue.executeDepthPrepass(gState, gShaders);
+			gDepthPrepass.endPrepass();
 		}
+		gDepthPrepass.beginColorPass();
+	}
+	gRenderQueue.execute(gState, gShaders, prepass, viewCount);
+	if (viewCount == 1) {
+		gDepthPrepass.endColorPass();
+		gDepthPrepass.endFrame();
 	}
+	if (gShowroom.enabled) {
+		gShowroom.endMeasure(gRenderQueue.getItemCount());
+	}
+	gAntiAliasing.endScene(gState);
+
+	if (scaled) {
+		gDynamicResolution.endScene(gState, outputFramebuffer);
+	}
+	if (gAccumulation.enabled) {
+		gAccumulation.accumulate(gState);
+		gAccumulation.present();
+	}
+}
+
+//model bounds, proxy stores the same bounds so matrix does not change when full model replaces it
+glm::mat4 computeModelMatrix(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+
+	//bounds always include origin
+	float minx = std::min(0.f, boundsMin.x);
+	float miny = std::min(0.f, boundsMin.y);
+	float minz = std::min(0.f, boundsMin.z);
+	float maxx = std::max(0.f, boundsMax.x);
+	float maxy = std::max(0.f, boundsMax.y);
+	float maxz = std::max(0.f, boundsMax.z);
 
 
 	float extentX = maxx - minx;
@@ -303,6 +460,21 @@ glm::mat4 computeModelMatrix(Model& model) {
 	return modelMatrix;
 }
 
+//model matrix including fixed rotation of models exported facing other direction
+glm::mat4 computeOrientedModelMatrix(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const std::string& path) {
+	glm::mat4 modelMatrix = computeModelMatrix(boundsMin, boundsMax);
+	auto rotation = gModelRotationsY.find(path);
+	if (rotation != gModelRotationsY.end()) {
+		modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation->second), glm::vec3(0, 1, 0));
+	}
+	return modelMatrix;
+}
+
+glm::mat4 computeOrientedModelMatrix(Model& model, const std::string& path) {
+	glm::vec3 boundsMin, boundsMax;
+	model.getBounds(boundsMin, boundsMax);
+	return computeOrientedModelMatrix(boundsMin, boundsMax, path);
+}
 
 void MainLoop() {
 	SDL_WarpMouseInWindow(gWindow, gScreenWidth / 2, gScreenHeight / 2);
@@ -313,21 +485,185 @@ void MainLoop() {
 	ImGui_ImplSDL2_InitForOpenGL(gWindow, gOpenGLContext);
 	ImGui_ImplOpenGL3_Init("#version 460");
 	
-	std::map<modelsEnum, std::string> modelPaths;
-	std::map<modelsEnum, Model*> models;
-
-	modelPaths.emplace(Octavia, "models/skoda_octavia/scene.gltf");
-	modelPaths.emplace(GolfMk1, "models/golfmk1_obj/model.obj");
-	modelPaths.emplace(GolfMk5, "models/golfmk5_gti/model.obj");
-	modelPaths.emplace(AudiA4, "models/audia4/model.obj");
-	modelPaths.emplace(MercedesV8, "models/mercedesv8/scene.gltf");
+	//before any loader thread starts, built-in profiles stay when file is missing
+	gImportProfiles.load(gImportProfilesPath);
+	Model::importProfiles = &gImportProfiles;
+	Model::fileCache = &gFileCache;
+
+	GLDeletionQueue deletionQueue;
+	ModelResidency residency(deletionQueue, (size_t)gGpuBudgetMB << 20, (size_t)gCpuBudgetMB << 20);
+	ModelCatalog catalog("models", "models/catalog.index");
+	ModelBrowser browser;
+	ThumbnailAtlas thumbnails("models/.thumbnails");
+	ModelPrefetcher prefetcher(deletionQueue, 4, (size_t)512 << 20);
+	catalog.startScan();
+
+	Model* currentModel = nullptr;
+	glm::mat4 modelMatrix(1.f);
+
+	//model being streamed in - imported on loader thread, then uploaded in slices while proxy fills in missing meshes
+	std::string streamingPath;
+	std::unique_ptr<ModelProxy> streamingProxy;
+	std::future<std::unique_ptr<Model>> streamingLoad;
+	std::unique_ptr<Model> streamingModel;
+	Uint64 streamingStart = 0;
+	//imports of models deselected before they finished, dropped once done
+	std::vector<std::future<std::unique_ptr<Model>>> abandonedLoads;
+	float timeToFirstFrameMs = 0.f;
+	float timeToFullDetailMs = 0.f;
+	//model of missing thumbnail imported on loader thread and uploaded in slices, rendered into atlas once complete
+	std::future<std::unique_ptr<Model>> thumbnailLoad;
+	std::unique_ptr<Model> thumbnailModel;
+	CatalogEntry thumbnailEntry;
+	//model drawn from its octree, replaces streaming while out-of-core drawing is enabled
+	std::unique_ptr<OctreeRenderer> octree;
+
+	auto cancelStreaming = [&]() {
+		octree.reset();
+		if (streamingLoad.valid()) {
+			abandonedLoads.push_back(std::move(streamingLoad));
+		}
+		if (streamingModel) {
+			GLObjectList objects;
+			streamingModel->releaseGLObjects(objects);
+			deletionQueue.enqueue(std::move(objects));
+			streamingModel.reset();
+		}
+		if (streamingProxy) {
+			streamingProxy->release(deletionQueue);
+			streamingProxy.reset();
+		}
+		streamingPath.clear();
+	};
+	auto startStreaming = [&](const std::string& path) {
+		cancelStreaming();
+		currentModel = nullptr;
+		if (gOutOfCore) {
+			octree = OctreeRenderer::open(gOctreeDirectory, path, deletionQueue);
+			if (octree) {
+				octree->setBudget((size_t)gOctreeBudgetMB << 20);
+				octree->setPixelError(gOctreePixelError);
+				modelMatrix = computeOrientedModelMatrix(octree->boundsMin, octree->boundsMax, path);
+				return;
+			}
+		}
+		streamingPath = path;
+		streamingStart = SDL_GetPerformanceCounter();
+		streamingProxy = ModelProxy::load(gProxyDirectory, path);
+		if (streamingProxy) {
+			modelMatrix = computeOrientedModelMatrix(streamingProxy->boundsMin, streamingProxy->boundsMax, path);
+		}
+		//proxy is built from imported data on first load, so next start of the model is instant
+		bool buildProxy = !streamingProxy;
+		streamingLoad = std::async(std::launch::async, [path, buildProxy]() {
+			auto model = std::make_unique<Model>(path, false);
+			if (buildProxy) {
+				ModelProxy::build(gProxyDirectory, path, *model);
+			}
+			return model;
+		});
+	};
 
-	models.emplace(GolfMk1, new Model(modelPaths.find(GolfMk1)->second));
+	startStreaming(g_currentModelPath);
 
-	modelsEnum prevModel = g_currentModel;
-	glm::mat4 modelMatrix = computeModelMatrix(*models.find(GolfMk1)->second);
+	gFramePacer.setVSync((FramePacer::VSync)gVSyncMode);
+	float frameTimeMs = 0.f;
+	bool firstFrame = true;
 
 	while (!gQuit) {
+		//sleeps while nothing has to be drawn, work not visible on screen only shortens the sleep
+		gFramePacer.waitForWork(prefetcher.getQueuedCount() > 0 || deletionQueue.getPendingCount() > 0);
+		//time spent sleeping is not counted, so idle loop does not pause prefetching
+		frameTimeMs = gFramePacer.getFrameTimeMs();
+
+		//free objects of evicted models the GPU no longer uses, their names can be reused so cached bindings are dropped
+		if (deletionQueue.collect()) {
+			gState.invalidate();
+		}
+		gShaders.update();
+		//prefetching works only while frames are fast enough
+		prefetcher.update(frameTimeMs);
+		if (catalog.pollScanResults()) {
+			browser.invalidate();
+		}
+
+		abandonedLoads.erase(std::remove_if(abandonedLoads.begin(), abandonedLoads.end(), [](std::future<std::unique_ptr<Model>>& load) {
+			return load.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		}), abandonedLoads.end());
+		if (streamingLoad.valid() && streamingLoad.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			streamingModel = streamingLoad.get();
+			modelMatrix = computeOrientedModelMatrix(*streamingModel, streamingPath);
+		}
+		//full model replaces proxy mesh by mesh, once complete it is handed to residency
+		bool scanStreaming = streamingModel && streamingModel->isStreamingScan();
+		bool streamingComplete = streamingModel && streamingModel->uploadStep((size_t)gStreamingUploadMB << 20);
+		if (scanStreaming) {
+			//bounds of streamed scan grow with every chunk
+			modelMatrix = computeOrientedModelMatrix(*streamingModel, streamingPath);
+		}
+		if (streamingComplete) {
+			timeToFullDetailMs = (SDL_GetPerformanceCounter() - streamingStart) * 1000.f / SDL_GetPerformanceFrequency();
+			std::cout << "Model " << streamingPath << " in full detail after " << timeToFullDetailMs << " ms" << std::endl;
+			currentModel = residency.adopt(streamingPath, std::move(streamingModel));
+			cancelStreaming();
+		}
+
+		//visible work in progress keeps rendering, free look moves camera while keys are held
+		if (!streamingPath.empty() || (octree && octree->isLoading()) || catalog.isScanning() || gFreeLookMode || gShaders.getReadyCount() < gShaders.getProgramCount()
+			|| (gShowThumbnails && !browser.getMissingThumbnails().empty()) || thumbnailLoad.valid() || thumbnailModel) {
+			gFramePacer.requestRedraw();
+		}
+		//state changed other way than by input, e.g. model finished loading
+		struct WatchedState {
+			glm::mat4 viewMatrix[2];
+			glm::mat4 modelMatrix;
+			glm::vec3 lightPosition;
+			glm::vec3 lightColor;
+			Model* model;
+			int cameraMode;
+			int projectionMode;
+			int lightingModel;
+			int antiAliasingMode;
+			int quadView;
+			int showroomEnabled;
+			int showroomModels;
+			int showroomInstances;
+			float showroomColor;
+			float octreePixelError;
+			int octreeBudgetMB;
+		} watched;
+		//padding has to be zero, whole struct is hashed
+		std::memset(&watched, 0, sizeof(watched));
+		watched.viewMatrix[0] = freeLookCamera.getViewMatrix();
+		watched.viewMatrix[1] = orbitCamera.getViewMatrix();
+		watched.modelMatrix = modelMatrix;
+		watched.lightPosition = lightPosition;
+		watched.lightColor = lightColor;
+		watched.model = currentModel;
+		watched.cameraMode = g_currentCameraMode;
+		watched.projectionMode = g_currentProjectionMode;
+		watched.lightingModel = gLightingModel;
+		watched.antiAliasingMode = gAntiAliasingMode;
+		watched.quadView = gQuadView;
+		watched.showroomEnabled = gShowroom.enabled;
+		watched.showroomModels = (int)gShowroom.getModelCount();
+		watched.showroomInstances = (int)gShowroom.getInstanceCount();
+		watched.showroomColor = gShowroom.colorOverrideStrength;
+		watched.octreePixelError = gOctreePixelError;
+		watched.octreeBudgetMB = gOctreeBudgetMB;
+		//any change starts averaging again, streamed model changes every frame until complete
+		//anti-aliasing benchmark has to render every frame in full
+		bool benchmarking = gAntiAliasing.isBenchmarking() || gShowroom.isBenchmarking();
+		if (gFramePacer.watch(&watched, sizeof(watched)) || !streamingPath.empty() || (octree && octree->isLoading()) || benchmarking) {
+			gAccumulation.reset();
+		}
+		if ((gAccumulation.enabled && !gAccumulation.isConverged()) || benchmarking) {
+			gFramePacer.requestRedraw(1);
+		}
+		if (!gFramePacer.beginFrame()) {
+			continue;
+		}
+
 		SDL_SetRelativeMouseMode(gFreeLookMode);
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplSDL2_NewFrame(gWindow);
@@ -341,33 +677,163 @@ void MainLoop() {
 			);
 			ImGui::Begin("Settings");
 			ImGui::Text("Model");
-			ImGui::Combo("Model", (int*)&g_currentModel, "Skoda Octavia\0Volkswagen Golf Mk1\0Volkswagen Golf Mk5\0Audi A4\0Mercedes V8 Biturbo\0\0");
-
-			if(prevModel != g_currentModel){
-				prevModel = g_currentModel;
-				//load model if not loaded
-				if (models.find(g_currentModel) == models.end()) {
-					ImGui::Text("Loading model...");
-					ImGui::End();
-					ImGui::Render();
-					ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-					SDL_GL_SwapWindow(gWindow);
-					models.emplace(g_currentModel, new Model(modelPaths.find(g_currentModel)->second));
-					modelMatrix = computeModelMatrix(*models.find(g_currentModel)->second);
-					if (g_currentModel == GolfMk5) {
-						//golf mk5 is rotated 180 degrees
-						modelMatrix = glm::rotate(modelMatrix, glm::radians(180.f), glm::vec3(0, 1, 0));
+			ImGui::Checkbox("Thumbnails", &gShowThumbnails);
+			if (ImGui::SliderInt("Atlas textures up to", &gAtlasMaxTextureSize, 0, 1024)) {
+				//applies to models loaded afterwards, 0 keeps every texture separate
+				Model::atlasMaxTextureSize = gAtlasMaxTextureSize;
+			}
+			if (ImGui::Checkbox("Keep node hierarchy", &gPreserveHierarchy)) {
+				//applies to models loaded afterwards, shared meshes are stored once instead of pretransformed copies
+				Model::preserveHierarchy = gPreserveHierarchy;
+			}
+			if (ImGui::Checkbox("Instance repeated meshes", &gDeduplicateMeshes)) {
+				//applies to models loaded afterwards, copies of mesh moved, rotated or scaled share its buffers
+				Model::deduplicateMeshes = gDeduplicateMeshes;
+			}
+			if (ImGui::Checkbox("Weld vertices", &gWeldVertices)) {
+				//applies to models loaded afterwards, corners sharing position, normal, texture coordinates and color become one vertex
+				Model::weldVertices = gWeldVertices;
+			}
+			if (ImGui::Checkbox("Native OBJ loader", &gNativeObjLoader)) {
+				//applies to models loaded afterwards, obj files are parsed on all threads instead of by assimp
+				Model::nativeObjLoader = gNativeObjLoader;
+			}
+			if (IsObjPath(g_currentModelPath)) {
+				ImGui::SameLine();
+				bool benchmarking = gObjBenchmark.valid();
+				if (ImGui::Button(benchmarking ? "Benchmarking..." : "Benchmark") && !benchmarking) {
+					std::string path = g_currentModelPath;
+					gObjBenchmark = std::async(std::launch::async, [path]() { return BenchmarkObjLoader(path); });
+				}
+			}
+			if (ImGui::Checkbox("Native glTF loader", &gNativeGltfLoader)) {
+				//applies to models loaded afterwards, buffer data is uploaded as stored, unsupported files still go to assimp
+				Model::nativeGltfLoader = gNativeGltfLoader;
+			}
+			if (ImGui::Checkbox("Stream PLY/STL scans", &gStreamScans)) {
+				//applies to models loaded afterwards, binary files are parsed in chunks uploaded while later ones are parsed
+				Model::streamScans = gStreamScans;
+			}
+			if (ImGui::SliderInt("Scan chunk MB", &gScanChunkMB, 1, 64)) {
+				Model::scanChunkMB = gScanChunkMB;
+			}
+			Model* scanModel = streamingModel ? streamingModel.get() : currentModel;
+			ScanStreamStats scanStats = scanModel ? scanModel->getScanStats() : ScanStreamStats();
+			if (scanStats.chunks > 0) {
+				ImGui::Text("Scan %.1f / %.1f MB parsed, %zu chunks, %.2f M triangles", scanStats.parsedBytes / (1024.f * 1024.f), scanStats.fileBytes / (1024.f * 1024.f),
+					scanStats.chunks, scanStats.triangles / 1e6f);
+				ImGui::Text("  %.1f MB waiting for upload (peak %.1f MB), first chunk %.0f ms", scanStats.queuedBytes / (1024.f * 1024.f),
+					scanStats.peakQueuedBytes / (1024.f * 1024.f), scanStats.firstChunkMs);
+			}
+			if (gObjBenchmark.valid() && gObjBenchmark.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				gObjBenchmarkResult = gObjBenchmark.get();
+			}
+			if (gObjBenchmarkResult.valid) {
+				ImGui::Text("OBJ native %.1f MB/s (%.1f ms), assimp %.1f MB/s (%.1f ms)", gObjBenchmarkResult.nativeMegabytesPerSecond(), gObjBenchmarkResult.nativeMs,
+					gObjBenchmarkResult.assimpMegabytesPerSecond(), gObjBenchmarkResult.assimpMs);
+			}
+			if (ImGui::TreeNode("Import profiles")) {
+				if (ImGui::Button("Reload")) {
+					gImportProfiles.load(gImportProfilesPath);
+				}
+				ImGui::SameLine();
+				if (ImGui::Button(gImportProfiles.isComparing() ? "Importing..." : "Import current model with each") && !gImportProfiles.isComparing()) {
+					gImportProfiles.startComparison(g_currentModelPath, gPreserveHierarchy ? 0 : (unsigned int)aiProcess_PreTransformVertices, gPreserveHierarchy ? (unsigned int)aiProcess_PreTransformVertices : 0);
+				}
+				std::vector<ImportProfileStats> profileStats = gImportProfiles.getStats();
+				for (const auto& profile : gImportProfiles.getProfiles()) {
+					std::string extensions;
+					for (const auto& extension : profile.extensions) {
+						extensions += extension + " ";
+					}
+					ImGui::Text("%s: %s", profile.name.c_str(), extensions.c_str());
+					for (const auto& entry : profileStats) {
+						if (entry.name == profile.name) {
+							ImGui::Text("  %u imports, avg %.1f ms, %.1f MB, last %.1f ms, %.1f MB", entry.imports, entry.totalMs / entry.imports,
+								entry.totalBytes / (1024.f * 1024.f * entry.imports), entry.lastMs, entry.lastBytes / (1024.f * 1024.f));
+						}
 					}
-					continue;
 				}
-				//recompute model matrix for selected model
-				else {
-					modelMatrix = computeModelMatrix(*models.find(g_currentModel)->second);
-					if (g_currentModel == GolfMk5) {
-						//golf mk5 is rotated 180 degrees
-						modelMatrix = glm::rotate(modelMatrix, glm::radians(180.f), glm::vec3(0, 1, 0));
+				ImGui::TreePop();
+			}
+			if (ImGui::TreeNode("File cache")) {
+				if (ImGui::Button("Clear")) {
+					//streams of running imports keep their files mapped
+					gFileCache.clear();
+				}
+				ImGui::Text("%zu files, %.1f / %.1f MB", gFileCache.getCachedFiles(), gFileCache.getCachedBytes() / (1024.f * 1024.f), gFileCache.getMaxBytes() / (1024.f * 1024.f));
+				for (const auto& entry : { std::make_pair("Total", gFileCache.getTotals()), std::make_pair("Last import", gFileCache.getLastImport()) }) {
+					const FileIOStats& io = entry.second;
+					ImGui::Text("%s: %llu opens, %llu cached, %llu mapped", entry.first, (unsigned long long)io.opens, (unsigned long long)io.hits, (unsigned long long)io.misses);
+					ImGui::Text("  %.1f MB read, %.1f MB mapped, %llu syscalls", io.bytesRead / (1024.f * 1024.f), io.bytesMapped / (1024.f * 1024.f), (unsigned long long)io.syscalls);
+				}
+				ImGui::TreePop();
+			}
+			if (ImGui::TreeNode("Out-of-core octree")) {
+				if (ImGui::Checkbox("Draw from octree", &gOutOfCore)) {
+					startStreaming(g_currentModelPath);
+				}
+				ImGui::SliderInt("Node triangles", &gOctreeNodeTriangles, 4096, 262144, "%d", ImGuiSliderFlags_Logarithmic);
+				bool building = gOctreeBuild.valid();
+				if (ImGui::Button(building ? "Building..." : "Build for current model") && !building) {
+					gOctreeBuildPath = g_currentModelPath;
+					std::string path = gOctreeBuildPath;
+					uint32_t nodeTriangles = (uint32_t)gOctreeNodeTriangles;
+					gOctreeBuild = std::async(std::launch::async, [path, nodeTriangles]() { return BuildOctree(path, gOctreeDirectory, nodeTriangles); });
+				}
+				if (gOctreeBuild.valid() && gOctreeBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+					gOctreeBuildResult = gOctreeBuild.get();
+					//new octree of shown model replaces what is drawn now
+					if (gOctreeBuildResult.valid && gOutOfCore && gOctreeBuildPath == g_currentModelPath) {
+						startStreaming(g_currentModelPath);
 					}
 				}
+				if (gOctreeBuildResult.valid) {
+					ImGui::Text("Built %zu nodes (%zu leaves, depth %u), %.1f MB in %.0f ms", gOctreeBuildResult.nodes, gOctreeBuildResult.leaves, gOctreeBuildResult.depth,
+						gOctreeBuildResult.fileBytes / (1024.f * 1024.f), gOctreeBuildResult.totalMs);
+				}
+				else if (!gOctreeBuildResult.error.empty()) {
+					ImGui::Text("Build failed: %s", gOctreeBuildResult.error.c_str());
+				}
+				if (ImGui::SliderInt("Node budget (MB)", &gOctreeBudgetMB, 16, 4096) && octree) {
+					octree->setBudget((size_t)gOctreeBudgetMB << 20);
+				}
+				if (ImGui::SliderFloat("Pixel error", &gOctreePixelError, 0.5f, 16.f) && octree) {
+					octree->setPixelError(gOctreePixelError);
+				}
+				if (octree) {
+					OctreeRenderer::Stats stats = octree->getStats();
+					ImGui::Text("Nodes loaded %zu / %zu, drawn %zu, loading %zu", stats.residentNodes, stats.nodes, stats.drawnNodes, stats.loadingNodes);
+					ImGui::Text("In flight %.1f MB, budget %.1f / %.1f MB (%.0f%%)", stats.bytesInFlight / (1024.f * 1024.f), stats.residentBytes / (1024.f * 1024.f),
+						stats.budgetBytes / (1024.f * 1024.f), 100.f * (stats.residentBytes + stats.bytesInFlight) / std::max<size_t>(stats.budgetBytes, 1));
+					ImGui::Text("Loads %llu, evictions %llu", (unsigned long long)stats.loads, (unsigned long long)stats.evictions);
+				}
+				else if (gOutOfCore) {
+					ImGui::Text("No octree of current model");
+				}
+				ImGui::TreePop();
+			}
+
+			if (browser.draw(catalog, gShowThumbnails ? &thumbnails : nullptr, g_currentModelPath)) {
+				const std::string& path = g_currentModelPath;
+				//resident and prefetched models are shown right away, others are streamed in behind their proxy
+				//models with octree are always drawn from it while out-of-core drawing is enabled
+				bool outOfCore = gOutOfCore && HasOctree(gOctreeDirectory, path);
+				std::unique_ptr<Model> prefetchedModel = outOfCore || residency.isResident(path) ? nullptr : prefetcher.take(path);
+				if (!outOfCore && (prefetchedModel || residency.isResident(path))) {
+					cancelStreaming();
+					currentModel = prefetchedModel ? residency.adopt(path, std::move(prefetchedModel)) : residency.acquire(path);
+					//recompute model matrix for selected model
+					modelMatrix = computeOrientedModelMatrix(*currentModel, path);
+				}
+				else if (path != streamingPath || outOfCore) {
+					startStreaming(path);
+				}
+				prefetcher.recordSelection(path, browser.getNeighbours(catalog, path, 1),
+					[&residency, &streamingPath](const std::string& candidate) { return residency.isResident(candidate) || candidate == streamingPath; });
+			}
+			if (!streamingPath.empty()) {
+				ImGui::Text(streamingModel ? "Uploading model..." : "Loading model...");
 			}
 
 			ImGui::Text("Projection mode");
@@ -383,6 +849,10 @@ void MainLoop() {
 			else {
 				g_currentCameraMode = Orbit;
 			}
+			ImGui::Checkbox("Quad view (front, side, top, camera)", &gQuadView);
+			if (gQuadView && !gShaders.isViewportFromVertexShader()) {
+				ImGui::Text("Viewport selected by geometry shader");
+			}
 
 			ImGui::Text("Camera options");
 			if (g_currentCameraMode == FreeLook) {
@@ -407,23 +877,236 @@ void MainLoop() {
 			}
 			ImGui::ColorEdit3("Light Color", &lightColor[0]);
 			ImGui::SliderFloat3("Light Position", &lightPosition[0], -100.0f, 100.0f);
+			const char* lightingModels[] = { "Phong", "Blinn-Phong", "Unlit" };
+			if (ImGui::Combo("Lighting model", &gLightingModel, lightingModels, LightingModelCount)) {
+				gShaders.setLightingModel((LightingModel)gLightingModel);
+			}
+			const char* prepassModes[] = { "Off", "On", "Auto" };
+			if (ImGui::Combo("Depth pre-pass", &gDepthPrepassMode, prepassModes, 3)) {
+				gDepthPrepass.mode = (DepthPrepass::Mode)gDepthPrepassMode;
+			}
+			//applies to models uploaded afterwards
+			if (ImGui::Checkbox("Compact positions (16 bit)", &gCompactPositions)) {
+				Mesh::compactPositions = gCompactPositions;
+			}
+
+			ImGui::Text("Showroom");
+			if (ImGui::Checkbox("Show grid of instances", &gShowroom.enabled) && gShowroom.enabled && gShowroom.getModelCount() == 0 && currentModel) {
+				gShowroom.addModel(g_currentModelPath, *currentModel, modelMatrix);
+				gShowroom.layout(gShowroomInstances);
+			}
+			if (ImGui::Button("Add current model") && currentModel) {
+				gShowroom.addModel(g_currentModelPath, *currentModel, modelMatrix);
+				gShowroom.layout(gShowroomInstances);
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Remove models")) {
+				gShowroom.clearModels();
+			}
+			if (ImGui::SliderInt("Instances", &gShowroomInstances, 1, 10000)) {
+				gShowroom.layout(gShowroomInstances);
+			}
+			ImGui::Checkbox("Cull instances", &gShowroom.cullInstances);
+			ImGui::SliderFloat("Color override", &gShowroom.colorOverrideStrength, 0.f, 1.f);
+			ImGui::Text("Models: %zu, instances: %zu, visible: %zu", gShowroom.getModelCount(), gShowroom.getInstanceCount(), gShowroom.getVisibleCount());
+			if (ImGui::Button(gShowroom.isBenchmarking() ? "Measuring..." : "Measure 1 to 10000 instances") && !gShowroom.isBenchmarking() && gShowroom.enabled) {
+				gShowroom.startBenchmark();
+			}
+			for (const auto& result : gShowroom.getBenchmarkResults()) {
+				ImGui::Text("%5d: %zu visible, %zu draws, CPU %.2f ms, GPU %.2f ms", result.instanceCount, result.visibleCount, result.drawCount, result.cpuMs, result.gpuMs);
+			}
+
+			ImGui::Text("Memory budget");
+			bool budgetChanged = ImGui::SliderInt("VRAM budget (MB)", &gGpuBudgetMB, 64, 8192);
+			budgetChanged |= ImGui::SliderInt("RAM budget (MB)", &gCpuBudgetMB, 64, 16384);
+			if (budgetChanged) {
+				residency.setBudget((size_t)gGpuBudgetMB << 20, (size_t)gCpuBudgetMB << 20);
+			}
+			ImGui::Text("Resident models: %zu", residency.getResidentCount());
+			ImGui::Text("VRAM used: %.1f MB", residency.getGpuBytes() / (1024.f * 1024.f));
+			ImGui::Text("RAM used: %.1f MB", residency.getCpuBytes() / (1024.f * 1024.f));
+			ImGui::Text("Evictions: %u, reloads: %u", residency.getEvictionCount(), residency.getReloadCount());
+			ImGui::SliderInt("Streaming upload per frame (MB)", &gStreamingUploadMB, 1, 128);
+
+			ImGui::Text("Prefetching");
+			if (ImGui::Checkbox("Prefetch likely next models", &gPrefetchEnabled)) {
+				prefetcher.setEnabled(gPrefetchEnabled);
+			}
+			ImGui::SliderFloat("Pause above (ms)", &prefetcher.frameTimeThresholdMs, 5.f, 100.f);
+
+			ImGui::Text("Power saving");
+			ImGui::Checkbox("Redraw only on changes", &gFramePacer.idleMode);
+			ImGui::SliderInt("Frame cap (0 = off)", &gFramePacer.frameCap, 0, 240);
+			const char* vsyncModes[] = { "Off", "On", "Adaptive" };
+			if (ImGui::Combo("VSync", &gVSyncMode, vsyncModes, 3)) {
+				gFramePacer.setVSync((FramePacer::VSync)gVSyncMode);
+				gVSyncMode = gFramePacer.getVSync();
+			}
+			if (!gFramePacer.isAdaptiveVSyncSupported()) {
+				ImGui::Text("Adaptive vsync not supported");
+			}
+			if (gFramePacer.isIdle()) {
+				ImGui::TextColored(ImVec4(0.2f, 0.8f, 0.2f, 1.f), "Idle, waiting for input");
+			}
+			else {
+				ImGui::TextColored(ImVec4(0.9f, 0.6f, 0.1f, 1.f), "Rendering");
+			}
+			ImGui::Text("Last second: %u frames drawn, %u skipped", gFramePacer.getRenderedPerSecond(), gFramePacer.getSkippedPerSecond());
+
+			ImGui::Text("Dynamic resolution");
+			ImGui::Checkbox("Scale resolution to hold frame time", &gDynamicResolution.enabled);
+			ImGui::SliderFloat("Target GPU time (ms)", &gDynamicResolution.targetFrameMs, 4.f, 50.f);
+			ImGui::SliderFloat("Minimum scale", &gDynamicResolution.minScale, 0.25f, 1.f);
+			ImGui::SliderFloat("Sharpness", &gDynamicResolution.sharpness, 0.f, 1.f);
+			if (gDynamicResolution.enabled) {
+				ImGui::Text("Scale: %.0f %% (%dx%d), GPU %.2f ms", gDynamicResolution.getScale() * 100.f,
+					gDynamicResolution.getRenderWidth(), gDynamicResolution.getRenderHeight(), gDynamicResolution.getGpuMs());
+			}
+
+			ImGui::Text("Anti-aliasing");
+			for (int i = 0; i < AntiAliasing::ModeCount; i++) {
+				AntiAliasing::Mode mode = (AntiAliasing::Mode)i;
+				if (!gAntiAliasing.isSupported(mode)) {
+					continue;
+				}
+				if (ImGui::RadioButton(AntiAliasing::getName(mode), &gAntiAliasingMode, i)) {
+					gAntiAliasing.mode = mode;
+				}
+				//GPU time of scene in every mode, side by side so cheapest acceptable one can be picked
+				ImGui::SameLine(120);
+				if (gAntiAliasing.getGpuMs(mode) >= 0.0) {
+					ImGui::Text("%.2f ms", gAntiAliasing.getGpuMs(mode));
+				}
+				else {
+					ImGui::Text("not measured");
+				}
+			}
+			if (ImGui::Button(gAntiAliasing.isBenchmarking() ? "Measuring..." : "Measure all modes") && !gAntiAliasing.isBenchmarking()) {
+				gAntiAliasing.startBenchmark();
+			}
+
+			ImGui::Text("Image quality");
+			bool accumulationChanged = ImGui::Checkbox("Refine still image", &gAccumulation.enabled);
+			accumulationChanged |= ImGui::SliderInt("Samples", &gAccumulation.maxSamples, 1, 256);
+			if (accumulationChanged) {
+				gAccumulation.reset();
+			}
 			ImGui::End();
 		}
 
+		{
+			ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_Always);
+			ImGui::SetNextWindowSize(ImVec2(300, 320), ImGuiCond_Always);
+			ImGui::Begin("Stats");
+			ImGui::Text("Frame time: %.2f ms (%.0f FPS)", frameTimeMs, frameTimeMs > 0.f ? 1000.f / frameTimeMs : 0.f);
+			ImGui::Text("Time to first frame: %.0f ms", timeToFirstFrameMs);
+			ImGui::Text("Time to full detail: %.0f ms", timeToFullDetailMs);
+			ImGui::Text("Shader programs: %zu/%zu ready, %zu from cache%s", gShaders.getReadyCount(), gShaders.getProgramCount(),
+				gShaders.getCachedCount(), gShaders.isParallel() ? ", parallel" : "");
+			ImGui::Text("Shader compile time: %.1f ms", gShaders.getCompileMs());
+			ImGui::Text("GL state calls: %u issued, %u skipped", gState.getIssuedCount(), gState.getSkippedCount());
+			ImGui::Text("Render queue: %zu draws, sorted in %.1f us%s", gRenderQueue.getItemCount(), gRenderQueue.getSortMicroseconds(),
+				gRenderQueue.wasOrderReused() ? " (reused)" : "");
+			ImGui::Text("Culled meshes: %zu", gRenderQueue.getCulledCount());
+			if (gAccumulation.enabled) {
+				ImGui::Text("Accumulated samples: %d/%d", gAccumulation.getSampleCount(), gAccumulation.maxSamples);
+			}
+			ImGui::Text("Depth pre-pass: %s, %.2f ms", gDepthPrepass.isActive() ? "on" : "off", gDepthPrepass.getPrepassMs());
+			ImGui::Text("GPU time with pre-pass: %.2f ms, without: %.2f ms", gDepthPrepass.getFrameMs(true), gDepthPrepass.getFrameMs(false));
+			if (currentModel) {
+				ImGui::Text("Draw calls: %zu, meshes: %zu, textures: %zu", currentModel->getDrawCount(), currentModel->getMeshCount(), currentModel->getTextureCount());
+				const WeldResult& weld = currentModel->getWeldResult();
+				if (weld.verticesBefore > 0) {
+					ImGui::Text("Welded vertices %zu -> %zu, ACMR %.2f -> %.2f", weld.verticesBefore, weld.verticesAfter, weld.acmrBefore, weld.acmrAfter);
+				}
+				const Model::DeduplicationStats& deduplication = currentModel->getDeduplicationStats();
+				if (deduplication.duplicateCount > 0) {
+					ImGui::Text("Repeated meshes: %zu, draws %zu -> %zu", deduplication.duplicateCount, deduplication.drawsBefore, deduplication.drawsAfter);
+					ImGui::Text("Mesh data %.1f -> %.1f MB, upload %.1f -> %.1f MB", deduplication.meshBytesBefore / (1024.f * 1024.f), deduplication.meshBytesAfter / (1024.f * 1024.f),
+						deduplication.uploadBytesBefore / (1024.f * 1024.f), deduplication.uploadBytesAfter / (1024.f * 1024.f));
+				}
+				if (currentModel->isHierarchical()) {
+					ImGui::Text("Nodes: %zu, mesh data %.1f MB instead of %.1f MB", currentModel->nodes.size(),
+						currentModel->getMeshBytes() / (1024.f * 1024.f), currentModel->getPretransformedMeshBytes() / (1024.f * 1024.f));
+				}
+			}
+			ImGui::Text("Prefetch hit rate: %.0f %%", prefetcher.getHitRate() * 100.f);
+			ImGui::Text("Hits: %u, late hits: %u, misses: %u", prefetcher.getHits(), prefetcher.getLateHits(), prefetcher.getMisses());
+			ImGui::Text("Prefetched: %zu models, %.1f MB", prefetcher.getCachedCount(), prefetcher.getCachedBytes() / (1024.f * 1024.f));
+			ImGui::Text("Prefetch queue: %zu%s", prefetcher.getQueuedCount(), prefetcher.isPaused() ? " (paused)" : "");
+			ImGui::End();
+		}
+
+		//render at most one missing thumbnail per frame, browser shows placeholder until it is done
+		//not resident models are imported on loader thread only for thumbnail and do not push viewed models out of budget
+		if (gShowThumbnails && !browser.getMissingThumbnails().empty() && !thumbnailLoad.valid() && !thumbnailModel) {
+			const CatalogEntry& entry = catalog.getEntries()[browser.getMissingThumbnails().front()];
+			Model* residentModel = residency.peek(entry.path);
+			if (residentModel && residentModel->isUploaded()) {
+				thumbnails.render(ThumbnailAtlas::hashEntry(entry), *residentModel, computeOrientedModelMatrix(*residentModel, entry.path), DrawModel);
+			}
+			else {
+				thumbnailEntry = entry;
+				std::string path = entry.path;
+				thumbnailLoad = std::async(std::launch::async, [path]() { return std::make_unique<Model>(path, false); });
+			}
+		}
+		if (thumbnailLoad.valid() && thumbnailLoad.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			thumbnailModel = thumbnailLoad.get();
+		}
+		//thumbnail is stored even when its cell scrolled out of view meanwhile
+		if (thumbnailModel && thumbnailModel->uploadStep((size_t)gStreamingUploadMB << 20)) {
+			thumbnails.render(ThumbnailAtlas::hashEntry(thumbnailEntry), *thumbnailModel, computeOrientedModelMatrix(*thumbnailModel, thumbnailEntry.path), DrawModel);
+			GLObjectList objects;
+			thumbnailModel->releaseGLObjects(objects);
+			deletionQueue.enqueue(std::move(objects));
+			thumbnailModel.reset();
+		}
+
 		HandleInput();
-		Draw(*models.find(g_currentModel)->second, modelMatrix);
+		if (gShowroom.enabled) {
+			//models evicted from residency disappear from showroom until loaded again
+			gShowroom.resolveModels([&residency](const std::string& path) { return residency.peek(path); });
+		}
+		if (!streamingPath.empty()) {
+			Draw(streamingModel.get(), streamingProxy ? &streamingProxy->model : nullptr, modelMatrix);
+		}
+		else {
+			Draw(currentModel, nullptr, modelMatrix, octree.get());
+		}
 
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 		SDL_GL_SwapWindow(gWindow);
+		gState.endFrame();
+		gFramePacer.endFrame();
+
+		if (firstFrame) {
+			timeToFirstFrameMs = (SDL_GetPerformanceCounter() - gStartCounter) * 1000.f / SDL_GetPerformanceFrequency();
+			std::cout << "First frame after " << timeToFirstFrameMs << " ms" << (streamingProxy ? " (proxy)" : "") << std::endl;
+			firstFrame = false;
+		}
+	}
+	cancelStreaming();
+	if (thumbnailLoad.valid()) {
+		thumbnailModel = thumbnailLoad.get();
+	}
+	if (thumbnailModel) {
+		GLObjectList objects;
+		thumbnailModel->releaseGLObjects(objects);
+		deletionQueue.enqueue(std::move(objects));
+		thumbnailModel.reset();
 	}
 
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplSDL2_Shutdown();
 	ImGui::DestroyContext();
+
+	thumbnails.release(deletionQueue);
 }
 
 int main(int argc, char* argv[]) {
+	gStartCounter = SDL_GetPerformanceCounter();
 	//init SDL and OpenGL context
 	Init();
 
@@ -433,6 +1116,12 @@ int main(int argc, char* argv[]) {
 	MainLoop();
 	
 	//cleanup
+	gShaders.release();
+	gDepthPrepass.release();
+	gAccumulation.release();
+	gDynamicResolution.release();
+	gAntiAliasing.release();
+	gShowroom.release();
 	SDL_GL_DeleteContext(gOpenGLContext);
 	SDL_DestroyWindow(gWindow);
 	SDL_Quit();
@@ -3,8 +3,13 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <memory>
 #include <string>
+#include <cstdint>
+#include <cmath>
 #include <vector>
+#include "ShaderPermutations.h"
+#include "GLStateCache.h"
 
 //inspired by learnopengl tutorial - basic concept of loading model using assimp
 //https://learnopengl.com/Model-Loading/Assimp
@@ -14,12 +19,80 @@ struct Vertex {
     glm::vec3 Normal;
     glm::vec2 TexCoords;
     glm::vec4 Color;
-    float useDiffuseTexture;
 };
 
 struct Texture {
-    unsigned int id;
+    unsigned int id = 0;
     std::string path;
+    //size of the texture in video memory including mipmaps
+    size_t byteSize = 0;
+};
+
+//decoded texture waiting for upload to GPU
+struct TextureImage {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    //limit of mip levels, 0 for full chain
+    int mipLevels = 0;
+    std::shared_ptr<unsigned char> data;
+};
+
+//vertex attribute GL reads straight from file data, format comes from gltf accessor
+struct MeshSourceAttribute {
+    //index of range holding attribute, -1 when mesh does not have it
+    int range = -1;
+    //first element relative to start of range
+    size_t offset = 0;
+    GLsizei stride = 0;
+    GLint size = 0;
+    GLenum type = GL_FLOAT;
+    GLboolean normalized = GL_FALSE;
+};
+
+//byte range of file data uploaded as one buffer
+struct MeshSourceRange {
+    size_t offset = 0;
+    size_t size = 0;
+};
+
+//vertex and index data of mesh left in mapped file until upload, every range is copied into its own GL buffer without CPU side conversion
+struct MeshSource {
+    //keeps data mapped, released once buffers are created
+    std::shared_ptr<const void> owner;
+    const unsigned char* data = nullptr;
+    std::vector<MeshSourceRange> ranges;
+    MeshSourceAttribute position;
+    MeshSourceAttribute normal;
+    MeshSourceAttribute texCoords;
+    //per vertex color, constant color below is used when mesh does not have it
+    MeshSourceAttribute colors;
+    //indices start at beginning of their range
+    int indexRange = -1;
+    GLenum indexType = GL_UNSIGNED_INT;
+    size_t indexCount = 0;
+    size_t vertexCount = 0;
+    //constant color attribute, meshes with Vertex data store it per vertex
+    glm::vec4 color = glm::vec4(1.f);
+    //bounds of positions, from accessor min and max
+    glm::vec3 boundsMin = glm::vec3(0.f);
+    glm::vec3 boundsMax = glm::vec3(0.f);
+
+    size_t bytes() const
+    {
+        size_t total = 0;
+        for (const auto& range : ranges) {
+            total += range.size;
+        }
+        return total;
+    }
+};
+
+//GL object names collected from released meshes, deleted later once the GPU is done with them
+struct GLObjectList {
+    std::vector<GLuint> buffers;
+    std::vector<GLuint> vertexArrays;
+    std::vector<GLuint> textures;
 };
 
 class Mesh {
@@ -29,37 +102,268 @@ public:
     bool hasTexture;
     Texture      texture;
     bool isTransparent;
-    unsigned int VAO;
+    //ShaderFeature bits picked on load, mesh is drawn by matching program permutation
+    int shaderFeatures;
+    //center of bounding box, used for depth sorting
+    glm::vec3 center = glm::vec3(0.f);
+    //bounding sphere around center, used for frustum culling
+    float radius = 0.f;
+    unsigned int VAO = 0;
+    //set for mesh uploaded straight from file data, vertices and indices stay empty then
+    std::shared_ptr<MeshSource> source;
+
+    //positions of meshes uploaded afterwards are stored as 16 bit integers normalized to mesh bounds (6 bytes instead of 12)
+    static inline bool compactPositions = false;
 
     Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, Texture texture, bool hasTexture, bool isTransparent)
     {
-        this->vertices = vertices;
-        this->indices = indices;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
         this->texture = texture;
         this->isTransparent = isTransparent;
         this->hasTexture = hasTexture;
+        this->shaderFeatures = (hasTexture ? ShaderTextured : 0) | (isTransparent ? ShaderTransparent : 0);
+        if (!this->vertices.empty()) {
+            glm::vec3 boundsMin = this->vertices[0].Position;
+            glm::vec3 boundsMax = boundsMin;
+            for (const auto& vertex : this->vertices) {
+                boundsMin = glm::min(boundsMin, vertex.Position);
+                boundsMax = glm::max(boundsMax, vertex.Position);
+            }
+            center = (boundsMin + boundsMax) * 0.5f;
+            radius = glm::length(boundsMax - boundsMin) * 0.5f;
+        }
+    }
 
-        setupOpenGLBuffers();
+    //mesh drawn from file data, CPU side passes working on vertices skip it
+    Mesh(std::shared_ptr<MeshSource> source, Texture texture, bool hasTexture, bool isTransparent)
+        : Mesh({}, {}, texture, hasTexture, isTransparent)
+    {
+        center = (source->boundsMin + source->boundsMax) * 0.5f;
+        radius = glm::length(source->boundsMax - source->boundsMin) * 0.5f;
+        this->source = std::move(source);
     }
 
-    void Draw(GLuint pipelineProgramId)
+    //creates GL buffers from vertex data, has to run on thread owning GL context
+    void upload()
     {
+        if (!isUploaded()) {
+            setupOpenGLBuffers();
+        }
+    }
+
+    bool isUploaded() const
+    {
+        return VAO != 0;
+    }
+
+    //program matching shaderFeatures has to be bound, diffuse texture sampler is bound to unit 0 in shader
+    //more instances are used by multi view and instanced programs, instanced ones read instance data from baseInstance on
+    //node transform places mesh of preserved scene hierarchy within model
+    void Draw(GLStateCache& state, int instanceCount = 1, int baseInstance = 0, const glm::mat4& nodeTransform = glm::mat4(1.f))
+    {
+        //meshes of model still streaming to GPU are skipped
+        if (!isUploaded()) {
+            return;
+        }
         if (this->hasTexture) {
-            glActiveTexture(GL_TEXTURE0);
-            glUniform1i(glGetUniformLocation(pipelineProgramId, "texture_diffuse0"), 0);
-            glBindTexture(GL_TEXTURE_2D, texture.id);
+            state.bindTexture(0, texture.id);
+        }
+
+        state.bindVertexArray(VAO);
+        setPositionDecoding(state, nodeTransform);
+        if (source) {
+            state.vertexAttrib4f(3, source->color);
+            if (source->texCoords.range < 0) {
+                state.vertexAttrib4f(2, glm::vec4(0.f, 0.f, 0.f, 1.f));
+            }
+        }
+        drawElements(instanceCount, baseInstance);
+        //constant values of attributes this mesh reads from buffers are not known after its draw
+        if (!source) {
+            for (GLuint location = 1; location <= 3; location++) {
+                state.forgetVertexAttrib(location);
+            }
+        }
+        else {
+            const MeshSourceAttribute* attributes[] = { &source->normal, &source->texCoords, &source->colors };
+            for (GLuint location = 1; location <= 3; location++) {
+                if (attributes[location - 1]->range >= 0) {
+                    state.forgetVertexAttrib(location);
+                }
+            }
+        }
+    }
+
+    //draws only positions from separate tightly packed stream, used by depth pre-pass
+    void DrawDepth(GLStateCache& state, int instanceCount = 1, int baseInstance = 0, const glm::mat4& nodeTransform = glm::mat4(1.f))
+    {
+        if (!isUploaded()) {
+            return;
+        }
+        state.bindVertexArray(depthVAO);
+        setPositionDecoding(state, nodeTransform);
+        drawElements(instanceCount, baseInstance);
+    }
+
+    //bytes of vertex and index buffers in video memory, textures are accounted by the model
+    size_t gpuBytes() const
+    {
+        if (source) {
+            return source->bytes();
         }
+        return vertices.size() * (sizeof(Vertex) + positionStride) + indices.size() * sizeof(unsigned int);
+    }
+
+    //vertex and index bytes as loaded, GL buffers of mesh drawn from file data hold the same bytes
+    size_t dataBytes() const
+    {
+        return source ? source->bytes() : vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int);
+    }
 
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-        glActiveTexture(GL_TEXTURE0);
+    size_t cpuBytes() const
+    {
+        //mapped file data is not counted, system can drop its pages any time
+        return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int);
+    }
+
+    void releaseGLObjects(GLObjectList& objects)
+    {
+        if (!isUploaded()) {
+            return;
+        }
+        objects.buffers.push_back(VBO);
+        objects.buffers.push_back(EBO);
+        objects.buffers.push_back(positionVBO);
+        objects.vertexArrays.push_back(VAO);
+        objects.vertexArrays.push_back(depthVAO);
+        objects.buffers.insert(objects.buffers.end(), sourceBuffers.begin(), sourceBuffers.end());
+        sourceBuffers.clear();
+        VAO = VBO = EBO = positionVBO = depthVAO = 0;
     }
 
 private:
-    unsigned int VBO, EBO;
+    unsigned int VBO = 0, EBO = 0;
+    //position only stream shared by depth and color pass, both read identical data so depth test GL_EQUAL matches
+    unsigned int positionVBO = 0, depthVAO = 0;
+    unsigned int positionStride = sizeof(glm::vec3);
+    //one buffer per range of source
+    std::vector<GLuint> sourceBuffers;
+    //shader computes position as offset + stored * scale, identity for float positions
+    glm::vec3 positionOffset = glm::vec3(0.f);
+    glm::vec3 positionScale = glm::vec3(1.f);
+
+    void drawElements(int instanceCount, int baseInstance)
+    {
+        GLsizei count = static_cast<GLsizei>(source ? source->indexCount : indices.size());
+        GLenum type = source ? source->indexType : GL_UNSIGNED_INT;
+        if (instanceCount > 1 || baseInstance != 0) {
+            glDrawElementsInstancedBaseInstance(GL_TRIANGLES, count, type, 0, instanceCount, baseInstance);
+        }
+        else {
+            glDrawElements(GL_TRIANGLES, count, type, 0);
+        }
+    }
+
+    void setPositionDecoding(GLStateCache& state, const glm::mat4& nodeTransform)
+    {
+        state.vertexAttrib3f(5, positionOffset);
+        state.vertexAttrib3f(6, positionScale);
+        //mat4 attribute takes locations 7 to 10, one column each
+        for (int column = 0; column < 4; column++) {
+            state.vertexAttrib4f(7 + column, nodeTransform[column]);
+        }
+    }
+
+    void setupPositionStream()
+    {
+        glCreateBuffers(1, &positionVBO);
+        GLenum type = GL_FLOAT;
+        GLboolean normalized = GL_FALSE;
+        if (compactPositions) {
+            glm::vec3 boundsMin = vertices.empty() ? glm::vec3(0.f) : vertices[0].Position;
+            glm::vec3 boundsMax = boundsMin;
+            for (const auto& vertex : vertices) {
+                boundsMin = glm::min(boundsMin, vertex.Position);
+                boundsMax = glm::max(boundsMax, vertex.Position);
+            }
+            positionOffset = (boundsMin + boundsMax) * 0.5f;
+            positionScale = glm::max((boundsMax - boundsMin) * 0.5f, glm::vec3(1e-6f));
+            std::vector<int16_t> positions(vertices.size() * 3);
+            for (size_t i = 0; i < vertices.size(); i++) {
+                glm::vec3 normalizedPosition = glm::clamp((vertices[i].Position - positionOffset) / positionScale, -1.f, 1.f);
+                for (int c = 0; c < 3; c++) {
+                    positions[i * 3 + c] = (int16_t)std::lround(normalizedPosition[c] * 32767.f);
+                }
+            }
+            positionStride = 3 * sizeof(int16_t);
+            type = GL_SHORT;
+            normalized = GL_TRUE;
+            glNamedBufferData(positionVBO, positions.size() * sizeof(int16_t), positions.data(), GL_STATIC_DRAW);
+        }
+        else {
+            std::vector<glm::vec3> positions(vertices.size());
+            for (size_t i = 0; i < vertices.size(); i++) {
+                positions[i] = vertices[i].Position;
+            }
+            positionStride = sizeof(glm::vec3);
+            glNamedBufferData(positionVBO, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+        }
+
+        //position of color pass comes from the same stream on binding 5
+        glVertexArrayAttribBinding(VAO, 0, 5);
+        glEnableVertexArrayAttrib(VAO, 0);
+        glVertexArrayAttribFormat(VAO, 0, 3, type, normalized, 0);
+        glVertexArrayVertexBuffer(VAO, 5, positionVBO, 0, positionStride);
+
+        glCreateVertexArrays(1, &depthVAO);
+        glVertexArrayElementBuffer(depthVAO, EBO);
+        glVertexArrayAttribBinding(depthVAO, 0, 0);
+        glEnableVertexArrayAttrib(depthVAO, 0);
+        glVertexArrayAttribFormat(depthVAO, 0, 3, type, normalized, 0);
+        glVertexArrayVertexBuffer(depthVAO, 0, positionVBO, 0, positionStride);
+    }
+
+    //ranges of source go to immutable buffers as they are, attribute formats follow accessors, so no vertex is converted on CPU
+    void setupSourceBuffers()
+    {
+        glCreateVertexArrays(1, &VAO);
+        glCreateVertexArrays(1, &depthVAO);
+        sourceBuffers.resize(source->ranges.size());
+        glCreateBuffers((GLsizei)sourceBuffers.size(), sourceBuffers.data());
+        for (size_t i = 0; i < sourceBuffers.size(); i++) {
+            glNamedBufferStorage(sourceBuffers[i], source->ranges[i].size, source->data + source->ranges[i].offset, 0);
+        }
+        glVertexArrayElementBuffer(VAO, sourceBuffers[source->indexRange]);
+        glVertexArrayElementBuffer(depthVAO, sourceBuffers[source->indexRange]);
+
+        //every attribute has own binding, offsets within shared range can exceed limit of relative offset
+        auto setupAttribute = [this](GLuint vertexArray, GLuint location, const MeshSourceAttribute& attribute) {
+            if (attribute.range < 0) {
+                return;
+            }
+            glVertexArrayAttribBinding(vertexArray, location, location);
+            glEnableVertexArrayAttrib(vertexArray, location);
+            glVertexArrayAttribFormat(vertexArray, location, attribute.size, attribute.type, attribute.normalized, 0);
+            glVertexArrayVertexBuffer(vertexArray, location, sourceBuffers[attribute.range], attribute.offset, attribute.stride);
+        };
+        setupAttribute(VAO, 0, source->position);
+        setupAttribute(VAO, 1, source->normal);
+        setupAttribute(VAO, 2, source->texCoords);
+        setupAttribute(VAO, 3, source->colors);
+        setupAttribute(depthVAO, 0, source->position);
+
+        //data is on GPU, file can be unmapped once other meshes are done with it
+        source->owner.reset();
+        source->data = nullptr;
+    }
+
     void setupOpenGLBuffers()
     {
+        if (source) {
+            setupSourceBuffers();
+            return;
+        }
 
         glCreateVertexArrays(1, &VAO);
 
@@ -72,9 +376,7 @@ private:
 
 
         //position
-        glVertexArrayAttribBinding(VAO, 0, 0);
-        glEnableVertexArrayAttrib(VAO, 0);
-        glVertexArrayAttribFormat(VAO, 0, 3, GL_FLOAT, GL_FALSE, 0);
+        setupPositionStream();
         glVertexArrayVertexBuffer(VAO, 0, VBO,0, sizeof(Vertex));
 
         //normals
@@ -95,13 +397,5 @@ private:
         glEnableVertexArrayAttrib(VAO, 3);
         glVertexArrayAttribFormat(VAO, 3, 4, GL_FLOAT, GL_FALSE, offsetof(Vertex, Color));
         glVertexArrayVertexBuffer(VAO, 3, VBO, 0, sizeof(Vertex));
-            
-        //useDiffuseTexture
-        glVertexArrayAttribBinding(VAO, 4, 0);
-        glEnableVertexArrayAttrib(VAO, 4);
-        glVertexArrayAttribFormat(VAO, 4, 1, GL_FLOAT, GL_FALSE, offsetof(Vertex, useDiffuseTexture));
-        glVertexArrayVertexBuffer(VAO, 4, VBO, 0, sizeof(Vertex));
-
-        glBindVertexArray(0);
     }
 };
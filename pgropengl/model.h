@@ -3,18 +3,37 @@
 #include <glad/glad.h> 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include "stb_image.h"
 #include "mesh.h"
+#include "MaterialAtlas.h"
+#include "RenderQueue.h"
+#include "SceneGraph.h"
+#include "MeshDeduplication.h"
+#include "VertexWelding.h"
+#include "ImportProfiles.h"
+#include "MappedFileCache.h"
+#include "ObjLoader.h"
+#include "GltfLoader.h"
+#include "ScanLoader.h"
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
 #include <vector>
+#include <memory>
+#include <cstdint>
+#include <atomic>
+#include <algorithm>
+#include <iterator>
 
-unsigned int TextureFromFile(const char* path, const std::string& directory);
+TextureImage LoadTextureImage(const char* path, const std::string& directory);
+unsigned int TextureFromImage(const TextureImage& image, size_t* byteSize = nullptr);
+unsigned int TextureFromFile(const char* path, const std::string& directory, size_t* byteSize = nullptr);
 //inspired by learnopengl tutorial - basic concept of loading model using assimp
 //https://learnopengl.com/Model-Loading/Assimp
 class Model
@@ -24,44 +43,810 @@ public:
     std::vector<Mesh> transparentMeshes;
     std::string directory;
 
-    Model(std::string const& path) 
+    //draw of mesh placed by transform of scene node, mesh indexes opaque or transparent list
+    struct MeshInstance {
+        uint32_t node;
+        uint32_t mesh;
+        bool transparent;
+    };
+    //node hierarchy kept on import, both are empty when vertices were pretransformed into model space
+    SceneGraph nodes;
+    std::vector<MeshInstance> meshInstances;
+
+    //textures up to this size are packed into shared atlas pages on load and meshes sharing texture are merged, 0 disables
+    //read by loader threads, change applies to models loaded afterwards
+    static inline std::atomic<int> atlasMaxTextureSize{ 256 };
+    //keeps node hierarchy instead of aiProcess_PreTransformVertices, mesh used by more nodes is stored once and drawn per node
+    //meshes are not merged by texture then, read by loader threads like atlas size
+    static inline std::atomic<bool> preserveHierarchy{ false };
+    //meshes repeating earlier mesh up to transform are dropped and drawn as node instances of it, read by loader threads
+    static inline std::atomic<bool> deduplicateMeshes{ true };
+    //assimp does not join identical vertices, so corners of unindexed imports are welded by own pass, read by loader threads
+    static inline std::atomic<bool> weldVertices{ true };
+    //post-processing by file extension, fixed flags are used while not set
+    static inline std::atomic<ImportProfiles*> importProfiles{ nullptr };
+    //files read by assimp are mapped and kept in this cache, default assimp file io is used while not set
+    static inline std::atomic<MappedFileCache*> fileCache{ nullptr };
+    //obj files are parsed by own multithreaded loader instead of assimp, read by loader threads
+    static inline std::atomic<bool> nativeObjLoader{ true };
+    //gltf primitives are uploaded from mapped buffers as they are, files this cannot handle go to assimp, read by loader threads
+    static inline std::atomic<bool> nativeGltfLoader{ true };
+    //binary ply and stl are parsed in chunks of this size while finished chunks are uploaded, other files go to assimp, read by loader threads
+    static inline std::atomic<bool> streamScans{ true };
+    static inline std::atomic<int> scanChunkMB{ 4 };
+
+    //import settings model is loaded with, stored with proxies which have to match meshes of their model
+    static int currentImportFlags() { return (preserveHierarchy ? 1 : 0) | (deduplicateMeshes ? 2 : 0) | (nativeGltfLoader ? 4 : 0) | (streamScans ? 8 : 0); }
+    int getImportFlags() const { return importFlags; }
+
+    //mesh data, buffer bytes and draw calls of model before and after deduplication
+    struct DeduplicationStats {
+        size_t duplicateCount = 0;
+        size_t meshBytesBefore = 0;
+        size_t meshBytesAfter = 0;
+        size_t uploadBytesBefore = 0;
+        size_t uploadBytesAfter = 0;
+        size_t drawsBefore = 0;
+        size_t drawsAfter = 0;
+    };
+
+    //empty model, meshes are filled in by caller (used for proxies)
+    Model() {}
+
+    //without upload only CPU side data are loaded, so it can run on any thread and upload is done later
+    Model(std::string const& path, bool uploadToGpu = true)
     {
         loadModel(path);
+        if (uploadToGpu) {
+            upload();
+        }
+    }
+
+    //creates GL objects for meshes and textures not uploaded yet, stops once maxBytes were uploaded
+    //returns true when whole model is on GPU, has to run on thread owning GL context
+    //chunks of streamed scan are taken one at a time once earlier ones are on GPU, so parsing waits while upload falls behind
+    bool uploadStep(size_t maxBytes)
+    {
+        size_t uploadedBytes = 0;
+        while (uploadedBytes < maxBytes && (uploadedMeshes < getMeshCount() || adoptScanChunk())) {
+            Mesh& mesh = uploadedMeshes < opaqueMeshes.size() ? opaqueMeshes[uploadedMeshes] : transparentMeshes[uploadedMeshes - opaqueMeshes.size()];
+            if (mesh.hasTexture) {
+                uploadedBytes += uploadTexture(mesh.texture);
+            }
+            mesh.upload();
+            uploadedBytes += mesh.gpuBytes();
+            uploadedMeshes++;
+        }
+        if (instanceBuffer == 0 && !instanceNodes.empty()) {
+            glCreateBuffers(1, &instanceBuffer);
+            glNamedBufferStorage(instanceBuffer, instanceNodes.size() * sizeof(InstanceData), nullptr, GL_DYNAMIC_STORAGE_BIT);
+            uploadInstanceTransforms();
+        }
+        if (scanStream && uploadedMeshes == getMeshCount() && scanStream->isDone()) {
+            scanStats = scanStream->getStats();
+            scanStream.reset();
+            std::cout << "Streamed " << scanStats.fileBytes / 1024 << " KB in " << scanStats.chunks << " chunks, first after " << scanStats.firstChunkMs
+                << " ms, all parsed after " << scanStats.totalMs << " ms, " << scanStats.triangles << " triangles, " << scanStats.corners << " corners -> "
+                << scanStats.vertices << " vertices, at most " << scanStats.peakQueuedBytes / 1024 << " KB waiting for upload"
+                << (scanStats.truncated ? ", file truncated" : "") << std::endl;
+        }
+        return isUploaded();
+    }
+
+    void upload()
+    {
+        //streamed scan is complete once its last chunk is parsed
+        while (!uploadStep(SIZE_MAX)) {
+            scanStream->wait();
+        }
     }
 
-    void Draw(GLuint pipelineProgramId) 
+    bool isUploaded() const
+    {
+        return !scanStream && uploadedMeshes == opaqueMeshes.size() + transparentMeshes.size();
+    }
+
+    //true while chunks of scan are still being parsed, meshes and bounds grow with every upload step
+    bool isStreamingScan() const
+    {
+        return scanStream != nullptr;
+    }
+
+    //progress of streamed scan, totals of whole file once it is complete
+    ScanStreamStats getScanStats() const
+    {
+        return scanStream ? scanStream->getStats() : scanStats;
+    }
+
+    //adds meshes to render queue, which orders them by material and depth
+    //meshes still streaming to GPU are replaced by mesh with the same index in proxy model
+    void submit(RenderQueue& queue, const glm::mat4& modelViewMatrix, Model* proxy = nullptr)
 	{
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glEnable(GL_DEPTH_TEST);
-        glDepthFunc(GL_LEQUAL);
-        //draw opaque meshes first and then transparent meshes to blend correctly
+        if (isHierarchical()) {
+            updateNodes();
+            auto addNodeDraw = [&](const MeshInstance& instance) {
+                std::vector<Mesh>& meshes = instance.transparent ? transparentMeshes : opaqueMeshes;
+                std::vector<Mesh>* proxyMeshes = proxy ? (instance.transparent ? &proxy->transparentMeshes : &proxy->opaqueMeshes) : nullptr;
+                queue.add(pickMesh(meshes, proxyMeshes, instance.mesh), modelViewMatrix, &nodes.getWorldTransform(instance.node));
+            };
+            //instance buffer is created with first upload step, until then every node is drawn on its own
+            if (instanceBuffer == 0) {
+                for (const auto& instance : meshInstances) {
+                    addNodeDraw(instance);
+                }
+                return;
+            }
+            for (uint32_t index : nodeDraws) {
+                addNodeDraw(meshInstances[index]);
+            }
+            //instanced draws are not culled, their instances are spread around model
+            for (const auto& draw : instancedDraws) {
+                queue.addInstanced(pickMesh(opaqueMeshes, proxy ? &proxy->opaqueMeshes : nullptr, draw.mesh), modelViewMatrix,
+                    draw.instanceCount, draw.baseInstance, nullptr, instanceBuffer);
+            }
+            return;
+        }
         for (unsigned int i = 0; i < opaqueMeshes.size(); i++) {
-            opaqueMeshes[i].Draw(pipelineProgramId);
+            queue.add(pickMesh(opaqueMeshes, proxy ? &proxy->opaqueMeshes : nullptr, i), modelViewMatrix);
         }
-
-        glDepthMask(GL_FALSE);
         for (unsigned int i = 0; i < transparentMeshes.size(); i++) {
-            transparentMeshes[i].Draw(pipelineProgramId);
+            queue.add(pickMesh(transparentMeshes, proxy ? &proxy->transparentMeshes : nullptr, i), modelViewMatrix);
         }
-        glDepthMask(GL_TRUE);
 	}
 
+    //queues one instanced draw per uploaded mesh with instances of given instance buffer, nodes of hierarchy are drawn one by one
+    void submitInstanced(RenderQueue& queue, const glm::mat4& modelViewMatrix, uint32_t instanceCount, uint32_t baseInstance, GLuint instanceBuffer)
+    {
+        if (isHierarchical()) {
+            updateNodes();
+            for (const auto& instance : meshInstances) {
+                Mesh& mesh = instance.transparent ? transparentMeshes[instance.mesh] : opaqueMeshes[instance.mesh];
+                if (mesh.isUploaded()) {
+                    queue.addInstanced(mesh, modelViewMatrix, instanceCount, baseInstance, &nodes.getWorldTransform(instance.node), instanceBuffer);
+                }
+            }
+            return;
+        }
+        for (auto* meshes : { &opaqueMeshes, &transparentMeshes }) {
+            for (auto& mesh : *meshes) {
+                if (mesh.isUploaded()) {
+                    queue.addInstanced(mesh, modelViewMatrix, instanceCount, baseInstance, nullptr, instanceBuffer);
+                }
+            }
+        }
+    }
+
+    //groups nodes of opaque meshes used more times into one instanced draw per mesh, others stay draws of single node
+    //has to be called once hierarchy is complete, before upload
+    void prepareDraws()
+    {
+        nodeDraws.clear();
+        instancedDraws.clear();
+        instanceNodes.clear();
+        std::vector<std::vector<uint32_t>> instancesOfMesh(opaqueMeshes.size());
+        for (uint32_t i = 0; i < meshInstances.size(); i++) {
+            if (!meshInstances[i].transparent) {
+                instancesOfMesh[meshInstances[i].mesh].push_back(i);
+            }
+        }
+        for (uint32_t i = 0; i < meshInstances.size(); i++) {
+            //transparent meshes are kept separate, so they can be sorted back to front
+            if (meshInstances[i].transparent || instancesOfMesh[meshInstances[i].mesh].size() == 1) {
+                nodeDraws.push_back(i);
+            }
+        }
+        for (uint32_t mesh = 0; mesh < instancesOfMesh.size(); mesh++) {
+            if (instancesOfMesh[mesh].size() < 2) {
+                continue;
+            }
+            instancedDraws.push_back({ mesh, (uint32_t)instanceNodes.size(), (uint32_t)instancesOfMesh[mesh].size() });
+            for (uint32_t instance : instancesOfMesh[mesh]) {
+                instanceNodes.push_back(meshInstances[instance].node);
+            }
+        }
+    }
+
+    bool isHierarchical() const
+    {
+        return !meshInstances.empty();
+    }
+
+    //axis aligned bounds of all vertices, zero for empty model
+    //meshes drawn from file data contribute corners of their accessor bounds
+    void getBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const
+    {
+        bool first = true;
+        boundsMin = boundsMax = glm::vec3(0.f);
+        auto addMesh = [&](const Mesh& mesh, const glm::mat4& transform) {
+            auto addPoint = [&](const glm::vec3& point) {
+                glm::vec3 position = glm::vec3(transform * glm::vec4(point, 1.f));
+                boundsMin = first ? position : glm::min(boundsMin, position);
+                boundsMax = first ? position : glm::max(boundsMax, position);
+                first = false;
+            };
+            if (mesh.source) {
+                for (int corner = 0; corner < 8; corner++) {
+                    addPoint(glm::vec3((corner & 1) ? mesh.source->boundsMax.x : mesh.source->boundsMin.x,
+                        (corner & 2) ? mesh.source->boundsMax.y : mesh.source->boundsMin.y, (corner & 4) ? mesh.source->boundsMax.z : mesh.source->boundsMin.z));
+                }
+            }
+            for (const auto& vertex : mesh.vertices) {
+                addPoint(vertex.Position);
+            }
+        };
+        if (isHierarchical()) {
+            //world transforms are up to date since load, nothing moves nodes afterwards
+            for (const auto& instance : meshInstances) {
+                const Mesh& mesh = instance.transparent ? transparentMeshes[instance.mesh] : opaqueMeshes[instance.mesh];
+                addMesh(mesh, nodes.getWorldTransform(instance.node));
+            }
+            return;
+        }
+        for (const auto* meshes : { &opaqueMeshes, &transparentMeshes }) {
+            for (const auto& mesh : *meshes) {
+                addMesh(mesh, glm::mat4(1.f));
+            }
+        }
+    }
+
+    //meshes stored on GPU
+    size_t getMeshCount() const
+    {
+        return opaqueMeshes.size() + transparentMeshes.size();
+    }
+
+    //one draw call per mesh, or per node and per mesh instanced over more nodes with hierarchy
+    size_t getDrawCount() const
+    {
+        return isHierarchical() ? nodeDraws.size() + instancedDraws.size() : getMeshCount();
+    }
+
+    const DeduplicationStats& getDeduplicationStats() const { return deduplicationStats; }
+    //totals of all meshes, average cache miss ratios are weighted by triangles
+    const WeldResult& getWeldResult() const { return weldResult; }
+
+    //vertex and index bytes of meshes as loaded, and as they would be with every node instance pretransformed into own copy
+    size_t getMeshBytes() const { return meshBytes; }
+    size_t getPretransformedMeshBytes() const { return pretransformedMeshBytes; }
+
+    size_t getTextureCount() const
+    {
+        return pendingTextures.size() + uploadedTextures.size();
+    }
+
+    //decoded image of texture not uploaded yet, nullptr once it is on GPU
+    const TextureImage* findPendingTexture(const std::string& path) const
+    {
+        auto pending = pendingTextures.find(path);
+        return pending != pendingTextures.end() ? &pending->second : nullptr;
+    }
+
+    //bytes held in video memory - vertex and index buffers plus textures
+    size_t gpuBytes() const
+    {
+        size_t bytes = 0;
+        for (const auto* meshes : { &opaqueMeshes, &transparentMeshes }) {
+            for (const auto& mesh : *meshes) {
+                if (mesh.isUploaded()) {
+                    bytes += mesh.gpuBytes();
+                }
+            }
+        }
+        //meshes can share texture object, each is counted only once
+        for (const auto& texture : uploadedTextures) {
+            bytes += texture.second.byteSize;
+        }
+        return bytes;
+    }
+
+    //bytes held in main memory - vertex and index data kept with meshes and textures waiting for upload
+    size_t cpuBytes() const
+    {
+        size_t bytes = 0;
+        for (const auto& image : pendingTextures) {
+            bytes += (size_t)image.second.width * image.second.height * image.second.channels;
+        }
+        for (const auto* meshes : { &opaqueMeshes, &transparentMeshes }) {
+            for (const auto& mesh : *meshes) {
+                bytes += mesh.cpuBytes();
+            }
+        }
+        return bytes;
+    }
+
+    //hand over all GL objects of the model, model must not be drawn afterwards
+    void releaseGLObjects(GLObjectList& objects)
+    {
+        for (auto* meshes : { &opaqueMeshes, &transparentMeshes }) {
+            for (auto& mesh : *meshes) {
+                mesh.releaseGLObjects(objects);
+            }
+        }
+        for (const auto& texture : uploadedTextures) {
+            objects.textures.push_back(texture.second.id);
+        }
+        if (instanceBuffer != 0) {
+            objects.buffers.push_back(instanceBuffer);
+            instanceBuffer = 0;
+        }
+        nodeDraws.clear();
+        instancedDraws.clear();
+        instanceNodes.clear();
+        opaqueMeshes.clear();
+        transparentMeshes.clear();
+        nodes.clear();
+        meshInstances.clear();
+        uploadedTextures.clear();
+        pendingTextures.clear();
+        uploadedMeshes = 0;
+        //chunks still being parsed are not needed anymore
+        scanStream.reset();
+    }
+
 private:
+    //decoded images by texture path, each file is decoded only once even if more materials use it
+    std::map<std::string, TextureImage> pendingTextures;
+    std::map<std::string, Texture> uploadedTextures;
+    //meshes are uploaded in order, opaque first
+    size_t uploadedMeshes = 0;
+    size_t meshBytes = 0;
+    size_t pretransformedMeshBytes = 0;
+    DeduplicationStats deduplicationStats;
+    WeldResult weldResult;
+    int importFlags = 0;
+    //parses streamed scan while model is uploaded, dropped once its last chunk is on GPU
+    std::shared_ptr<ScanStream> scanStream;
+    ScanStreamStats scanStats;
+
+    //opaque mesh drawn once for all its nodes, their world transforms are in instance buffer from baseInstance on
+    struct InstancedDraw {
+        uint32_t mesh;
+        uint32_t baseInstance;
+        uint32_t instanceCount;
+    };
+    //indices into meshInstances drawn one by one
+    std::vector<uint32_t> nodeDraws;
+    std::vector<InstancedDraw> instancedDraws;
+    //node of every element of instance buffer
+    std::vector<uint32_t> instanceNodes;
+    GLuint instanceBuffer = 0;
+
+    //world transforms are uploaded again whenever some node moved
+    void updateNodes()
+    {
+        if (nodes.update() && instanceBuffer != 0) {
+            uploadInstanceTransforms();
+        }
+    }
+
+    void uploadInstanceTransforms()
+    {
+        //zero color override keeps material color
+        std::vector<InstanceData> instances(instanceNodes.size());
+        for (size_t i = 0; i < instanceNodes.size(); i++) {
+            instances[i] = { nodes.getWorldTransform(instanceNodes[i]), glm::vec4(0.f) };
+        }
+        glNamedBufferSubData(instanceBuffer, 0, instances.size() * sizeof(InstanceData), instances.data());
+    }
+
+    static Mesh& pickMesh(std::vector<Mesh>& meshes, std::vector<Mesh>* proxyMeshes, unsigned int i)
+    {
+        return !meshes[i].isUploaded() && proxyMeshes && i < proxyMeshes->size() ? (*proxyMeshes)[i] : meshes[i];
+    }
+
+    //returns bytes uploaded, texture shared with already uploaded mesh costs nothing
+    size_t uploadTexture(Texture& texture)
+    {
+        auto uploaded = uploadedTextures.find(texture.path);
+        if (uploaded != uploadedTextures.end()) {
+            texture = uploaded->second;
+            return 0;
+        }
+        auto pending = pendingTextures.find(texture.path);
+        if (pending != pendingTextures.end()) {
+            texture.id = TextureFromImage(pending->second, &texture.byteSize);
+            pendingTextures.erase(pending);
+        }
+        else {
+            texture.id = TextureFromImage(TextureImage(), &texture.byteSize);
+        }
+        uploadedTextures.emplace(texture.path, texture);
+        return texture.byteSize;
+    }
+
     void loadModel(std::string const& path)
+    {
+        //node transforms have to be applied for some formats to work correctly (like gltf), either baked into vertices or kept in hierarchy
+        importFlags = currentImportFlags();
+        bool hierarchy = (importFlags & 1) != 0;
+        // retrieve the directory path of the filepath - we assume that textures are in same directory
+        directory = path.substr(0, path.find_last_of('/'));
+        bool imported = false;
+        //meshes of native gltf have no vertices on CPU, passes rewriting them are skipped
+        bool mapped = false;
+        //files native loaders give up on are imported by assimp
+        if (nativeObjLoader && IsObjPath(path)) {
+            imported = importObj(path, hierarchy);
+        }
+        else if (nativeGltfLoader && IsGltfPath(path)) {
+            imported = mapped = importGltf(path);
+        }
+        else if (streamScans && IsScanPath(path)) {
+            imported = mapped = importScan(path);
+        }
+        if (!imported) {
+            imported = importAssimp(path, hierarchy);
+        }
+        if (!imported) {
+            return;
+        }
+
+        if (weldVertices && !mapped) {
+            weld(path);
+        }
+
+        int maxTextureSize = mapped ? 0 : (int)atlasMaxTextureSize;
+        if (maxTextureSize > 0) {
+            PackMaterialTextures(opaqueMeshes, transparentMeshes, pendingTextures, maxTextureSize);
+        }
+        //merged mesh could not follow transforms of different nodes
+        bool mergeByTexture = maxTextureSize > 0 && !hierarchy;
+        if ((importFlags & 2) && !mapped) {
+            deduplicate(path, mergeByTexture);
+        }
+        else if (mergeByTexture) {
+            //transparent meshes stay separate so they are sorted back to front against each other
+            MergeMeshesByTexture(opaqueMeshes);
+        }
+        prepareDraws();
+
+        for (const auto* meshes : { &opaqueMeshes, &transparentMeshes }) {
+            for (const auto& mesh : *meshes) {
+                meshBytes += mesh.dataBytes();
+            }
+        }
+        pretransformedMeshBytes = isHierarchical() ? 0 : meshBytes;
+        for (const auto& instance : meshInstances) {
+            const Mesh& mesh = instance.transparent ? transparentMeshes[instance.mesh] : opaqueMeshes[instance.mesh];
+            pretransformedMeshBytes += mesh.dataBytes();
+        }
+        if ((hierarchy || mapped) && !scanStream) {
+            std::cout << "Hierarchy of " << path << ": " << nodes.size() << " nodes, " << getMeshCount() << " meshes drawn " << meshInstances.size()
+                << " times, mesh data " << meshBytes / 1024 << " KB instead of " << pretransformedMeshBytes / 1024 << " KB pretransformed" << std::endl;
+        }
+    }
+
+    //reads file by assimp with profile of its extension and converts scene to meshes
+    bool importAssimp(const std::string& path, bool hierarchy)
     {
         Assimp::Importer importer;
-        //pretransform vertices for some formats to work correctly (like gltf)
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_PreTransformVertices);
+        MappedFileCache* cache = fileCache;
+        CachedIOSystem* io = nullptr;
+        if (cache) {
+            //importer owns and deletes handler
+            io = new CachedIOSystem(*cache);
+            importer.SetIOHandler(io);
+        }
+        unsigned int pretransform = hierarchy ? 0 : (unsigned int)aiProcess_PreTransformVertices;
+        ImportProfiles* profiles = importProfiles;
+        const aiScene* scene = profiles ? profiles->read(importer, path, pretransform, hierarchy ? (unsigned int)aiProcess_PreTransformVertices : 0)
+            : importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | pretransform);
+        if (io) {
+            const FileIOStats& ioStats = io->getStats();
+            cache->record(ioStats);
+            std::cout << "File io of " << path << ": " << ioStats.opens << " opens (" << ioStats.hits << " cached, " << ioStats.misses << " mapped), "
+                << ioStats.bytesRead / 1024 << " KB read, " << ioStats.bytesMapped / 1024 << " KB mapped, " << ioStats.syscalls << " syscalls" << std::endl;
+        }
         if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) 
         {
            std::cout << importer.GetErrorString() << std::endl;
-            return;
+            return false;
+        }
+        if (hierarchy) {
+            processAssimpScene(scene);
         }
+        else {
+            processAssimpNode(scene->mRootNode, scene);
+        }
+        return true;
+    }
 
-        // retrieve the directory path of the filepath - we assume that textures are in same directory
-        directory = path.substr(0, path.find_last_of('/'));
-        processAssimpNode(scene->mRootNode, scene);
+    //meshes stay in mapped buffers until upload, so node transforms are kept in hierarchy in every import mode
+    bool importGltf(const std::string& path)
+    {
+        GltfScene scene;
+        GltfLoadStats stats;
+        std::string unsupported;
+        if (!LoadGltf(path, scene, unsupported, &stats, fileCache)) {
+            std::cout << "Native glTF loader cannot load " << path << " (" << unsupported << "), importing by assimp" << std::endl;
+            return false;
+        }
+        std::cout << "Mapped " << path << ": " << stats.jsonBytes / 1024 << " KB json parsed in " << stats.parseMs << " ms, " << stats.primitives
+            << " primitives with " << stats.mappedBytes / 1024 << " KB of buffer data uploaded as stored, " << stats.totalMs << " ms" << std::endl;
+        std::vector<MeshInstance> sceneMeshes;
+        for (auto& mesh : scene.meshes) {
+            if (mesh.hasTexture && pendingTextures.find(mesh.texture.path) == pendingTextures.end()) {
+                pendingTextures.emplace(mesh.texture.path, LoadTextureImage(mesh.texture.path.c_str(), directory));
+            }
+            std::vector<Mesh>& meshes = mesh.isTransparent ? transparentMeshes : opaqueMeshes;
+            sceneMeshes.push_back({ 0, (uint32_t)meshes.size(), mesh.isTransparent });
+            meshes.push_back(std::move(mesh));
+        }
+        nodes = std::move(scene.nodes);
+        for (const auto& instance : scene.instances) {
+            MeshInstance meshInstance = sceneMeshes[instance.mesh];
+            meshInstance.node = instance.node;
+            meshInstances.push_back(meshInstance);
+        }
+        return true;
+    }
+
+    //only header is read here, meshes are added chunk by chunk during upload steps
+    bool importScan(const std::string& path)
+    {
+        std::string unsupported;
+        scanStream = ScanStream::open(path, (size_t)std::max((int)scanChunkMB, 1) << 20, unsupported, fileCache);
+        if (!scanStream) {
+            std::cout << "Streaming loader cannot load " << path << " (" << unsupported << "), importing by assimp" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    //appends next parsed chunk of streamed scan as mesh, false when none is ready
+    bool adoptScanChunk()
+    {
+        std::shared_ptr<MeshSource> chunk;
+        if (!scanStream || !scanStream->pop(chunk)) {
+            return false;
+        }
+        meshBytes += chunk->bytes();
+        pretransformedMeshBytes += chunk->bytes();
+        opaqueMeshes.emplace_back(std::move(chunk), Texture(), false, false);
+        return true;
+    }
+
+    //obj meshes have no transforms, in hierarchy mode every object gets identity node under root
+    bool importObj(const std::string& path, bool hierarchy)
+    {
+        ObjScene scene;
+        ObjLoadStats stats;
+        if (!LoadObj(path, !hierarchy, scene, &stats, fileCache)) {
+            std::cout << "Native OBJ loader cannot load " << path << " (file could not be mapped), importing by assimp" << std::endl;
+            return false;
+        }
+        std::cout << "Parsed " << path << ": " << stats.fileBytes / 1024 << " KB in " << stats.totalMs << " ms (" << stats.megabytesPerSecond() << " MB/s, "
+            << stats.chunks << " chunks, parse " << stats.parseMs << " ms, build " << stats.buildMs << " ms), " << stats.triangles << " triangles, "
+            << stats.corners << " corners -> " << stats.vertices << " vertices" << std::endl;
+        int root = hierarchy ? nodes.addNode(-1, glm::mat4(1.f)) : -1;
+        for (const auto& object : scene.objects) {
+            int node = hierarchy ? nodes.addNode(root, glm::mat4(1.f)) : -1;
+            for (size_t index : object.meshes) {
+                Mesh& mesh = scene.meshes[index];
+                if (mesh.hasTexture && pendingTextures.find(mesh.texture.path) == pendingTextures.end()) {
+                    pendingTextures.emplace(mesh.texture.path, LoadTextureImage(mesh.texture.path.c_str(), directory));
+                }
+                std::vector<Mesh>& meshes = mesh.isTransparent ? transparentMeshes : opaqueMeshes;
+                if (hierarchy) {
+                    meshInstances.push_back({ (uint32_t)node, (uint32_t)meshes.size(), mesh.isTransparent });
+                }
+                meshes.push_back(std::move(mesh));
+            }
+        }
+        nodes.update();
+        return true;
+    }
+
+    void weld(const std::string& path)
+    {
+        std::vector<Mesh*> meshes;
+        for (auto* list : { &opaqueMeshes, &transparentMeshes }) {
+            for (auto& mesh : *list) {
+                meshes.push_back(&mesh);
+            }
+        }
+        std::vector<WeldResult> results = WeldMeshes(meshes);
+        std::ostringstream perMesh;
+        double missesBefore = 0.0, missesAfter = 0.0;
+        size_t trianglesBefore = 0, trianglesAfter = 0;
+        weldResult = WeldResult();
+        for (size_t i = 0; i < results.size(); i++) {
+            const WeldResult& result = results[i];
+            size_t triangles = meshes[i]->indices.size() / 3;
+            weldResult.verticesBefore += result.verticesBefore;
+            weldResult.verticesAfter += result.verticesAfter;
+            weldResult.collapsedTriangles += result.collapsedTriangles;
+            missesBefore += result.acmrBefore * (triangles + result.collapsedTriangles);
+            missesAfter += result.acmrAfter * triangles;
+            trianglesBefore += triangles + result.collapsedTriangles;
+            trianglesAfter += triangles;
+            if (result.verticesAfter < result.verticesBefore) {
+                perMesh << "  mesh " << i << ": " << result.verticesBefore << " -> " << result.verticesAfter << " vertices ("
+                    << (float)result.verticesBefore / std::max<size_t>(result.verticesAfter, 1) << "x), ACMR " << result.acmrBefore << " -> " << result.acmrAfter << "\n";
+            }
+        }
+        weldResult.acmrBefore = trianglesBefore > 0 ? (float)(missesBefore / trianglesBefore) : 0.f;
+        weldResult.acmrAfter = trianglesAfter > 0 ? (float)(missesAfter / trianglesAfter) : 0.f;
+        if (weldResult.verticesAfter < weldResult.verticesBefore) {
+            std::cout << "Welded " << path << ": " << weldResult.verticesBefore << " -> " << weldResult.verticesAfter << " vertices, ACMR "
+                << weldResult.acmrBefore << " -> " << weldResult.acmrAfter << "\n" << perMesh.str() << std::flush;
+        }
+    }
+
+    //vertex and index data as loaded, buffers on GPU add separate position stream
+    static size_t meshDataBytes(const std::vector<Mesh>& meshes, size_t& uploadBytes)
+    {
+        size_t bytes = 0;
+        size_t positionBytes = Mesh::compactPositions ? 3 * sizeof(int16_t) : sizeof(glm::vec3);
+        for (const auto& mesh : meshes) {
+            size_t meshBytes = mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(unsigned int);
+            bytes += meshBytes;
+            uploadBytes += meshBytes + mesh.vertices.size() * positionBytes;
+        }
+        return bytes;
+    }
+
+    static size_t textureGroupCount(const std::vector<Mesh>& meshes)
+    {
+        std::vector<std::string> keys;
+        for (const auto& mesh : meshes) {
+            keys.push_back(mesh.hasTexture ? mesh.texture.path : std::string());
+        }
+        std::sort(keys.begin(), keys.end());
+        return std::unique(keys.begin(), keys.end()) - keys.begin();
+    }
+
+    //replaces meshes repeating earlier mesh by new child node of their node placing the earlier mesh
+    //flat model gets root node for that and stays flat when nothing repeats
+    void deduplicate(const std::string& path, bool mergeByTexture)
+    {
+        DeduplicationStats& stats = deduplicationStats;
+        stats.meshBytesBefore = meshDataBytes(opaqueMeshes, stats.uploadBytesBefore) + meshDataBytes(transparentMeshes, stats.uploadBytesBefore);
+        bool flat = !isHierarchical();
+        if (flat) {
+            stats.drawsBefore = mergeByTexture ? textureGroupCount(opaqueMeshes) + transparentMeshes.size() : getMeshCount();
+            int root = nodes.addNode(-1, glm::mat4(1.f));
+            for (uint32_t i = 0; i < opaqueMeshes.size(); i++) {
+                meshInstances.push_back({ (uint32_t)root, i, false });
+            }
+            for (uint32_t i = 0; i < transparentMeshes.size(); i++) {
+                meshInstances.push_back({ (uint32_t)root, i, true });
+            }
+        }
+        else {
+            prepareDraws();
+            stats.drawsBefore = getDrawCount();
+        }
+
+        for (bool transparent : { false, true }) {
+            std::vector<Mesh>& meshes = transparent ? transparentMeshes : opaqueMeshes;
+            std::vector<MeshDuplicate> duplicates = FindDuplicateMeshes(meshes);
+            if (duplicates.empty()) {
+                continue;
+            }
+            std::vector<int> duplicateOf(meshes.size(), -1);
+            for (size_t i = 0; i < duplicates.size(); i++) {
+                duplicateOf[duplicates[i].mesh] = (int)i;
+            }
+            //references are never duplicates themselves, remaining meshes keep their order
+            std::vector<uint32_t> remap(meshes.size());
+            std::vector<Mesh> kept;
+            for (size_t i = 0; i < meshes.size(); i++) {
+                if (duplicateOf[i] < 0) {
+                    remap[i] = (uint32_t)kept.size();
+                    kept.push_back(std::move(meshes[i]));
+                }
+            }
+            for (auto& instance : meshInstances) {
+                if (instance.transparent != transparent) {
+                    continue;
+                }
+                int duplicate = duplicateOf[instance.mesh];
+                if (duplicate >= 0) {
+                    //child of node of replaced mesh, so it still follows that node
+                    instance.node = (uint32_t)nodes.addNode((int)instance.node, duplicates[duplicate].transform);
+                    instance.mesh = (uint32_t)duplicates[duplicate].reference;
+                }
+                instance.mesh = remap[instance.mesh];
+            }
+            meshes = std::move(kept);
+            stats.duplicateCount += duplicates.size();
+        }
+
+        if (flat && stats.duplicateCount == 0) {
+            nodes.clear();
+            meshInstances.clear();
+            if (mergeByTexture) {
+                MergeMeshesByTexture(opaqueMeshes);
+            }
+        }
+        else if (flat && mergeByTexture) {
+            mergeRootMeshes();
+        }
+        nodes.update();
+        prepareDraws();
+
+        stats.meshBytesAfter = meshDataBytes(opaqueMeshes, stats.uploadBytesAfter) + meshDataBytes(transparentMeshes, stats.uploadBytesAfter);
+        stats.uploadBytesAfter += instanceNodes.size() * sizeof(InstanceData);
+        stats.drawsAfter = getDrawCount();
+        if (stats.duplicateCount > 0) {
+            std::cout << "Deduplicated " << path << ": " << stats.duplicateCount << " repeated meshes, mesh data " << stats.meshBytesBefore / 1024 << " -> "
+                << stats.meshBytesAfter / 1024 << " KB, upload " << stats.uploadBytesBefore / 1024 << " -> " << stats.uploadBytesAfter / 1024
+                << " KB, draws " << stats.drawsBefore << " -> " << stats.drawsAfter << std::endl;
+        }
+    }
+
+    //opaque meshes of flat model used only once by root node are merged by texture as without deduplication
+    void mergeRootMeshes()
+    {
+        std::vector<Mesh>& meshes = opaqueMeshes;
+        std::vector<int> uses(meshes.size(), 0);
+        for (const auto& instance : meshInstances) {
+            if (!instance.transparent) {
+                uses[instance.mesh] += instance.node == 0 ? 1 : 2;
+            }
+        }
+        std::vector<Mesh> rootMeshes;
+        std::vector<Mesh> others;
+        std::vector<uint32_t> remap(meshes.size());
+        for (size_t i = 0; i < meshes.size(); i++) {
+            if (uses[i] == 1) {
+                rootMeshes.push_back(std::move(meshes[i]));
+            }
+            else {
+                remap[i] = (uint32_t)others.size();
+                others.push_back(std::move(meshes[i]));
+            }
+        }
+        MergeMeshesByTexture(rootMeshes);
+
+        std::vector<MeshInstance> instances;
+        for (const auto& instance : meshInstances) {
+            if (instance.transparent) {
+                instances.push_back(instance);
+            }
+            else if (uses[instance.mesh] != 1) {
+                instances.push_back({ instance.node, remap[instance.mesh] + (uint32_t)rootMeshes.size(), false });
+            }
+        }
+        for (uint32_t i = 0; i < rootMeshes.size(); i++) {
+            instances.push_back({ 0, i, false });
+        }
+        meshInstances = std::move(instances);
+        meshes = std::move(rootMeshes);
+        meshes.insert(meshes.end(), std::make_move_iterator(others.begin()), std::make_move_iterator(others.end()));
+    }
+
+    //every assimp mesh is converted once, nodes refer to it
+    void processAssimpScene(const aiScene* scene)
+    {
+        std::vector<MeshInstance> sceneMeshes;
+        for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+        {
+            Mesh m = processAssimpMesh(scene->mMeshes[i], scene);
+            std::vector<Mesh>& meshes = m.isTransparent ? transparentMeshes : opaqueMeshes;
+            sceneMeshes.push_back({ 0, (uint32_t)meshes.size(), m.isTransparent });
+            meshes.push_back(m);
+        }
+        addAssimpNode(scene->mRootNode, -1, sceneMeshes);
+        nodes.update();
+    }
+
+    //depth first, so parent is always added before its children
+    void addAssimpNode(const aiNode* node, int parent, const std::vector<MeshInstance>& sceneMeshes)
+    {
+        //assimp matrices are row major
+        int index = nodes.addNode(parent, glm::transpose(glm::make_mat4(&node->mTransformation.a1)));
+        for (unsigned int i = 0; i < node->mNumMeshes; i++)
+        {
+            MeshInstance instance = sceneMeshes[node->mMeshes[i]];
+            instance.node = (uint32_t)index;
+            meshInstances.push_back(instance);
+        }
+        for (unsigned int i = 0; i < node->mNumChildren; i++)
+        {
+            addAssimpNode(node->mChildren[i], index, sceneMeshes);
+        }
     }
 
     void processAssimpNode(aiNode* node, const aiScene* scene)
@@ -95,7 +880,6 @@ private:
         const auto& mat = scene->mMaterials[mesh->mMaterialIndex];
 
         glm::vec4 color = glm::vec4(1.f, 1.f, 1.f, 1.f);
-        float useDiffuseTexture = 0.f;
         aiColor4D diffuse;
         float alpha = 1.f;
 
@@ -104,15 +888,8 @@ private:
             color = glm::vec4(diffuse.r, diffuse.g, diffuse.b, alpha);
         }
 
-        //material can have file texture or just plain color
-        if (mat->GetTextureCount(aiTextureType_DIFFUSE) > 0)
-        {
-            useDiffuseTexture = 1.f;
-        }
-        else
-        {
-            useDiffuseTexture = 0.f;
-        }
+        //material can have file texture or just plain color, textured meshes are drawn by textured shader permutation
+        bool hasTexture = mat->GetTextureCount(aiTextureType_DIFFUSE) > 0;
 
         //just copy vertices, normals and texture coordinates to internal structures
         for (unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -142,7 +919,6 @@ private:
                 vertex.TexCoords = glm::vec2(0.0f, 0.0f);
             }
             vertex.Color = color;
-            vertex.useDiffuseTexture = useDiffuseTexture;
             vertices.push_back(vertex);
         }
 
@@ -152,65 +928,100 @@ private:
             for (unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);
         }
-        if (useDiffuseTexture == 1.f)
+        if (hasTexture)
         {
             texture = loadMaterialTexture(mat, aiTextureType_DIFFUSE, "texture_diffuse");
         }
-        return Mesh(vertices, indices, texture, useDiffuseTexture, alpha < 1.f );
+        return Mesh(vertices, indices, texture, hasTexture, alpha < 1.f );
     }
 
-    //load all textures for given material
+    //decode texture for given material, GL texture is created on upload
     Texture loadMaterialTexture(aiMaterial* mat, aiTextureType type, std::string typeName)
     {
         Texture texture;
         aiString str;
         mat->GetTexture(type, 0, &str);
-        texture.id = TextureFromFile(str.C_Str(), this->directory);
         texture.path = str.C_Str();
+        if (pendingTextures.find(texture.path) == pendingTextures.end()) {
+            pendingTextures.emplace(texture.path, LoadTextureImage(str.C_Str(), this->directory));
+        }
         return texture;
     }
 };
 
 
-unsigned int TextureFromFile(const char* path, const std::string& directory)
+inline TextureImage LoadTextureImage(const char* path, const std::string& directory)
 {
-
     //path to texture is relative to model file
     std::string filename = std::string(path);
     filename = directory + '/' + filename;
 
+    TextureImage image;
+    //load img using stbi library, decoding does not need GL so it can run on loader thread
+    unsigned char* data = stbi_load(filename.c_str(), &image.width, &image.height, &image.channels, 0);
+    if (data)
+    {
+        image.data = std::shared_ptr<unsigned char>(data, stbi_image_free);
+    }
+    else
+    {
+        std::cout << "Failed to load texture at " << path << std::endl;
+    }
+    return image;
+}
+
+inline unsigned int TextureFromImage(const TextureImage& image, size_t* byteSize)
+{
     unsigned int textureID;
-    glGenTextures(1, &textureID);
+    //created without binding, so texture bindings known to GLStateCache stay valid while models stream in
+    glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
 
-    int texWidth, texHeight, texChannelsCount;
-    //load img using stbi library and bind it as texture
-    unsigned char* data = stbi_load(filename.c_str(), &texWidth, &texHeight, &texChannelsCount, 0);
-    if (data)
+    if (image.data)
     {
         GLenum format = GL_RGBA;
-        if (texChannelsCount == 1)
+        GLenum internalFormat = GL_RGBA8;
+        if (image.channels == 1) {
             format = GL_RED;
-        else if (texChannelsCount == 3)
+            internalFormat = GL_R8;
+        }
+        else if (image.channels == 2) {
+            format = GL_RG;
+            internalFormat = GL_RG8;
+        }
+        else if (image.channels == 3) {
             format = GL_RGB;
-        else if (texChannelsCount == 4)
-            format = GL_RGBA;
+            internalFormat = GL_RGB8;
+        }
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, texWidth, texHeight, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        int levels = 1;
+        while ((std::max(image.width, image.height) >> levels) > 0) {
+            levels++;
+        }
+        if (image.mipLevels > 0)
+        {
+            //atlas gutters cover only first few levels, smaller levels would mix neighbouring textures
+            levels = std::min(levels, image.mipLevels);
+        }
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureStorage2D(textureID, levels, internalFormat, image.width, image.height);
+        glTextureSubImage2D(textureID, 0, 0, 0, image.width, image.height, format, GL_UNSIGNED_BYTE, image.data.get());
+        glGenerateTextureMipmap(textureID);
+        if (byteSize)
+        {
+            //full mipmap chain adds roughly one third to the base level
+            *byteSize = (size_t)image.width * image.height * image.channels * 4 / 3;
+        }
 
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Failed to load texture at " << path << std::endl;
-        stbi_image_free(data);
+        glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
 
     return textureID;
 }
+
+inline unsigned int TextureFromFile(const char* path, const std::string& directory, size_t* byteSize)
+{
+    return TextureFromImage(LoadTextureImage(path, directory), byteSize);
+}
@@ -0,0 +1,11 @@
+#version 460 core
+//adds one jittered sample into running average, blending with alpha = weight keeps average of all samples
+in vec2 uv;
+out vec4 fColor;
+
+layout(binding = 0) uniform sampler2D sampleImage;
+layout(location = 0) uniform float weight;
+
+void main() {
+	fColor = vec4(texelFetch(sampleImage, ivec2(gl_FragCoord.xy), 0).rgb, weight);
+}
@@ -0,0 +1,137 @@
+#version 460 core
+//FXAA - finds edges from luma contrast, searches along edge for its ends
+//and blends pixel with its neighbour across edge by its position on edge
+in vec2 uv;
+out vec4 fColor;
+
+layout(binding = 0) uniform sampler2D sceneImage;
+//rendered part of target in texture coordinates
+layout(location = 0) uniform vec2 uvScale;
+layout(location = 1) uniform vec2 texelSize;
+
+const float edgeThresholdMin = 0.0312;
+const float edgeThresholdMax = 0.125;
+const float subpixelQuality = 0.75;
+const int searchSteps = 12;
+const float searchStepSizes[12] = float[](1.0, 1.0, 1.0, 1.0, 1.0, 1.5, 2.0, 2.0, 2.0, 2.0, 4.0, 8.0);
+
+//samples never reach texels outside rendered part
+vec3 fetch(vec2 position) {
+	return texture(sceneImage, clamp(position, texelSize * 0.5, uvScale - texelSize * 0.5)).rgb;
+}
+
+float luma(vec3 color) {
+	return sqrt(dot(color, vec3(0.299, 0.587, 0.114)));
+}
+
+float lumaAt(vec2 position) {
+	return luma(fetch(position));
+}
+
+void main() {
+	vec2 position = uv * uvScale;
+	vec3 color = fetch(position);
+	float lumaCenter = luma(color);
+	float lumaDown = lumaAt(position + vec2(0.0, -texelSize.y));
+	float lumaUp = lumaAt(position + vec2(0.0, texelSize.y));
+	float lumaLeft = lumaAt(position + vec2(-texelSize.x, 0.0));
+	float lumaRight = lumaAt(position + vec2(texelSize.x, 0.0));
+
+	float lumaMin = min(lumaCenter, min(min(lumaDown, lumaUp), min(lumaLeft, lumaRight)));
+	float lumaMax = max(lumaCenter, max(max(lumaDown, lumaUp), max(lumaLeft, lumaRight)));
+	float lumaRange = lumaMax - lumaMin;
+	//no edge here
+	if (lumaRange < max(edgeThresholdMin, lumaMax * edgeThresholdMax)) {
+		fColor = vec4(color, 1.0);
+		return;
+	}
+
+	float lumaDownLeft = lumaAt(position - texelSize);
+	float lumaUpRight = lumaAt(position + texelSize);
+	float lumaUpLeft = lumaAt(position + vec2(-texelSize.x, texelSize.y));
+	float lumaDownRight = lumaAt(position + vec2(texelSize.x, -texelSize.y));
+
+	float lumaDownUp = lumaDown + lumaUp;
+	float lumaLeftRight = lumaLeft + lumaRight;
+	float lumaLeftCorners = lumaDownLeft + lumaUpLeft;
+	float lumaDownCorners = lumaDownLeft + lumaDownRight;
+	float lumaRightCorners = lumaDownRight + lumaUpRight;
+	float lumaUpCorners = lumaUpRight + lumaUpLeft;
+
+	float edgeHorizontal = abs(-2.0 * lumaLeft + lumaLeftCorners) + abs(-2.0 * lumaCenter + lumaDownUp) * 2.0 + abs(-2.0 * lumaRight + lumaRightCorners);
+	float edgeVertical = abs(-2.0 * lumaUp + lumaUpCorners) + abs(-2.0 * lumaCenter + lumaLeftRight) * 2.0 + abs(-2.0 * lumaDown + lumaDownCorners);
+	bool isHorizontal = edgeHorizontal >= edgeVertical;
+
+	//side of edge with steeper gradient
+	float luma1 = isHorizontal ? lumaDown : lumaLeft;
+	float luma2 = isHorizontal ? lumaUp : lumaRight;
+	float gradient1 = luma1 - lumaCenter;
+	float gradient2 = luma2 - lumaCenter;
+	bool is1Steepest = abs(gradient1) >= abs(gradient2);
+	float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+
+	float stepLength = isHorizontal ? texelSize.y : texelSize.x;
+	float lumaLocalAverage;
+	if (is1Steepest) {
+		stepLength = -stepLength;
+		lumaLocalAverage = 0.5 * (luma1 + lumaCenter);
+	}
+	else {
+		lumaLocalAverage = 0.5 * (luma2 + lumaCenter);
+	}
+
+	//search from middle of edge in both directions until luma changes
+	vec2 edgePosition = position;
+	if (isHorizontal) {
+		edgePosition.y += stepLength * 0.5;
+	}
+	else {
+		edgePosition.x += stepLength * 0.5;
+	}
+	vec2 offset = isHorizontal ? vec2(texelSize.x, 0.0) : vec2(0.0, texelSize.y);
+	vec2 position1 = edgePosition - offset;
+	vec2 position2 = edgePosition + offset;
+	float lumaEnd1 = lumaAt(position1) - lumaLocalAverage;
+	float lumaEnd2 = lumaAt(position2) - lumaLocalAverage;
+	bool reached1 = abs(lumaEnd1) >= gradientScaled;
+	bool reached2 = abs(lumaEnd2) >= gradientScaled;
+	for (int i = 1; i < searchSteps && !(reached1 && reached2); i++) {
+		if (!reached1) {
+			position1 -= offset * searchStepSizes[i];
+			lumaEnd1 = lumaAt(position1) - lumaLocalAverage;
+			reached1 = abs(lumaEnd1) >= gradientScaled;
+		}
+		if (!reached2) {
+			position2 += offset * searchStepSizes[i];
+			lumaEnd2 = lumaAt(position2) - lumaLocalAverage;
+			reached2 = abs(lumaEnd2) >= gradientScaled;
+		}
+	}
+
+	float distance1 = isHorizontal ? position.x - position1.x : position.y - position1.y;
+	float distance2 = isHorizontal ? position2.x - position.x : position2.y - position.y;
+	bool isDirection1 = distance1 < distance2;
+	float distanceFinal = min(distance1, distance2);
+	float edgeThickness = distance1 + distance2;
+
+	//blend only when luma at nearer end changes the other way than center
+	bool isLumaCenterSmaller = lumaCenter < lumaLocalAverage;
+	bool correctVariation = ((isDirection1 ? lumaEnd1 : lumaEnd2) < 0.0) != isLumaCenterSmaller;
+	float pixelOffset = correctVariation ? -distanceFinal / edgeThickness + 0.5 : 0.0;
+
+	//thin lines and single pixels are blended by average of neighbourhood
+	float lumaAverage = (1.0 / 12.0) * (2.0 * (lumaDownUp + lumaLeftRight) + lumaLeftCorners + lumaRightCorners);
+	float subpixelOffset1 = clamp(abs(lumaAverage - lumaCenter) / lumaRange, 0.0, 1.0);
+	float subpixelOffset2 = (-2.0 * subpixelOffset1 + 3.0) * subpixelOffset1 * subpixelOffset1;
+	float subpixelOffset = subpixelOffset2 * subpixelOffset2 * subpixelQuality;
+	pixelOffset = max(pixelOffset, subpixelOffset);
+
+	vec2 finalPosition = position;
+	if (isHorizontal) {
+		finalPosition.y += pixelOffset * stepLength;
+	}
+	else {
+		finalPosition.x += pixelOffset * stepLength;
+	}
+	fColor = vec4(fetch(finalPosition), 1.0);
+}
@@ -1,19 +1,34 @@
 #version 460 core
+//permutation features are defined by ShaderPermutations right after version line
+//TEXTURED - diffuse color is taken from texture instead of vertex color
+//TRANSPARENT - material opacity is used for alpha
+//LIGHTING_MODEL - LIGHTING_PHONG, LIGHTING_BLINN_PHONG or LIGHTING_UNLIT
+//INSTANCED - instance color override is mixed into diffuse color
 
-in vec3 vNormal;
-in vec3 vPosition;
-in vec3 vLightPos;
-in vec4 vColor;
-in float vUseDiffuseTexture;
-in vec2 TexCoords;
+layout(location = 0) in vec3 vNormal;
+layout(location = 1) in vec3 vPosition;
+layout(location = 2) in vec3 vLightPos;
+layout(location = 4) in vec4 vColor;
+layout(location = 3) in vec2 TexCoords;
+#if INSTANCED
+layout(location = 6) flat in vec4 vColorOverride;
+#endif
 
 out vec4 fColor;
 
-uniform vec3 lightColor;
-uniform sampler2D texture_diffuse1;
-
-vec3 phong(vec4 diffuseColor, vec3 position, vec3 normal, vec3 lightPosition, vec3 lightColor){
+layout(std140, binding = 0) uniform FrameUniforms {
+	mat4 modelMatrix;
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 lightPos;
+	vec4 lightColor;
+};
+layout(binding = 0) uniform sampler2D texture_diffuse1;
 
+vec3 shade(vec4 diffuseColor, vec3 position, vec3 normal, vec3 lightPosition, vec3 lightColor){
+#if LIGHTING_MODEL == LIGHTING_UNLIT
+  return diffuseColor.rgb;
+#else
   //diffuse
   vec3 norm = normalize(normal);
   vec3 lightDir = normalize(lightPosition-position);
@@ -25,39 +40,43 @@ vec3 phong(vec4 diffuseColor, vec3 position, vec3 normal, vec3 lightPosition, ve
   //specular
   float specularStrength = 2;
   vec3 viewDir = normalize(-position); 
+#if LIGHTING_MODEL == LIGHTING_BLINN_PHONG
+  //halfway vector needs higher exponent for highlight of similar size
+  vec3 halfwayDir = normalize(lightDir + viewDir);
+  float spec = pow(max(dot(norm, halfwayDir), 0.0), 128);
+#else
   vec3 reflectDir = reflect(-lightDir, norm);  
   float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+#endif
 
   return (diffuse+ambientStrength + spec*specularStrength)*lightColor*diffuseColor.rgb;
+#endif
 }
 
 
 void main() {
-	vec4 tmpFragColr;
-	if(vUseDiffuseTexture == 1){
-		tmpFragColr = texture(texture_diffuse1, TexCoords);
-	}
-	else{
-		tmpFragColr = vColor;
-	}
-
-	vec3 col = phong(tmpFragColr,vPosition,vNormal,vLightPos,lightColor);
-	float alpha;
-	
-	if(vUseDiffuseTexture == 1.f){
-		//if texture has alpha channel, use it
-		if(tmpFragColr.a == 1.f){
-			alpha = vColor.a;
-		}
-		//otherwise use the	color alpha obtained by assimp as material opacity prop
-		else{
-			alpha = tmpFragColr.a;
-		}
-	}
-	else{
-		alpha = vColor.a;
-	}
+#if TEXTURED
+	vec4 tmpFragColr = texture(texture_diffuse1, TexCoords);
+#else
+	vec4 tmpFragColr = vColor;
+#endif
+#if INSTANCED
+	tmpFragColr.rgb = mix(tmpFragColr.rgb, vColorOverride.rgb, vColorOverride.a);
+#endif
+
+	vec3 col = shade(tmpFragColr,vPosition,vNormal,vLightPos,lightColor.rgb);
 
+#if TEXTURED && TRANSPARENT
+	//if texture has alpha channel, use it, otherwise use the color alpha obtained by assimp as material opacity prop
+	float alpha = tmpFragColr.a == 1.f ? vColor.a : tmpFragColr.a;
+#elif TEXTURED
+	//opaque material has opacity 1, only texture alpha is left
+	float alpha = tmpFragColr.a;
+#elif TRANSPARENT
+	float alpha = vColor.a;
+#else
+	float alpha = 1.f;
+#endif
 
 	fColor = vec4(col, alpha);
-}
\ No newline at end of file
+}
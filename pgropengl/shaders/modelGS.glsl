@@ -0,0 +1,41 @@
+#version 460 core
+//used only by multi view permutations when vertex shader cannot write gl_ViewportIndex
+//passes triangle through and routes it into viewport of its view
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 3) out;
+
+layout(location = 0) in vec3 inNormal[];
+layout(location = 1) in vec3 inPosition[];
+layout(location = 2) in vec3 inLightPos[];
+layout(location = 3) in vec2 inTexCoords[];
+layout(location = 4) in vec4 inColor[];
+layout(location = 5) flat in int vViewIndex[];
+#if INSTANCED
+layout(location = 6) flat in vec4 inColorOverride[];
+#endif
+
+layout(location = 0) out vec3 vNormal;
+layout(location = 1) out vec3 vPosition;
+layout(location = 2) out vec3 vLightPos;
+layout(location = 3) out vec2 TexCoords;
+layout(location = 4) out vec4 vColor;
+#if INSTANCED
+layout(location = 6) flat out vec4 vColorOverride;
+#endif
+
+void main() {
+	for (int i = 0; i < 3; i++) {
+		gl_ViewportIndex = vViewIndex[0];
+		gl_Position = gl_in[i].gl_Position;
+		vNormal = inNormal[i];
+		vPosition = inPosition[i];
+		vLightPos = inLightPos[i];
+		TexCoords = inTexCoords[i];
+		vColor = inColor[i];
+#if INSTANCED
+		vColorOverride = inColorOverride[i];
+#endif
+		EmitVertex();
+	}
+	EndPrimitive();
+}
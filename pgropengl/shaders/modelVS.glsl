@@ -1,34 +1,96 @@
 #version 460 core
+//DEPTH_ONLY - permutation of depth pre-pass, only position is computed
+//MULTI_VIEW - instance index selects view and viewport, VIEWPORT_EXTENSION tells how viewport is written
+//INSTANCED - instance matrix applied after model matrix and color override are read from instance buffer
+#if MULTI_VIEW && VIEWPORT_EXTENSION == 1
+#extension GL_ARB_shader_viewport_layer_array : require
+#elif MULTI_VIEW && VIEWPORT_EXTENSION == 2
+#extension GL_AMD_vertex_shader_viewport_index : require
+#endif
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
 layout (location = 2) in vec2 texCoords;
 layout (location = 3) in vec4 Color;
-layout (location = 4) in float useDiffuseTexture;
+//position stream may be quantized to mesh bounds, set per mesh as constant attributes
+layout (location = 5) in vec3 positionOffset;
+layout (location = 6) in vec3 positionScale;
+//transform of scene node the mesh is drawn for, identity for meshes already in model space
+layout (location = 7) in mat4 nodeTransform;
 
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
-uniform vec3 lightPos;
+//shared by all shader permutations, updated once per draw of model
+layout(std140, binding = 0) uniform FrameUniforms {
+	mat4 modelMatrix;
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 lightPos;
+	vec4 lightColor;
+};
 
-//test
-uniform float size;
+#if MULTI_VIEW
+layout(std140, binding = 1) uniform MultiViewUniforms {
+	mat4 viewMatrices[MULTI_VIEW_COUNT];
+	mat4 projectionMatrices[MULTI_VIEW_COUNT];
+};
+//every instance is drawn once per view, views of one instance are consecutive
+#define VIEW_INDEX (gl_InstanceID % MULTI_VIEW_COUNT)
+#define INSTANCE_STEP (gl_InstanceID / MULTI_VIEW_COUNT)
+#define VIEW_MATRIX viewMatrices[VIEW_INDEX]
+#define PROJECTION_MATRIX projectionMatrices[VIEW_INDEX]
+#else
+#define INSTANCE_STEP gl_InstanceID
+#define VIEW_MATRIX viewMatrix
+#define PROJECTION_MATRIX projectionMatrix
+#endif
 
-//out vec3 vColor;
-out vec3 vNormal;
-out vec3 vPosition;
-out vec3 vLightPos;
-out vec2 TexCoords;
-out vec4 vColor;
-out float vUseDiffuseTexture;
+#if INSTANCED
+struct Instance {
+	mat4 modelMatrix;
+	vec4 colorOverride;
+};
+layout(std430, binding = 2) readonly buffer Instances {
+	Instance instances[];
+};
+#define MODEL_MATRIX (modelMatrix * instances[gl_BaseInstance + INSTANCE_STEP].modelMatrix * nodeTransform)
+#else
+#define MODEL_MATRIX (modelMatrix * nodeTransform)
+#endif
+
+//depth pre-pass and color pass have to produce bit identical depth for GL_EQUAL test
+invariant gl_Position;
+
+#if !DEPTH_ONLY
+//locations let geometry shader of multi view pass varyings under other names
+layout(location = 0) out vec3 vNormal;
+layout(location = 1) out vec3 vPosition;
+layout(location = 2) out vec3 vLightPos;
+layout(location = 3) out vec2 TexCoords;
+layout(location = 4) out vec4 vColor;
+#if INSTANCED
+layout(location = 6) flat out vec4 vColorOverride;
+#endif
+#endif
+#if MULTI_VIEW && VIEWPORT_EXTENSION == 0
+layout(location = 5) flat out int vViewIndex;
+#endif
 void main() {
-	vNormal = mat3(transpose(inverse(viewMatrix * modelMatrix))) * normal;
-	vPosition = vec3(viewMatrix * modelMatrix * vec4(position, 1.0));
-	vLightPos = vec3(viewMatrix * vec4(lightPos, 1.0));
+	vec3 modelPosition = positionOffset + position * positionScale;
+#if !DEPTH_ONLY
+	vNormal = mat3(transpose(inverse(VIEW_MATRIX * MODEL_MATRIX))) * normal;
+	vPosition = vec3(VIEW_MATRIX * MODEL_MATRIX * vec4(modelPosition, 1.0));
+	vLightPos = vec3(VIEW_MATRIX * vec4(lightPos.xyz, 1.0));
 	TexCoords = texCoords;  
+	vColor = Color;
+#if INSTANCED
+	vColorOverride = instances[gl_BaseInstance + INSTANCE_STEP].colorOverride;
+#endif
+#endif
 	
-	vec4 clipSpacePosition =  projectionMatrix * viewMatrix * modelMatrix * vec4(position, 1);
+	vec4 clipSpacePosition =  PROJECTION_MATRIX * VIEW_MATRIX * MODEL_MATRIX * vec4(modelPosition, 1);
 
 	gl_Position = clipSpacePosition;
-	vColor = Color;
-	vUseDiffuseTexture = useDiffuseTexture;
-}
\ No newline at end of file
+#if MULTI_VIEW && VIEWPORT_EXTENSION == 0
+	vViewIndex = VIEW_INDEX;
+#elif MULTI_VIEW
+	gl_ViewportIndex = VIEW_INDEX;
+#endif
+}
@@ -0,0 +1,29 @@
+#version 460 core
+//upscales rendered part of dynamic resolution target to whole viewport and sharpens it
+//sharpening is unsharp mask limited to local min/max of neighbourhood so edges do not ring
+in vec2 uv;
+out vec4 fColor;
+
+layout(binding = 0) uniform sampler2D sceneImage;
+//rendered part of target in texture coordinates
+layout(location = 0) uniform vec2 uvScale;
+layout(location = 1) uniform vec2 texelSize;
+layout(location = 2) uniform float sharpness;
+
+void main() {
+	//linear filtering must not reach texels outside rendered part
+	vec2 sourceUv = clamp(uv * uvScale, texelSize * 0.5, uvScale - texelSize * 0.5);
+	vec3 center = texture(sceneImage, sourceUv).rgb;
+	if (sharpness <= 0.0) {
+		fColor = vec4(center, 1.0);
+		return;
+	}
+	vec3 north = texture(sceneImage, min(sourceUv + vec2(0.0, texelSize.y), uvScale - texelSize * 0.5)).rgb;
+	vec3 south = texture(sceneImage, max(sourceUv - vec2(0.0, texelSize.y), texelSize * 0.5)).rgb;
+	vec3 east = texture(sceneImage, min(sourceUv + vec2(texelSize.x, 0.0), uvScale - texelSize * 0.5)).rgb;
+	vec3 west = texture(sceneImage, max(sourceUv - vec2(texelSize.x, 0.0), texelSize * 0.5)).rgb;
+	vec3 minimum = min(center, min(min(north, south), min(east, west)));
+	vec3 maximum = max(center, max(max(north, south), max(east, west)));
+	vec3 sharpened = center + sharpness * (4.0 * center - north - south - east - west);
+	fColor = vec4(clamp(sharpened, minimum, maximum), 1.0);
+}
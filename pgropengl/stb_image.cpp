@@ -0,0 +1,3 @@
+//stb image for loading textures in files, implementation compiled once for all sources including model.h
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
@@ -0,0 +1,3 @@
+//rectangle packer bundled with imgui, imgui compiles its own static copy so project needs separate implementation
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"